@@ -110,8 +110,17 @@ static BoundingBox from_points(const T& points) {
   return bbox;
 }
 
+//! Sample a location uniformly within the box
+Position sample_location(RandomStream& rng) const {
+  double x = rng.uniform();
+  double y = rng.uniform();
+  double z = rng.uniform();
+  return lower_left() + width() * Vec3da(x, y, z);
+}
+
+//! Sample a location uniformly within the box using the random stream of the calling thread
 Position sample_location() const {
-  return lower_left() + width() * Vec3da(rand_double(), rand_double(), rand_double());
+  return sample_location(thread_random_stream());
 }
 
 };
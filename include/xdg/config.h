@@ -2,6 +2,7 @@
 #ifndef XDG_CONFIG_H
 #define XDG_CONFIG_H
 
+#include <array>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -39,6 +40,12 @@ public:
   void reset() {
     initialized_ = false;
     n_threads_ = -1;
+    cache_surface_triangles_ = false;
+    cache_element_transforms_ = false;
+    native_surface_triangles_ = false;
+    build_profiles_.fill(BuildProfile::MAX_TRACE);
+    lazy_volume_registration_ = false;
+    measure_tree_memory_ = false;
     reset_libmesh_init();
   }
 
@@ -58,6 +65,50 @@ public:
 
   void set_n_threads(int n_threads);
 
+  //! Whether surface triangle vertices/normals are packed into per-surface
+  //! buffers when surface trees are built. Trades memory for fewer MeshManager
+  //! queries during ray tracing
+  bool cache_surface_triangles() const { return cache_surface_triangles_; }
+
+  void set_cache_surface_triangles(bool cache) { cache_surface_triangles_ = cache; }
+
+  //! Whether the barycentric transform of each tetrahedron is precomputed
+  //! when element trees are built. Trades memory for faster point location
+  bool cache_element_transforms() const { return cache_element_transforms_; }
+
+  void set_cache_element_transforms(bool cache) { cache_element_transforms_ = cache; }
+
+  //! Whether surfaces are registered with Embree as native triangle geometry
+  //! (with double precision refinement of candidate hits) rather than as user
+  //! geometry
+  bool native_surface_triangles() const { return native_surface_triangles_; }
+
+  void set_native_surface_triangles(bool native) { native_surface_triangles_ = native; }
+
+  //! Build profile used for trees of the given type by ray tracers created
+  //! after it is set
+  BuildProfile build_profile(TreeType tree_type) const
+  { return build_profiles_[static_cast<int>(tree_type)]; }
+
+  void set_build_profile(TreeType tree_type, BuildProfile profile)
+  { build_profiles_[static_cast<int>(tree_type)] = profile; }
+
+  //! Set the build profile for all tree types
+  void set_build_profile(BuildProfile profile) { build_profiles_.fill(profile); }
+
+  //! Whether XDG::prepare_raytracer defers the registration of each volume
+  //! until the volume is first queried
+  bool lazy_volume_registration() const { return lazy_volume_registration_; }
+
+  void set_lazy_volume_registration(bool lazy) { lazy_volume_registration_ = lazy; }
+
+  //! Whether deferred tree builds are performed one at a time so that the
+  //! acceleration structure memory of every tree is measured (see
+  //! XDG::memory_report). Trees built concurrently can't be measured
+  bool measure_tree_memory() const { return measure_tree_memory_; }
+
+  void set_measure_tree_memory(bool measure) { measure_tree_memory_ = measure; }
+
   bool ray_tracer_enabled(RTLibrary rt_lib) const;
 
   bool mesh_manager_enabled(MeshLibrary mesh_lib) const;
@@ -103,6 +154,14 @@ public:
 private:
   // Data members
   int n_threads_ {-1};
+  bool cache_surface_triangles_ {false};
+  bool cache_element_transforms_ {false};
+  bool native_surface_triangles_ {false};
+  std::array<BuildProfile, 3> build_profiles_ {BuildProfile::MAX_TRACE,
+                                               BuildProfile::MAX_TRACE,
+                                               BuildProfile::MAX_TRACE};
+  bool lazy_volume_registration_ {false};
+  bool measure_tree_memory_ {false};
   bool initialized_ {false};
 };
 
@@ -1,6 +1,7 @@
 #ifndef _XDG_CONSTANTS
 #define _XDG_CONSTANTS
 
+#include <array>
 #include <cmath>
 #include <map>
 #include <limits>
@@ -31,6 +32,20 @@ constexpr double PLUCKER_ZERO_TOL {20 * std::numeric_limits<double>::epsilon()};
 
 constexpr double TINY_BIT {1e-10};
 
+// Minimum cosine of the angle between a ray and the normal of the surface it
+// hits for the hit to determine the volume containing the ray origin
+constexpr double FIND_VOLUME_GRAZING_COSINE {1e-6};
+
+// Directions retried by XDG::find_volume when the ray along the requested
+// direction grazes a surface. They are far from the coordinate axes, the
+// face and body diagonals and from each other, so that surfaces of
+// axis-aligned or structured meshes are unlikely to be grazed by more than
+// one of them. Normalized before use
+constexpr std::array<std::array<double, 3>, 2> FIND_VOLUME_RETRY_DIRECTIONS {{
+  {0.5377, 0.6042, -0.5881},
+  {-0.2863, 0.4279, 0.8573}
+}};
+
 // Whether information pertains to a surface or volume
 enum class GeometryType {
  SURFACE = 2,
@@ -70,6 +85,41 @@ static const std::map<RTLibrary, std::string> RT_LIB_TO_STR =
   {RTLibrary::GPRT, "GPRT"}
 };
 
+// Acceleration structure build profile, trading tree build time against trace time
+enum class BuildProfile {
+  FAST_BUILD, // low quality, compact trees for short jobs
+  BALANCED,   // medium quality trees
+  MAX_TRACE   // high quality SAH trees for long production runs
+};
+
+static const std::map<BuildProfile, std::string> BUILD_PROFILE_TO_STR =
+{
+  {BuildProfile::FAST_BUILD, "fast-build"},
+  {BuildProfile::BALANCED, "balanced"},
+  {BuildProfile::MAX_TRACE, "max-trace"}
+};
+
+// Strategies for accumulating mesh tally scores from concurrent threads
+enum class TallyAccumulation {
+  THREAD_PRIVATE, // each thread scores into its own array, summed when the tally is finalized
+  ATOMIC,         // all threads score into one array with atomic updates
+  STRIPED_LOCK    // all threads score into one array guarded by a fixed set of locks
+};
+
+static const std::map<TallyAccumulation, std::string> TALLY_ACCUMULATION_TO_STR =
+{
+  {TallyAccumulation::THREAD_PRIVATE, "thread-private"},
+  {TallyAccumulation::ATOMIC, "atomic"},
+  {TallyAccumulation::STRIPED_LOCK, "striped-lock"}
+};
+
+// Kinds of trees built by a ray tracer
+enum class TreeType {
+  SURFACE, // per-volume surface trees
+  ELEMENT, // per-volume element (point location) trees
+  GLOBAL   // global surface and element trees
+};
+
 // Mesh identifer type
 using MeshID = int32_t;
 using MeshIndex  = int32_t;
@@ -145,6 +195,19 @@ struct formatter<xdg::MeshLibrary> : fmt::formatter<std::string> {
   }
 };
 
+template <>
+struct formatter<xdg::BuildProfile> : fmt::formatter<std::string> {
+  auto format(xdg::BuildProfile profile, fmt::format_context& ctx) const {
+    return fmt::formatter<std::string>::format(xdg::BUILD_PROFILE_TO_STR.at(profile), ctx);
+  }
+};
+
+template <>
+struct formatter<xdg::TallyAccumulation> : fmt::formatter<std::string> {
+  auto format(xdg::TallyAccumulation accumulation, fmt::format_context& ctx) const {
+    return fmt::formatter<std::string>::format(xdg::TALLY_ACCUMULATION_TO_STR.at(accumulation), ctx);
+  }
+};
 
 }
 
@@ -1,7 +1,8 @@
 #ifndef XDG_ELEMENT_FACE_ACCESSOR_H
 #define XDG_ELEMENT_FACE_ACCESSOR_H
 
-#include <memory>
+#include <array>
+
 #include "xdg/mesh_manager_interface.h"
 
 namespace xdg {
@@ -11,22 +12,26 @@ namespace xdg {
   //! of element faces across different mesh libraries. It allows consistent access
   //! to face geometry while hiding the underlying mesh representation details, allowing
   //! higher level operations like element traversal to rely on the same implementation.
-  //! It works by binding to a mesh manager and element ID, and then providing access to
-  //! the face vertices of the element via the library-specific mesh_manager implementation.
+  //! The four vertices of the element are fetched once on construction into a
+  //! fixed-size array and faces are formed using the library's face ordering, so
+  //! the accessor lives on the stack and requires no allocation.
   struct ElementFaceAccessor {
-    ElementFaceAccessor(MeshID element)
-      : element_(element) {}
 
     //! \brief Create an ElementFaceAccessor for a given element
     //! \param mesh_manager The mesh manager to use
     //! \param element The element to create the accessor for
-    //! \return A shared pointer to the ElementFaceAccessor
-    static std::shared_ptr<ElementFaceAccessor> create(const MeshManager* mesh_manager, MeshID element);
+    ElementFaceAccessor(const MeshManager* mesh_manager, MeshID element)
+      : element_(element),
+        vertices_(mesh_manager->tet_vertices(element)),
+        face_ordering_(mesh_manager->tet_face_ordering()) {}
 
     //! \brief Get the vertices of a face
     //! \param i The face index (0-3 for tetrahedra)
     //! \return An array of vertices
-    virtual std::array<Vertex, 3> face_vertices(int i) const = 0;
+    std::array<Vertex, 3> face_vertices(int i) const {
+      const auto& face = face_ordering_[i];
+      return {vertices_[face[0]], vertices_[face[1]], vertices_[face[2]]};
+    }
 
     //! \brief Get the element ID
     //! \return The element ID
@@ -34,6 +39,8 @@ namespace xdg {
 
     // data members
     MeshID element_;
+    std::array<Vertex, 4> vertices_;
+    const std::array<std::array<int, 3>, 4>& face_ordering_;
   };
 
 
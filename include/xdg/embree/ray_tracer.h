@@ -1,7 +1,10 @@
 #ifndef _XDG_EMBREE_RAY_TRACING_INTERFACE_H
 #define _XDG_EMBREE_RAY_TRACING_INTERFACE_H
 
+#include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 
@@ -11,8 +14,8 @@
 #include "xdg/primitive_ref.h"
 #include "xdg/geometry_data.h"
 #include "xdg/ray_tracing_interface.h"
-#include "xdg/ray.h"
 #include "xdg/error.h"
+#include "xdg/ray.h"
 
 namespace xdg {
 
@@ -24,7 +27,34 @@ public:
   RTLibrary library() const override { return RTLibrary::EMBREE; }
 
   void init() override;
-  RTCScene create_embree_scene();
+  RTCScene create_embree_scene(TreeType tree_type);
+
+  //! \brief Build profile used for new trees of the given type. Defaults to
+  //! the XDGConfig profile at construction
+  BuildProfile build_profile(TreeType tree_type) const
+  { return build_profiles_[static_cast<int>(tree_type)]; }
+
+  void set_build_profile(TreeType tree_type, BuildProfile profile)
+  { build_profiles_[static_cast<int>(tree_type)] = profile; }
+
+  size_t triangle_cache_memory() const override;
+  size_t element_cache_memory() const override;
+
+  //! \brief Adds the memory allocated by the Embree device, measured with a
+  //! device memory monitor, and the primitive references to the report
+  void memory_report(MemoryReport& report) const override;
+
+  //! \brief Primitive references and measured BVH memory of a surface tree
+  size_t surface_tree_memory(SurfaceTreeID tree) const override;
+
+  bool surface_tree_memory_measured(SurfaceTreeID tree) const override;
+
+  //! \brief Primitive references and measured BVH memory of an element tree
+  size_t element_tree_memory(ElementTreeID tree) const override;
+
+  bool element_tree_memory_measured(ElementTreeID tree) const override;
+
+  void build_pending_trees() override;
 
   std::pair<TreeID, TreeID> register_volume(const std::shared_ptr<MeshManager>& mesh_manager, MeshID volume) override;
 
@@ -36,16 +66,31 @@ public:
 
   void create_global_element_tree() override;
 
+  void unregister_volume(TreeID surface_tree, TreeID element_tree) override;
+
   MeshID find_element(const Position& point) const override;
 
   MeshID find_element(TreeID tree, const Position& point) const override;
 
+  //! \brief Locates points in parallel using up to XDGConfig::n_threads() threads
+  void find_element_batch(TreeID tree,
+                          const std::vector<Position>& points,
+                          std::vector<MeshID>& elements) const override;
+  using RayTracer::find_element_batch;
+
 
   // Query Methods
   bool point_in_volume(TreeID scene,
                       const Position& point,
                       const Direction* direction = nullptr,
-                      const std::vector<MeshID>* exclude_primitives = nullptr) const override;
+                      const PrimitiveExclusionSet* exclude_primitives = nullptr) const override;
+  using RayTracer::point_in_volume;
+
+  //! \brief Traces ray packets of the native width in parallel using up to XDGConfig::n_threads() threads
+  void point_in_volume_batch(TreeID scene,
+                             const std::vector<Position>& points,
+                             std::vector<uint8_t>& results,
+                             const std::vector<Direction>& directions = {}) const override;
 
 
   std::pair<double, MeshID> ray_fire(TreeID scene,
@@ -53,10 +98,46 @@ public:
                                      const Direction& direction,
                                      const double dist_limit = INFTY,
                                      HitOrientation orientation = HitOrientation::EXITING,
-                                     std::vector<MeshID>* const exclude_primitives = nullptr) override;
+                                     PrimitiveExclusionSet* const exclude_primitives = nullptr) override;
+  using RayTracer::ray_fire;
+
+  HitRecord ray_fire_record(TreeID scene,
+                            const Position& origin,
+                            const Direction& direction,
+                            const double dist_limit = INFTY,
+                            HitOrientation orientation = HitOrientation::EXITING,
+                            PrimitiveExclusionSet* const exclude_primitives = nullptr) override;
+
+  void surface_crossings(TreeID scene,
+                         const Position& origin,
+                         const Direction& direction,
+                         std::vector<RayCrossing>& crossings,
+                         double dist_limit = INFTY,
+                         int max_crossings = -1) const override;
+  using RayTracer::surface_crossings;
+
+  //! \brief Traces ray packets of the native width in parallel using up to XDGConfig::n_threads() threads.
+  //! Each ray's exclusion set must not be shared with another ray of the batch
+  void ray_fire_batch(TreeID scene,
+                      const std::vector<Position>& origins,
+                      const std::vector<Direction>& directions,
+                      const std::vector<double>& dist_limits,
+                      std::vector<std::pair<double, MeshID>>& hits,
+                      HitOrientation orientation = HitOrientation::EXITING,
+                      const std::vector<PrimitiveExclusionSet*>& exclude_primitives = {}) override;
+  using RayTracer::ray_fire_batch;
+
+  //! \brief Width of the ray packets used by ray_fire_batch (1 if packets are not natively supported)
+  int packet_width() const { return packet_width_; }
 
   std::pair<double, MeshID> closest(TreeID scene,
-                                    const Position& origin) override;
+                                    const Position& origin,
+                                    double max_radius = INFTY) override;
+
+  void closest_distance_batch(TreeID scene,
+                              const std::vector<Position>& points,
+                              std::vector<double>& distances,
+                              double max_radius = INFTY) override;
 
   bool occluded(TreeID scene,
                 const Position& origin,
@@ -74,8 +155,30 @@ public:
   std::unordered_map<RTCGeometry, std::shared_ptr<SurfaceUserData>> surface_user_data_map_;
   std::unordered_map<RTCGeometry, std::shared_ptr<VolumeElementsUserData>> volume_user_data_map_;
 
-  std::unordered_map<SurfaceTreeID, RTCScene> surface_volume_tree_to_scene_map_; // Map from SurfaceVolumeTreeID to specific embree scene/tree
-  std::unordered_map<ElementTreeID, RTCScene> element_volume_tree_to_scene_map_; // Map from ElementVolumeTreeID to specific embree scene/tree
+  // Tree IDs are assigned sequentially, so scenes are stored in dense tables
+  // indexed by TreeID to avoid hashing on every query. Entries of released
+  // trees are null
+  std::vector<RTCScene> surface_tree_scenes_; //<! Embree scene of each SurfaceTreeID
+  std::vector<RTCScene> element_tree_scenes_; //<! Embree scene of each ElementTreeID
+
+  //! \brief Embree scene of a surface tree, fatal error if the tree doesn't exist
+  RTCScene surface_scene(SurfaceTreeID tree) const {
+    if (tree < 0 || tree >= static_cast<TreeID>(surface_tree_scenes_.size()) || !surface_tree_scenes_[tree])
+      fatal_error("Surface tree {} does not exist", tree);
+    return surface_tree_scenes_[tree];
+  }
+
+  //! \brief Embree scene of an element tree, nullptr if the tree doesn't exist
+  RTCScene element_scene(ElementTreeID tree) const {
+    if (tree < 0 || tree >= static_cast<TreeID>(element_tree_scenes_.size())) return nullptr;
+    return element_tree_scenes_[tree];
+  }
+
+  //! \brief Set the scene of a tree in one of the scene tables
+  static void set_tree_scene(std::vector<RTCScene>& scenes, TreeID tree, RTCScene scene) {
+    if (tree >= static_cast<TreeID>(scenes.size())) scenes.resize(tree + 1, nullptr);
+    scenes[tree] = scene;
+  }
 
   // storage
   std::unordered_map<RTCScene, std::vector<PrimitiveRef>> primitive_ref_storage_;
@@ -85,6 +188,82 @@ private:
                                                                              MeshID surface,
                                                                              RTCScene& volume_scene,
                                                                              int& storage_offset);
+  // create a native Embree triangle geometry from the surface mesh
+  RTCGeometry create_triangle_geometry(const std::shared_ptr<MeshManager>& mesh_manager,
+                                       MeshID surface);
+
+  // fire a single ray from within the volume of a surface tree
+  void fire_volume_ray(SurfaceTreeID tree,
+                       const Position& origin,
+                       const Direction& direction,
+                       const double dist_limit,
+                       HitOrientation orientation,
+                       const PrimitiveExclusionSet* exclude_primitives,
+                       RTCDualRayHit& rayhit) const;
+
+  template<int N>
+  void ray_fire_packets(RTCScene scene,
+                        TreeID tree,
+                        const std::vector<Position>& origins,
+                        const std::vector<Direction>& directions,
+                        const std::vector<double>& dist_limits,
+                        std::vector<std::pair<double, MeshID>>& hits,
+                        HitOrientation orientation,
+                        const std::vector<PrimitiveExclusionSet*>& exclude_primitives);
+
+  template<int N>
+  void point_in_volume_packets(RTCScene scene,
+                               TreeID tree,
+                               const std::vector<Position>& points,
+                               std::vector<uint8_t>& results,
+                               const std::vector<Direction>& directions) const;
+
+  // commit a scene now, or queue it for build_pending_trees if builds are deferred
+  void commit_scene(RTCScene scene);
+
+  // build the BVH of a scene, recording the device memory it allocates
+  void build_scene(RTCScene scene);
+
+  // release a scene, removing it from the pending builds
+  void release_scene(RTCScene scene);
+
+  // primitive references and measured BVH memory of a scene
+  size_t scene_memory(RTCScene scene) const;
+
+  // whether the BVH memory of a scene was measured when it was committed
+  bool scene_memory_measured(RTCScene scene) const;
+
+  // partition scenes into groups whose scenes share no geometries
+  std::vector<std::vector<RTCScene>> commit_groups(const std::vector<RTCScene>& scenes) const;
+
+  // release the global surface and element trees
+  void release_global_trees();
+
+  int packet_width_ {1}; //<! Widest ray packet natively supported by the Embree device
+
+  std::vector<RTCScene> pending_scenes_; //<! Scenes awaiting a deferred commit
+
+  // free retired primitive references no longer used by any surface
+  void release_retired_storage();
+
+  //! Primitive references of unregistered surface trees. Surfaces first
+  //! registered with an unregistered volume may still be in use by the volume
+  //! on their other side. Storage is freed once those surfaces are released
+  std::vector<std::vector<PrimitiveRef>> retired_primitive_ref_storage_;
+
+  std::array<BuildProfile, 3> build_profiles_; //<! Build profile for each TreeType
+
+  std::atomic<int64_t> device_bytes_ {0}; //<! Bytes currently allocated by the Embree device
+
+  //! BVH bytes of each committed scene, measured as the change in device
+  //! memory over its commit. Scenes committed concurrently with another
+  //! scene can't be separated and are not recorded (see
+  //! XDGConfig::measure_tree_memory)
+  std::unordered_map<RTCScene, size_t> scene_bvh_bytes_;
+  mutable std::mutex commit_mutex_; //<! Guards the members below and scene_bvh_bytes_
+  int commits_in_flight_ {0}; //<! Number of scenes currently being committed
+  uint64_t commits_started_ {0}; //<! Number of commits started, used to detect overlapping commits
+
   // Global Tree IDs
   RTCScene global_surface_scene_ {nullptr};
   RTCScene global_element_scene_ {nullptr};
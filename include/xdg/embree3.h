@@ -22,4 +22,28 @@ inline void rtcOccluded1(RTCScene scene, RTCRay* ray) {
   }
 }
 
+inline void rtcIntersect4(const int* valid, RTCScene scene, RTCRayHit4* rayhit) {
+  {
+    RTCIntersectContext context;
+    rtcInitIntersectContext(&context);
+    rtcIntersect4(valid, scene, &context, rayhit);
+  }
+}
+
+inline void rtcIntersect8(const int* valid, RTCScene scene, RTCRayHit8* rayhit) {
+  {
+    RTCIntersectContext context;
+    rtcInitIntersectContext(&context);
+    rtcIntersect8(valid, scene, &context, rayhit);
+  }
+}
+
+inline void rtcIntersect16(const int* valid, RTCScene scene, RTCRayHit16* rayhit) {
+  {
+    RTCIntersectContext context;
+    rtcInitIntersectContext(&context);
+    rtcIntersect16(valid, scene, &context, rayhit);
+  }
+}
+
 #endif // include guard
\ No newline at end of file
@@ -1,7 +1,12 @@
 #ifndef _XDG_GEOMETRY_DATA_H
 #define _XDG_GEOMETRY_DATA_H
 
+#include <array>
+#include <limits>
+#include <vector>
+
 #include "xdg/constants.h"
+#include "xdg/vec3da.h"
 
 namespace xdg
 {
@@ -9,6 +14,114 @@ namespace xdg
 struct MeshManager; // Forward declaration
 struct PrimitiveRef; // Forward declaration
 
+/*! Packed copy of the triangle vertices and normals of a surface, stored as
+    structure-of-arrays (v0x[n], v0y[n], v0z[n], v1x[n], ..., nz[n]) and
+    indexed by the primitive's position in the surface geometry. Lets the
+    intersection callbacks read coordinates directly instead of going through
+    the MeshManager.
+ */
+struct TriangleCache {
+  static constexpr size_t N_COMPONENTS {12}; //! 3 vertices + normal, 3 components each
+
+  //! Reserve storage for n triangles
+  void resize(size_t n) {
+    n_triangles = n;
+    data.resize(N_COMPONENTS * n);
+  }
+
+  //! Store the vertices and normal of triangle i
+  void set(size_t i, const std::array<Vertex, 3>& vertices, const Direction& normal) {
+    for (int v = 0; v < 3; v++)
+      for (int c = 0; c < 3; c++)
+        data[(3 * v + c) * n_triangles + i] = vertices[v][c];
+    for (int c = 0; c < 3; c++)
+      data[(9 + c) * n_triangles + i] = normal[c];
+  }
+
+  std::array<Vertex, 3> vertices(size_t i) const {
+    const double* d = data.data() + i;
+    const size_t n = n_triangles;
+    return {Vertex(d[0], d[n], d[2 * n]),
+            Vertex(d[3 * n], d[4 * n], d[5 * n]),
+            Vertex(d[6 * n], d[7 * n], d[8 * n])};
+  }
+
+  Direction normal(size_t i) const {
+    const double* d = data.data() + 9 * n_triangles + i;
+    return {d[0], d[n_triangles], d[2 * n_triangles]};
+  }
+
+  bool empty() const { return n_triangles == 0; }
+
+  //! Memory used by the cache in bytes
+  size_t memory() const { return data.capacity() * sizeof(double); }
+
+  size_t n_triangles {0}; //! Number of triangles in the cache
+  std::vector<double> data; //! SoA vertex and normal components
+};
+
+/*! Precomputed barycentric transform of each tetrahedron in an element tree,
+    stored as structure-of-arrays (r0x[n], r0y[n], ..., r2z[n], v0x[n], v0y[n],
+    v0z[n]) and indexed by the primitive's position in the element geometry.
+    Rows r0-r2 are the inverse of the matrix [v1 - v0, v2 - v0, v3 - v0], so
+    barycentric coordinates follow from a single matrix-vector product
+    without querying the MeshManager.
+ */
+struct TetTransformCache {
+  static constexpr size_t N_COMPONENTS {12}; //! 3 inverse rows + first vertex, 3 components each
+
+  //! Reserve storage for n tetrahedra
+  void resize(size_t n) {
+    n_tets = n;
+    data.resize(N_COMPONENTS * n);
+  }
+
+  //! Store the transform of tetrahedron i
+  void set(size_t i, const std::array<Vertex, 4>& vertices) {
+    Vertex e0 = vertices[1] - vertices[0];
+    Vertex e1 = vertices[2] - vertices[0];
+    Vertex e2 = vertices[3] - vertices[0];
+    std::array<Vertex, 3> rows {e1.cross(e2), e2.cross(e0), e0.cross(e1)};
+    double det = e0.dot(rows[0]);
+    // degenerate elements contain no points, NaN coordinates fail all containment checks
+    double inv_det = det != 0.0 ? 1.0 / det : std::numeric_limits<double>::quiet_NaN();
+    for (int r = 0; r < 3; r++)
+      for (int c = 0; c < 3; c++)
+        data[(3 * r + c) * n_tets + i] = rows[r][c] * inv_det;
+    for (int c = 0; c < 3; c++)
+      data[(9 + c) * n_tets + i] = vertices[0][c];
+  }
+
+  //! Barycentric coordinates of a point with respect to tetrahedron i
+  std::array<double, 4> barycentric(size_t i, const Position& point) const {
+    const double* d = data.data() + i;
+    const size_t n = n_tets;
+    double px = point.x - d[9 * n];
+    double py = point.y - d[10 * n];
+    double pz = point.z - d[11 * n];
+    double l1 = d[0] * px + d[n] * py + d[2 * n] * pz;
+    double l2 = d[3 * n] * px + d[4 * n] * py + d[5 * n] * pz;
+    double l3 = d[6 * n] * px + d[7 * n] * py + d[8 * n] * pz;
+    return {1.0 - (l1 + l2 + l3), l1, l2, l3};
+  }
+
+  //! Whether a point is inside or on the boundary of tetrahedron i
+  bool contains(size_t i, const Position& point) const {
+    for (double b : barycentric(i, point)) {
+      if (!(b >= -PLUCKER_ZERO_TOL && b <= 1.0 + PLUCKER_ZERO_TOL)) return false;
+    }
+    return true;
+  }
+
+  bool empty() const { return n_tets == 0; }
+
+  //! Memory used by the cache in bytes
+  size_t memory() const { return data.capacity() * sizeof(double); }
+
+  size_t n_tets {0}; //! Number of tetrahedra in the cache
+  std::vector<double> data; //! SoA inverse matrix and vertex components
+};
+
 struct SurfaceUserData {
   MeshID surface_id {ID_NONE}; //! ID of the surface this geometry data is associated with
   MeshManager* mesh_manager {nullptr}; //! Pointer to the mesh manager for this geometry
@@ -16,12 +129,16 @@ struct SurfaceUserData {
   double box_bump; //! Bump distance for the bounding boxes in this geometry
   MeshID forward_vol {ID_NONE}; // ID of the forward sense volume
   MeshID reverse_vol {ID_NONE}; // ID of the reverse sense volume
+  MeshID forward_parent {ID_NONE}; //! Mesh ID of the forward sense volume
+  MeshID reverse_parent {ID_NONE}; //! Mesh ID of the reverse sense volume
+  TriangleCache triangle_cache; //! Packed triangle data, empty unless the triangle cache is enabled
 };
 
 struct VolumeElementsUserData {
   MeshID volume_id {ID_NONE}; //! ID of the volume this geometry data is associated with
   MeshManager* mesh_manager {nullptr}; //! Pointer to the mesh manager for this geometry
   PrimitiveRef* prim_ref_buffer {nullptr}; //! Pointer to the mesh primitives in the geometry
+  TetTransformCache transform_cache; //! Per-element barycentric transforms, empty unless the transform cache is enabled
 };
 
 } // namespace xdg
@@ -90,17 +90,20 @@ class GPRTRayTracer : public RayTracer {
     bool point_in_volume(TreeID scene,
                         const Position& point,
                         const Direction* direction = nullptr,
-                        const std::vector<MeshID>* exclude_primitives = nullptr) const override;
+                        const PrimitiveExclusionSet* exclude_primitives = nullptr) const override;
+    using RayTracer::point_in_volume;
 
     std::pair<double, MeshID> ray_fire(TreeID scene,
                                       const Position& origin,
                                       const Direction& direction,
                                       const double dist_limit = INFTY,
                                       HitOrientation orientation = HitOrientation::EXITING,
-                                      std::vector<MeshID>* const exclude_primitives = nullptr) override;
+                                      PrimitiveExclusionSet* const exclude_primitives = nullptr) override;
+    using RayTracer::ray_fire;
 
     std::pair<double, MeshID> closest(TreeID scene,
-                                      const Position& origin) override {};
+                                      const Position& origin,
+                                      double max_radius = INFTY) override {};
 
     bool occluded(TreeID scene,
                   const Position& origin,
@@ -5,7 +5,6 @@
 #include <memory>
 
 #include "xdg/constants.h"
-#include "xdg/element_face_accessor.h"
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/error.h"
 
@@ -60,6 +59,10 @@ public:
 
   void parse_metadata() override;
 
+  //! \brief Adds the surface and sidepair maps to the base mesh manager
+  //! report. The memory of the libMesh mesh itself is not included
+  void memory_report(MemoryReport& report) const override;
+
   int num_volumes() const override { return volumes_.size(); }
 
   int num_surfaces() const override { return surfaces_.size(); }
@@ -108,6 +111,10 @@ public:
 
   std::array<Vertex, 3> face_vertices(MeshID triangle) const override;
 
+  std::array<Vertex, 4> tet_vertices(MeshID element) const override;
+
+  const std::array<std::array<int, 3>, 4>& tet_face_ordering() const override;
+
   std::vector<MeshID> get_volume_surfaces(MeshID volume) const override;
 
   SurfaceElementType get_surface_element_type(MeshID surface) const override
@@ -344,32 +351,6 @@ public:
   int32_t next_sidepair_id_ {1}; //!< Next available sidepair ID, starts at one
 };
 
-struct LibMeshElementFaceAccessor : public ElementFaceAccessor {
-
-  LibMeshElementFaceAccessor(const LibMeshManager* mesh_manager, MeshID element) :
-  ElementFaceAccessor(element), mesh_manager_(mesh_manager) {
-    mesh_ = mesh_manager_->mesh();
-    elem_ptr_ = mesh_->elem_ptr(element);
-    tet_ = (const libMesh::Tet4*)elem_ptr_;
-  }
-
-  std::array<Vertex, 3> face_vertices(int i) const override {
-    std::array<Vertex, 3> coords;
-    for (int j = 0; j < 3; j++) {
-      const auto node_ptr = elem_ptr_->node_ptr(tet_->side_nodes_map[i][j]);
-      coords[j] = {(*node_ptr)(0), (*node_ptr)(1), (*node_ptr)(2)};
-    }
-    return std::move(coords);
-  }
-
-  // data members
-  const LibMeshManager* mesh_manager_;
-  const libMesh::MeshBase* mesh_;
-  const libMesh::Tet4* tet_;
-  const libMesh::Elem* elem_ptr_;
-};
-
-
 } // namespace xdg
 
 #endif // include guard
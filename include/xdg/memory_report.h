@@ -0,0 +1,72 @@
+#ifndef _XDG_MEMORY_REPORT_H
+#define _XDG_MEMORY_REPORT_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xdg/constants.h"
+
+namespace xdg {
+
+/*! Memory held by XDG, broken down by subsystem and by volume. Subsystem
+    names are prefixed by their owner ("mesh/", "ray_tracer/" or "xdg/").
+    Sizes of hash maps and of structures owned by external libraries are
+    estimates; see the individual memory_report methods.
+ */
+struct MemoryReport {
+  //! Bytes held by each subsystem in the order they were added
+  std::vector<std::pair<std::string, size_t>> subsystems;
+
+  //! Bytes of the ray tracing structures of each registered volume. These
+  //! are also included in the ray tracer subsystems
+  std::map<MeshID, size_t> volumes;
+
+  //! Volumes whose acceleration structure memory wasn't measured, their
+  //! entries in volumes only include the memory held by XDG
+  std::set<MeshID> unmeasured_volumes;
+
+  //! \brief Add the bytes held by a subsystem
+  void add(const std::string& subsystem, size_t bytes) { subsystems.push_back({subsystem, bytes}); }
+
+  //! \brief Bytes held by a subsystem, 0 if it isn't in the report
+  size_t subsystem(const std::string& name) const;
+
+  //! \brief Total bytes of all subsystems
+  size_t total() const;
+
+  //! \brief Table of the subsystems and volumes
+  std::string to_string() const;
+};
+
+//! \brief Estimated bytes held by an unordered map, including its buckets
+//! and nodes but not memory owned by its keys or values
+template<typename Map>
+size_t unordered_map_memory(const Map& map)
+{
+  // each node holds the value, a next pointer and possibly a cached hash
+  return map.bucket_count() * sizeof(void*) +
+         map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*));
+}
+
+//! \brief Estimated bytes held by an ordered map, not including memory owned
+//! by its keys or values
+template<typename Map>
+size_t ordered_map_memory(const Map& map)
+{
+  // each node holds the value, three pointers and a color
+  return map.size() * (sizeof(typename Map::value_type) + 4 * sizeof(void*));
+}
+
+//! \brief Bytes held by a vector's allocation
+template<typename T>
+size_t vector_memory(const std::vector<T>& vec)
+{
+  return vec.capacity() * sizeof(T);
+}
+
+} // namespace xdg
+
+#endif // include guard
@@ -12,6 +12,8 @@
 #include "xdg/bbox.h"
 #include "xdg/constants.h"
 #include "xdg/id_block_map.h"
+#include "xdg/memory_report.h"
+#include "xdg/tet_topology.h"
 #include "xdg/vec3da.h"
 
 namespace xdg {
@@ -60,6 +62,25 @@ public:
                 const Direction& u,
                 double distance) const;
 
+  //! \brief Walk through elements along a ray, passing each segment to a visitor
+  //! instead of collecting the segments
+  //! \note It is assumed that the provided position is within the starting element.
+  //! \param starting_element The initial element to start the walk from
+  //! \param start The starting position of the ray
+  //! \param u The normalized direction vector of the ray
+  //! \param distance The total distance to travel along the ray
+  //! \param on_segment Visitor called with the element ID, distance traveled
+  //!        and optionally the element index of each element (see visit_segment)
+  //! \return Pair containing the element following the last segment (ID_NONE if
+  //!         the walk left the mesh) and the total distance traveled
+  template<typename F>
+  std::pair<MeshID, double>
+  walk_elements(MeshID starting_element,
+                const Position& start,
+                const Direction& u,
+                double distance,
+                F&& on_segment) const;
+
   //! \brief Find the next element along a ray from the current position.
   //! \note It is assumed that the provided position is within the element.
   //! \param current_element The current element being traversed
@@ -71,6 +92,33 @@ public:
                const Position& r,
                const Position& u) const;
 
+  //! \brief Locate the element containing a point by walking element
+  //! adjacencies from a nearby element.
+  //! \param hint_element The element to start the walk from
+  //! \param point The point to locate
+  //! \param max_steps Maximum number of elements visited by the walk
+  //! \return The element strictly containing the point, or ID_NONE if the
+  //!          walk leaves the mesh, reaches the step limit or the point is on
+  //!          an element boundary
+  MeshID locate_element(MeshID hint_element,
+                        const Position& point,
+                        int max_steps) const;
+
+  //! \brief Build the flat, index-addressed tetrahedral topology used by
+  //! walk_elements and next_element.
+  //! \note Called by init() for mesh libraries that support it. Requires the
+  //! element and vertex ID mappings to be set up.
+  //! \param face_ordering Local vertex indices of each element face, ordered
+  //! consistently with adjacent_element and with outward facing normals
+  void build_tet_topology(const std::array<std::array<int, 3>, 4>& face_ordering);
+
+  //! \brief Accessor for the flat tetrahedral topology (empty if not built)
+  const TetTopology& tet_topology() const { return tet_topology_; }
+
+  //! \brief Discard the flat tetrahedral topology, reverting element walks to
+  //! MeshManager queries
+  void clear_tet_topology() { tet_topology_.clear(); }
+
   // Mesh
   virtual int num_vertices() const = 0;
 
@@ -97,6 +145,14 @@ public:
 
   virtual std::array<Vertex, 3> face_vertices(MeshID element) const = 0;
 
+  //! \brief Return the coordinates of the four vertices of a tetrahedral element
+  //! without allocating. The default implementation copies from element_vertices.
+  virtual std::array<Vertex, 4> tet_vertices(MeshID element) const;
+
+  //! \brief Local vertex indices of each tetrahedron face, ordered so that face
+  //! normals point outward and face i is shared with adjacent_element(element, i)
+  virtual const std::array<std::array<int, 3>, 4>& tet_face_ordering() const = 0;
+
   std::vector<Vertex> get_surface_vertices(MeshID surface) const;
 
   //! \brief Return a vertex ID given its index in the mesh
@@ -209,6 +265,10 @@ public:
 
   virtual MeshLibrary mesh_library() const = 0;
 
+  //! \brief Add the memory held by the mesh manager to a report. Mesh
+  //! libraries add the memory of their own data structures
+  virtual void memory_report(MemoryReport& report) const;
+
 protected:
 
   // metadata
@@ -224,6 +284,9 @@ protected:
   //! Block ID mapping from vertex IDs to contiguous index space
   IDBlockMapping<MeshID> vertex_id_map_;
 
+  //! Flat tetrahedral topology addressed by element/vertex index
+  TetTopology tet_topology_;
+
   // TODO: attempt to remove this attribute
   MeshID implicit_complement_ {ID_NONE};
 
@@ -302,6 +365,45 @@ private:
   LocalMeshData volume_local_mesh_data(MeshID volume) const;
 };
 
+template<typename F>
+std::pair<MeshID, double>
+MeshManager::walk_elements(MeshID starting_element,
+                           const Position& start,
+                           const Direction& u,
+                           double distance,
+                           F&& on_segment) const
+{
+  // walk in element index space if the flat topology is available
+  if (!tet_topology_.empty()) {
+    auto [next, traveled] = tet_topology_.walk(element_index(starting_element), start, u, distance, on_segment);
+    return {next == INDEX_NONE ? ID_NONE : tet_topology_.element_ids[next], traveled};
+  }
+
+  // a copy of the start position that will be updated as elements are traversed
+  Position r = start;
+  double traveled = 0.0;
+  MeshID elem = starting_element;
+  while (distance > 0) {
+    // find the exit point from the current element and determine the next element
+    // if one exists
+    auto exit = next_element(elem, r, u);
+    // ensure we are not traveling beyond the end of the ray
+    exit.second = std::min(exit.second, distance);
+    distance -= exit.second;
+    traveled += exit.second;
+    MeshIndex index = INDEX_NONE;
+    if constexpr (visits_element_index<F>) index = element_index(elem);
+    bool proceed = visit_segment(on_segment, elem, exit.second, index);
+    r += exit.second * u;
+    elem = exit.first;
+
+    // if there is no next element, we're exiting the mesh
+    if (elem == ID_NONE || !proceed) break;
+  }
+
+  return {elem, traveled};
+}
+
 } // namespace xdg
 
 #endif
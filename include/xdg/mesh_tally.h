@@ -0,0 +1,130 @@
+#ifndef _XDG_MESH_TALLY_H
+#define _XDG_MESH_TALLY_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "xdg/constants.h"
+#include "xdg/mesh_manager_interface.h"
+#include "xdg/vec3da.h"
+
+namespace xdg {
+
+class XDG;
+
+/*! Track length tally over the volume elements of a mesh. Scores are
+    accumulated in flat arrays addressed by element index (see
+    MeshManager::element_index) so that scoring requires no hashing or
+    allocation. Concurrent scoring is supported with each of the
+    TallyAccumulation strategies:
+
+    - THREAD_PRIVATE: one array per thread, n_threads() times the memory of a
+      single array, no synchronization while scoring
+    - ATOMIC: one shared array updated with atomic compare-and-swap
+    - STRIPED_LOCK: one shared array, elements are guarded by a fixed number
+      of locks assigned round-robin by element index
+
+    Accumulated scores are combined, and optionally normalized by element
+    volume, by finalize().
+ */
+class MeshTally {
+public:
+  //! Number of locks used by the STRIPED_LOCK strategy
+  static constexpr MeshIndex N_LOCK_STRIPES {256};
+
+  //! \param mesh_manager The mesh the tally is defined on
+  //! \param accumulation Strategy used to accumulate scores from concurrent threads
+  //! \param n_threads Maximum number of threads scoring concurrently. Defaults
+  //!        to XDGConfig::n_threads() if not positive
+  MeshTally(std::shared_ptr<MeshManager> mesh_manager,
+            TallyAccumulation accumulation = TallyAccumulation::THREAD_PRIVATE,
+            int n_threads = -1);
+
+  //! \brief Score a track length in an element
+  //! \param element The ID of the element
+  //! \param length The track length in the element
+  //! \param thread Index of the scoring thread, must be less than n_threads()
+  void score(MeshID element, double length, int thread = 0)
+  { score_index(mesh_manager_->element_index(element), length, thread); }
+
+  //! \brief Score a track length in an element by element index
+  //! \see score
+  void score_index(MeshIndex index, double length, int thread = 0)
+  {
+    switch (accumulation_) {
+      case TallyAccumulation::THREAD_PRIVATE:
+        thread_scores_[thread][index] += length;
+        break;
+      case TallyAccumulation::ATOMIC: {
+        std::atomic<double>& score = atomic_scores_[index];
+        double current = score.load(std::memory_order_relaxed);
+        while (!score.compare_exchange_weak(current, current + length, std::memory_order_relaxed));
+        break;
+      }
+      case TallyAccumulation::STRIPED_LOCK: {
+        std::lock_guard<std::mutex> lock(stripes_[index % N_LOCK_STRIPES].mutex);
+        shared_scores_[index] += length;
+        break;
+      }
+    }
+  }
+
+  //! \brief Score the segments of a track from start to end
+  //! \param thread Index of the scoring thread, must be less than n_threads()
+  void score_track(const XDG& xdg,
+                   const Position& start,
+                   const Position& end,
+                   int thread = 0);
+
+  //! \brief Score a set of (start, end) tracks using up to n_threads() threads
+  void score_tracks(const XDG& xdg,
+                    const std::vector<std::pair<Position, Position>>& tracks);
+
+  //! \brief Combine the accumulated scores into results()
+  //! \param normalize Whether the score of each element is divided by the element's volume
+  void finalize(bool normalize = true);
+
+  //! \brief Discard all accumulated scores and results
+  void reset();
+
+  //! \brief Results of the last call to finalize, addressed by element index
+  const std::vector<double>& results() const { return results_; }
+
+  //! \brief Result of the last call to finalize for an element
+  double result(MeshID element) const
+  { return results_.at(mesh_manager_->element_index(element)); }
+
+  // Accessors
+  TallyAccumulation accumulation() const { return accumulation_; }
+
+  int n_threads() const { return n_threads_; }
+
+  MeshIndex n_elements() const { return n_elements_; }
+
+  //! \brief Memory used by the score and result arrays in bytes
+  size_t memory() const;
+
+private:
+  //! Lock of the STRIPED_LOCK strategy, padded to avoid false sharing between locks
+  struct alignas(64) LockStripe {
+    std::mutex mutex;
+  };
+
+  // Data members
+  std::shared_ptr<MeshManager> mesh_manager_; //!< Mesh the tally is defined on
+  TallyAccumulation accumulation_; //!< Strategy used to accumulate scores
+  int n_threads_ {1}; //!< Maximum number of threads scoring concurrently
+  MeshIndex n_elements_ {0}; //!< Number of elements in the mesh
+  std::vector<std::vector<double>> thread_scores_; //!< Scores of each thread (THREAD_PRIVATE)
+  std::vector<std::atomic<double>> atomic_scores_; //!< Shared scores (ATOMIC)
+  std::vector<double> shared_scores_; //!< Shared scores (STRIPED_LOCK)
+  std::vector<LockStripe> stripes_; //!< Locks guarding the shared scores (STRIPED_LOCK)
+  std::vector<double> results_; //!< Combined scores of the last finalize
+};
+
+} // namespace xdg
+
+#endif // include guard
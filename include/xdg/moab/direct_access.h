@@ -10,6 +10,7 @@
 
 #include "xdg/constants.h"
 #include "xdg/id_block_map.h"
+#include "xdg/memory_report.h"
 #include "xdg/vec3da.h"
 
 
@@ -33,6 +34,10 @@ public:
   //! \brief Update internal data structures to account for changes in the MOAB instance
   void update();
 
+  //! \brief Estimated bytes held by the direct access structures, not including
+  //! the MOAB connectivity and coordinate arrays they point into
+  size_t memory() const;
+
   //! \brief Check that a triangle is part of the managed coordinates here
   inline bool accessible(EntityHandle tri) {
     // determine the correct contiguous memory block index to use
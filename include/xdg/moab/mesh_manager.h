@@ -5,7 +5,6 @@
 #include <unordered_map>
 
 #include "xdg/mesh_manager_interface.h"
-#include "xdg/element_face_accessor.h"
 #include "xdg/moab/direct_access.h"
 #include "xdg/moab/metadata.h"
 
@@ -80,6 +79,11 @@ public:
 
   std::array<Vertex, 3> face_vertices(MeshID face) const override;
 
+  std::array<Vertex, 4> tet_vertices(MeshID element) const override;
+
+  const std::array<std::array<int, 3>, 4>& tet_face_ordering() const override
+  { return tet_face_ordering_; }
+
   SurfaceElementType get_surface_element_type(MeshID surface) const override;
 
   MeshID adjacent_element(MeshID element, int face) const override;
@@ -96,6 +100,10 @@ public:
   // Metadata
   void parse_metadata() override;
 
+  //! \brief Adds MOAB's estimate of its own memory and the direct access
+  //! structures to the base mesh manager report
+  void memory_report(MemoryReport& report) const override;
+
 private:
   // Internal MOAB methods
 
@@ -199,6 +207,9 @@ private:
   // Maps elements to their volume ID
   std::unordered_map<MeshID, MeshID> element_volume_ids_;
 
+  // MOAB's canonical face ordering for tetrahedra
+  std::array<std::array<int, 3>, 4> tet_face_ordering_;
+
   // tag handles
   moab::Tag geometry_dimension_tag_;
   moab::Tag global_id_tag_;
@@ -210,33 +221,6 @@ private:
   inline static const std::string metadata_delimiters = ":";
 };
 
-struct MOABElementFaceAccessor : public ElementFaceAccessor {
-
-  MOABElementFaceAccessor(const MOABMeshManager* mesh_manager, MeshID element) :
-  ElementFaceAccessor(element), mesh_manager_(mesh_manager), element_ordering_(mesh_manager->mb_direct()->get_face_ordering(moab::MBTET)) {
-
-    auto moab_mesh_manager = dynamic_cast<const MOABMeshManager*>(mesh_manager);
-    if (!moab_mesh_manager) {
-      throw std::runtime_error("MOABElementFaceAccessor requires a MOABMeshManager");
-    }
-    mesh_manager_ = moab_mesh_manager;
-    element_coordinates_ = mesh_manager_->element_vertices(element);
-  }
-
-  std::array<Vertex, 3> face_vertices(int i) const override {
-    std::array<Vertex, 3> verts;
-    for (int j = 0; j < 3; j++) {
-      verts[j] = element_coordinates_[element_ordering_[i][j]];
-    }
-    return std::move(verts);
-  }
-
-  // data members
-  const MOABMeshManager* mesh_manager_;
-  std::vector<Vertex> element_coordinates_;
-  const std::vector<std::vector<int>>& element_ordering_;
-};
-
 } // namespace xdg
 
 #endif
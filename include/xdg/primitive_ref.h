@@ -15,6 +15,8 @@ void TriangleIntersectionFunc(RTCIntersectFunctionNArguments* args);
 void TriangleBoundsFunc(RTCBoundsFunctionArguments* args);
 void TriangleOcclusionFunc(RTCOccludedFunctionNArguments* args);
 bool TriangleClosestFunc(RTCPointQueryFunctionArguments* args);
+void TriangleIntersectionFilterFunc(RTCFilterFunctionNArguments* args);
+void TriangleOcclusionFilterFunc(RTCFilterFunctionNArguments* args);
 
 } // namespace xdg
 
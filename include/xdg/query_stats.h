@@ -0,0 +1,132 @@
+#ifndef _XDG_QUERY_STATS_H
+#define _XDG_QUERY_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "fmt/format.h"
+
+namespace xdg {
+
+// Events counted in the hot paths of geometric queries
+enum class QueryCounter {
+  RAYS,              // rays fired against a surface tree, including each active lane of a packet
+  PRIMITIVE_TESTS,   // candidate surface elements tested in double precision
+  HITS,              // candidate surface elements accepted as hits
+  ORIENTATION_CULLS, // hits rejected by the hit orientation of the query
+  EXCLUSION_CULLS,   // hits rejected because the element is in the exclusion set
+  FALSE_CANDIDATES,  // candidates from the (bumped) bounding boxes that the ray misses
+  CLOSEST_QUERIES,   // closest surface element queries
+  CLOSEST_TESTS,     // surface elements tested by closest queries
+  ELEMENT_QUERIES,   // point location queries against an element tree
+  ELEMENT_TESTS,     // candidate volume elements tested for containment
+  TET_STEPS,         // steps from one volume element to the next along a ray
+  N_COUNTERS
+};
+
+static const std::map<QueryCounter, std::string> QUERY_COUNTER_TO_STR =
+{
+  {QueryCounter::RAYS, "rays"},
+  {QueryCounter::PRIMITIVE_TESTS, "primitive_tests"},
+  {QueryCounter::HITS, "hits"},
+  {QueryCounter::ORIENTATION_CULLS, "orientation_culls"},
+  {QueryCounter::EXCLUSION_CULLS, "exclusion_culls"},
+  {QueryCounter::FALSE_CANDIDATES, "false_candidates"},
+  {QueryCounter::CLOSEST_QUERIES, "closest_queries"},
+  {QueryCounter::CLOSEST_TESTS, "closest_tests"},
+  {QueryCounter::ELEMENT_QUERIES, "element_queries"},
+  {QueryCounter::ELEMENT_TESTS, "element_tests"},
+  {QueryCounter::TET_STEPS, "tet_steps"}
+};
+
+constexpr size_t N_QUERY_COUNTERS {static_cast<size_t>(QueryCounter::N_COUNTERS)};
+
+//! Whether the library was built with query counters (XDG_ENABLE_QUERY_STATS).
+//! If not, the counters compile to nothing and all statistics are zero
+#ifdef XDG_ENABLE_QUERY_STATS
+constexpr bool QUERY_STATS_ENABLED {true};
+#else
+constexpr bool QUERY_STATS_ENABLED {false};
+#endif
+
+/*! Snapshot of the query counters of all threads */
+struct QueryStats {
+  std::array<uint64_t, N_QUERY_COUNTERS> counts {};
+
+  uint64_t operator[](QueryCounter counter) const { return counts[static_cast<size_t>(counter)]; }
+  uint64_t& operator[](QueryCounter counter) { return counts[static_cast<size_t>(counter)]; }
+
+  QueryStats& operator+=(const QueryStats& other) {
+    for (size_t i = 0; i < N_QUERY_COUNTERS; i++) counts[i] += other.counts[i];
+    return *this;
+  }
+};
+
+//! \brief Sum of the query counters of all threads, including threads that have exited
+QueryStats query_stats();
+
+//! \brief Zero the query counters of all threads. Counts of queries running
+//! concurrently with the reset may be partially kept
+void reset_query_stats();
+
+namespace detail {
+
+/*! Query counters of one thread. Only the owning thread writes its counters,
+    so increments are a relaxed load and store rather than an atomic
+    read-modify-write; other threads only read them to take a snapshot.
+    Counters register themselves on construction and fold their counts into
+    the totals of exited threads on destruction
+ */
+struct ThreadQueryCounters {
+  ThreadQueryCounters();
+  ~ThreadQueryCounters();
+
+  void add(QueryCounter counter, uint64_t n) {
+    auto& count = counts[static_cast<size_t>(counter)];
+    count.store(count.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  QueryStats snapshot() const;
+
+  void reset();
+
+  std::array<std::atomic<uint64_t>, N_QUERY_COUNTERS> counts {};
+};
+
+inline ThreadQueryCounters& thread_query_counters()
+{
+  thread_local ThreadQueryCounters counters;
+  return counters;
+}
+
+} // namespace detail
+
+} // namespace xdg
+
+//! Count n events of a QueryCounter on the calling thread. Compiles to
+//! nothing unless the library is built with XDG_ENABLE_QUERY_STATS
+#ifdef XDG_ENABLE_QUERY_STATS
+#define XDG_COUNT_QUERY_N(counter, n) \
+  ::xdg::detail::thread_query_counters().add(::xdg::QueryCounter::counter, (n))
+#else
+#define XDG_COUNT_QUERY_N(counter, n) ((void)0)
+#endif
+
+//! Count one event of a QueryCounter on the calling thread
+#define XDG_COUNT_QUERY(counter) XDG_COUNT_QUERY_N(counter, 1)
+
+namespace fmt {
+
+template<>
+struct formatter<xdg::QueryCounter> : fmt::formatter<std::string> {
+  auto format(xdg::QueryCounter counter, fmt::format_context& ctx) const {
+    return fmt::formatter<std::string>::format(xdg::QUERY_COUNTER_TO_STR.at(counter), ctx);
+  }
+};
+
+}
+
+#endif // include guard
@@ -2,7 +2,13 @@
 #ifndef _XDG_RAY_H
 #define _XDG_RAY_H
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
 #include <set>
+#include <unordered_set>
 #include <vector>
 
 #include "xdg/vec3da.h"
@@ -16,6 +22,156 @@ namespace xdg {
 // forward declaration
 class TriangleRef;
 
+/*! Result of a ray fire with everything needed to process a surface crossing */
+struct HitRecord {
+  double distance {INFTY}; //!< Distance to the hit
+  MeshID surface {ID_NONE}; //!< Surface that was hit
+  MeshID primitive {ID_NONE}; //!< Surface element that was hit
+  Direction normal {0.0, 0.0, 0.0}; //!< Normal of the hit element, pointing out of the volume the ray was fired in
+  MeshID next_volume {ID_NONE}; //!< Volume on the other side of the surface
+
+  bool hit() const { return surface != ID_NONE; }
+};
+
+/*! Surface crossing found by a multi-hit ray query */
+struct RayCrossing {
+  double distance {INFTY}; //!< Distance along the ray to the crossing
+  MeshID surface {ID_NONE}; //!< Surface that is crossed
+  MeshID primitive {ID_NONE}; //!< Surface element that is crossed
+  Sense sense {Sense::UNSET}; //!< FORWARD if the ray crosses along the surface normal, i.e. from the forward into the reverse sense volume
+};
+
+//! \brief Whether two crossings are the same crossing of a surface. A ray
+//! through an edge or vertex hits each primitive sharing it
+inline bool duplicate_crossing(const RayCrossing& a, const RayCrossing& b)
+{
+  return a.surface == b.surface && a.sense == b.sense &&
+         std::abs(b.distance - a.distance) <= TINY_BIT;
+}
+
+//! \brief Remove duplicate crossings from crossings sorted by distance
+//! \details Duplicates are within TINY_BIT of one another but need not be
+//! adjacent, crossings of other surfaces may lie between them. Each crossing
+//! is compared against the kept crossings within TINY_BIT before it
+inline void remove_duplicate_crossings(std::vector<RayCrossing>& crossings)
+{
+  size_t n_kept = 0;
+  for (size_t i = 0; i < crossings.size(); i++) {
+    bool duplicate = false;
+    for (size_t j = n_kept; j-- > 0 && crossings[i].distance - crossings[j].distance <= TINY_BIT;) {
+      if (duplicate_crossing(crossings[j], crossings[i])) {
+        duplicate = true;
+        break;
+      }
+    }
+    if (!duplicate) crossings[n_kept++] = crossings[i];
+  }
+  crossings.resize(n_kept);
+}
+
+//! \brief Add a crossing to the crossings of a multi-hit query
+//! \details If the number of crossings is capped the crossings are kept as a
+//! max-heap on distance so that the farthest crossing can be replaced.
+//! Duplicates of a crossing already kept are discarded so that they don't
+//! count toward the cap. Uncapped crossings are deduplicated by the caller.
+//! \return The distance beyond which crossings no longer need to be
+//!         considered, INFTY unless the cap has been reached
+inline double add_crossing(std::vector<RayCrossing>& crossings, int max_crossings, const RayCrossing& crossing)
+{
+  if (max_crossings < 0) {
+    crossings.push_back(crossing);
+    return INFTY;
+  }
+
+  auto farther = [](const RayCrossing& a, const RayCrossing& b) { return a.distance < b.distance; };
+  auto same = [&](const RayCrossing& c) { return duplicate_crossing(c, crossing); };
+  if (std::none_of(crossings.begin(), crossings.end(), same)) {
+    if (static_cast<int>(crossings.size()) < max_crossings) {
+      crossings.push_back(crossing);
+      std::push_heap(crossings.begin(), crossings.end(), farther);
+    } else if (!crossings.empty() && crossing.distance < crossings.front().distance) {
+      std::pop_heap(crossings.begin(), crossings.end(), farther);
+      crossings.back() = crossing;
+      std::push_heap(crossings.begin(), crossings.end(), farther);
+    }
+  }
+
+  if (static_cast<int>(crossings.size()) < max_crossings) return INFTY;
+  return crossings.empty() ? 0.0 : crossings.front().distance;
+}
+
+/*! Set of primitives excluded from a ray query, typically the surface
+    elements a particle has most recently crossed or reflected from.
+    Primitives are stored in insertion order. The first INLINE_CAPACITY
+    primitives are held in a fixed size array that is scanned linearly; any
+    further primitives are also hashed so that membership tests stay constant
+    time as long histories build up.
+ */
+class PrimitiveExclusionSet {
+public:
+  static constexpr size_t INLINE_CAPACITY {8};
+
+  PrimitiveExclusionSet() = default;
+
+  PrimitiveExclusionSet(const std::vector<MeshID>& primitives) {
+    for (MeshID primitive : primitives) push_back(primitive);
+  }
+
+  PrimitiveExclusionSet(std::initializer_list<MeshID> primitives) {
+    for (MeshID primitive : primitives) push_back(primitive);
+  }
+
+  //! \brief Add a primitive to the set
+  void push_back(MeshID primitive) {
+    if (n_inline_ < INLINE_CAPACITY) {
+      inline_[n_inline_++] = primitive;
+      return;
+    }
+    overflow_.push_back(primitive);
+    overflow_set_.insert(primitive);
+  }
+
+  //! \brief Whether a primitive is in the set
+  bool contains(MeshID primitive) const {
+    const MeshID* end = inline_.data() + n_inline_;
+    if (std::find(inline_.data(), end, primitive) != end) return true;
+    return !overflow_.empty() && overflow_set_.count(primitive) > 0;
+  }
+
+  //! \brief The primitive added at position i
+  MeshID operator[](size_t i) const {
+    return i < INLINE_CAPACITY ? inline_[i] : overflow_[i - INLINE_CAPACITY];
+  }
+
+  //! \brief The most recently added primitive
+  MeshID back() const {
+    return overflow_.empty() ? inline_[n_inline_ - 1] : overflow_.back();
+  }
+
+  size_t size() const { return n_inline_ + overflow_.size(); }
+
+  bool empty() const { return n_inline_ == 0; }
+
+  void clear() {
+    n_inline_ = 0;
+    overflow_.clear();
+    overflow_set_.clear();
+  }
+
+  //! \brief Copy of the primitives in insertion order
+  std::vector<MeshID> to_vector() const {
+    std::vector<MeshID> primitives(inline_.begin(), inline_.begin() + n_inline_);
+    primitives.insert(primitives.end(), overflow_.begin(), overflow_.end());
+    return primitives;
+  }
+
+private:
+  std::array<MeshID, INLINE_CAPACITY> inline_; //!< First INLINE_CAPACITY primitives
+  size_t n_inline_ {0}; //!< Number of primitives in the inline array
+  std::vector<MeshID> overflow_; //!< Remaining primitives in insertion order
+  std::unordered_set<MeshID> overflow_set_; //!< Hashed copy of the overflow primitives
+};
+
 // TO-DO: there should be a few more double elements here (barycentric coords)
 
 /*! Stucture that is an extension of Embree's RTCRay with
@@ -87,8 +243,10 @@ struct RTCSurfaceDualRay : RTCDualRay {
   // Member variables
   RayFireType rf_type {RayFireType::VOLUME}; //!< Enum indicating the type of query this ray is used for
   HitOrientation orientation {HitOrientation::EXITING}; //!< Enum indicating what hits to accept based on orientation
-  const std::vector<MeshID>* exclude_primitives {nullptr}; //! < Set of primitives to exclude from the query
+  const PrimitiveExclusionSet* exclude_primitives {nullptr}; //! < Set of primitives to exclude from the query
   TreeID volume_tree {ID_NONE}; // volume the ray is being fired in
+  std::vector<RayCrossing>* crossings {nullptr}; //!< Crossings found by ACCUMULATE_HITS queries
+  int max_crossings {-1}; //!< Maximum number of crossings kept by ACCUMULATE_HITS queries (no limit if negative)
 };
 
 struct RTCElementDualRay : RTCDualRay {
@@ -113,6 +271,7 @@ struct RTCDualHit : RTCHit {
   // data members
   const PrimitiveRef* primitive_ref {nullptr}; //!< Pointer to the primitive reference for this hit
   MeshID surface {ID_NONE}; //!< ID of the surface this hit belongs to
+  MeshID next_volume {ID_NONE}; //!< Volume across the hit surface from the volume the ray was fired in
   Vec3da dNg; //!< Double precision version of the primitive normal
 };
 
@@ -128,6 +287,79 @@ struct RTCDualRayHit {
 
 };
 
+//! \brief Map a packet width onto the corresponding Embree SoA ray-hit structure
+template<int N> struct RTCRayHitPacket;
+template<> struct RTCRayHitPacket<4> { using type = RTCRayHit4; };
+template<> struct RTCRayHitPacket<8> { using type = RTCRayHit8; };
+template<> struct RTCRayHitPacket<16> { using type = RTCRayHit16; };
+
+/*! Packet (SoA) version of RTCDualRayHit. The Embree RTCRayHitN structure
+    comes first so that Embree can trace the packet directly, followed by the
+    double precision lanes read and written by the XDG intersection callbacks.
+    Only valid for packet widths that Embree traces natively (see
+    RTC_DEVICE_PROPERTY_NATIVE_RAY{4,8,16}_SUPPORTED), where the packet passed
+    to the callbacks is this structure.
+ */
+template<int N>
+struct RTCDualRayHitN : RTCRayHitPacket<N>::type {
+
+  RTCDualRayHitN() {
+    for (int i = 0; i < N; i++) {
+      this->ray.tnear[i] = 0.0;
+      this->ray.tfar[i] = INFTYF;
+      this->ray.time[i] = 0.0;
+      this->ray.mask[i] = -1;
+      this->ray.id[i] = i;
+      this->ray.flags[i] = 0;
+      this->hit.geomID[i] = RTC_INVALID_GEOMETRY_ID;
+      this->hit.primID[i] = RTC_INVALID_GEOMETRY_ID;
+      dtfar[i] = INFTY;
+    }
+  }
+
+  static constexpr int size() { return N; }
+
+  //! \brief Set both the single and double precision versions of a lane's origin
+  void set_org(int i, const Vec3da& o) {
+    this->ray.org_x[i] = o[0]; this->ray.org_y[i] = o[1]; this->ray.org_z[i] = o[2];
+    dorg[0][i] = o[0]; dorg[1][i] = o[1]; dorg[2][i] = o[2];
+  }
+
+  //! \brief Set both the single and double precision versions of a lane's direction
+  void set_dir(int i, const Vec3da& d) {
+    this->ray.dir_x[i] = d[0]; this->ray.dir_y[i] = d[1]; this->ray.dir_z[i] = d[2];
+    ddir[0][i] = d[0]; ddir[1][i] = d[1]; ddir[2][i] = d[2];
+  }
+
+  //! \brief Set both the single and double precision versions of a lane's max distance
+  void set_tfar(int i, double d) {
+    this->ray.tfar[i] = std::min(d, INFTYF);
+    dtfar[i] = d;
+  }
+
+  //! \brief Set the near distance of a lane
+  void set_tnear(int i, double d) {
+    this->ray.tnear[i] = d;
+  }
+
+  Vec3da org(int i) const { return {dorg[0][i], dorg[1][i], dorg[2][i]}; }
+  Vec3da dir(int i) const { return {ddir[0][i], ddir[1][i], ddir[2][i]}; }
+
+  // ray lanes
+  double dorg[3][N]; //!< double precision versions of the ray origins
+  double ddir[3][N]; //!< double precision versions of the ray directions
+  double dtfar[N]; //!< double precision versions of the ray far distances
+  RayFireType rf_type[N]; //!< query type of each lane
+  HitOrientation orientation[N]; //!< hit orientation accepted by each lane
+  const PrimitiveExclusionSet* exclude_primitives[N]; //!< primitives excluded for each lane
+  TreeID volume_tree[N]; //!< volume each lane is fired in
+
+  // hit lanes
+  const PrimitiveRef* primitive_ref[N]; //!< primitive reference of each lane's hit
+  MeshID surface[N]; //!< surface of each lane's hit
+  Vec3da dNg[N]; //!< double precision hit normal of each lane
+};
+
 /*! Structure extending Embree's RTCPointQuery to include double precision values */
 struct RTCDPointQuery : RTCPointQuery {
 
@@ -139,6 +371,9 @@ struct RTCDPointQuery : RTCPointQuery {
   //! \brief Set both the single and double precision versions of the query radius
   void set_radius(double rad) {
     radius = std::min(rad, INFTYF);
+    // round up so that Embree's single precision culling never excludes
+    // primitives within the double precision radius
+    if (rad < INFTYF && radius < rad) radius = std::nextafter(radius, std::numeric_limits<float>::max());
     dradius = rad;
   }
 
@@ -1,6 +1,8 @@
 #ifndef _XDG_RAY_TRACING_INTERFACE_H
 #define _XDG_RAY_TRACING_INTERFACE_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -9,6 +11,7 @@
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/primitive_ref.h"
 #include "xdg/geometry_data.h"
+#include "xdg/ray.h"
 
 namespace xdg
 {
@@ -72,18 +75,187 @@ public:
    */
   virtual void create_global_element_tree() = 0;
 
+  /**
+   * @brief Releases the trees of a volume registered with register_volume.
+   *
+   * The global trees reference the geometry of all registered volumes and are
+   * released as well. They must be recreated before global queries are made.
+   * Surfaces shared with volumes that remain registered stay valid.
+   *
+   * @param surface_tree The surface tree of the volume
+   * @param element_tree The element tree of the volume (TREE_NONE if the volume has no elements)
+   */
+  virtual void unregister_volume(TreeID surface_tree, TreeID element_tree);
+
   // Query Methods
   virtual bool point_in_volume(TreeID tree,
                        const Position& point,
                        const Direction* direction = nullptr,
-                       const std::vector<MeshID>* exclude_primitives = nullptr) const = 0;
+                       const PrimitiveExclusionSet* exclude_primitives = nullptr) const = 0;
+
+  //! \brief Point containment with primitive exclusions given as a list of IDs
+  bool point_in_volume(TreeID tree,
+                       const Position& point,
+                       const Direction* direction,
+                       const std::vector<MeshID>* exclude_primitives) const;
 
+  //! \brief Point containment without exclusions, selected by a literal nullptr
+  bool point_in_volume(TreeID tree,
+                       const Position& point,
+                       const Direction* direction,
+                       std::nullptr_t) const
+  { return point_in_volume(tree, point, direction, static_cast<const PrimitiveExclusionSet*>(nullptr)); }
+
+  /**
+   * @brief Fires a ray against a surface tree.
+   *
+   * @param exclude_primitives Primitives ignored by the ray. If provided, the
+   *        primitive hit by the ray is added to the set.
+   */
   virtual std::pair<double, MeshID> ray_fire(TreeID tree,
                                      const Position& origin,
                                      const Direction& direction,
                                      const double dist_limit = INFTY,
                                      HitOrientation orientation = HitOrientation::EXITING,
-                                     std::vector<MeshID>* const exclude_primitives = nullptr) = 0;
+                                     PrimitiveExclusionSet* const exclude_primitives = nullptr) = 0;
+
+  //! \brief Fires a ray with primitive exclusions given as a list of IDs
+  //! \details The list is converted to a PrimitiveExclusionSet for the query
+  //! and the primitive hit by the ray is appended to it. Prefer passing a
+  //! PrimitiveExclusionSet for long-lived exclusion histories.
+  std::pair<double, MeshID> ray_fire(TreeID tree,
+                                     const Position& origin,
+                                     const Direction& direction,
+                                     const double dist_limit,
+                                     HitOrientation orientation,
+                                     std::vector<MeshID>* const exclude_primitives);
+
+  //! \brief Fires a ray without exclusions, selected by a literal nullptr
+  std::pair<double, MeshID> ray_fire(TreeID tree,
+                                     const Position& origin,
+                                     const Direction& direction,
+                                     const double dist_limit,
+                                     HitOrientation orientation,
+                                     std::nullptr_t)
+  { return ray_fire(tree, origin, direction, dist_limit, orientation, static_cast<PrimitiveExclusionSet*>(nullptr)); }
+
+  /**
+   * @brief Fires a ray against a surface tree, returning the full hit record.
+   *
+   * Equivalent to ray_fire, but also provides the hit element, its normal
+   * and the volume on the other side of the hit surface so that a surface
+   * crossing requires no follow-up queries. Not supported by all ray tracers.
+   */
+  virtual HitRecord ray_fire_record(TreeID tree,
+                                    const Position& origin,
+                                    const Direction& direction,
+                                    const double dist_limit = INFTY,
+                                    HitOrientation orientation = HitOrientation::EXITING,
+                                    PrimitiveExclusionSet* const exclude_primitives = nullptr);
+
+  /**
+   * @brief Finds every surface crossing along a ray in a single traversal.
+   *
+   * Typically used with the global surface tree to collect all crossings
+   * along a line. Crossings of elements shared by several primitives (ray
+   * through an edge or vertex) are reported once. Not supported by all ray
+   * tracers.
+   *
+   * @param tree The TreeID of the surface tree to fire the ray against
+   * @param crossings Output crossings sorted by distance
+   * @param dist_limit Maximum distance along the ray
+   * @param max_crossings Maximum number of crossings to return, the nearest
+   *        crossings are kept. No limit if negative
+   */
+  virtual void surface_crossings(TreeID tree,
+                                 const Position& origin,
+                                 const Direction& direction,
+                                 std::vector<RayCrossing>& crossings,
+                                 double dist_limit = INFTY,
+                                 int max_crossings = -1) const;
+
+  //! \brief Finds every surface crossing along a ray using the global surface tree
+  void surface_crossings(const Position& origin,
+                         const Direction& direction,
+                         std::vector<RayCrossing>& crossings,
+                         double dist_limit = INFTY,
+                         int max_crossings = -1) const
+  {
+    surface_crossings(global_surface_tree_, origin, direction, crossings, dist_limit, max_crossings);
+  }
+
+  /**
+   * @brief Fires a batch of rays against the same tree.
+   *
+   * Equivalent to calling ray_fire for each ray in turn, but allows backends
+   * to trace several rays at once. The default implementation loops over
+   * ray_fire.
+   *
+   * @param tree The TreeID of the surface tree to fire the rays against
+   * @param origins Origin of each ray
+   * @param directions Direction of each ray (must be the same length as origins)
+   * @param dist_limits Maximum distance of each ray. If empty, INFTY is used for all rays
+   * @param hits Output distance and surface for each ray, resized to the number of rays
+   * @param orientation Hit orientation accepted by all rays
+   * @param exclude_primitives Per-ray primitive exclusion sets. If empty, no
+   *        primitives are excluded. Null entries are allowed. As with ray_fire,
+   *        the primitive hit by each ray is added to its set.
+   */
+  virtual void ray_fire_batch(TreeID tree,
+                              const std::vector<Position>& origins,
+                              const std::vector<Direction>& directions,
+                              const std::vector<double>& dist_limits,
+                              std::vector<std::pair<double, MeshID>>& hits,
+                              HitOrientation orientation = HitOrientation::EXITING,
+                              const std::vector<PrimitiveExclusionSet*>& exclude_primitives = {});
+
+  //! \brief Fires a batch of rays with per-ray primitive exclusions given as
+  //! lists of IDs. The primitive hit by each ray is appended to its list
+  void ray_fire_batch(TreeID tree,
+                      const std::vector<Position>& origins,
+                      const std::vector<Direction>& directions,
+                      const std::vector<double>& dist_limits,
+                      std::vector<std::pair<double, MeshID>>& hits,
+                      HitOrientation orientation,
+                      const std::vector<std::vector<MeshID>*>& exclude_primitives);
+
+  /**
+   * @brief Point containment tests for a batch of points against the same tree.
+   *
+   * Equivalent to calling point_in_volume for each point. Results are written
+   * in the order of the points, independent of how the work is divided.
+   * The default implementation loops over point_in_volume.
+   *
+   * @param tree The TreeID of the surface tree to test the points against
+   * @param points The points to test
+   * @param results Output, 1 if the point is inside of the volume and 0 otherwise. Resized to the number of points
+   * @param directions Direction of the ray fired from each point. If empty, the default direction of point_in_volume is used
+   */
+  virtual void point_in_volume_batch(TreeID tree,
+                                     const std::vector<Position>& points,
+                                     std::vector<uint8_t>& results,
+                                     const std::vector<Direction>& directions = {}) const;
+
+  /**
+   * @brief Finds the elements containing a batch of points using an element tree.
+   *
+   * Equivalent to calling find_element for each point. Results are written in
+   * the order of the points, independent of how the work is divided. The
+   * default implementation loops over find_element.
+   *
+   * @param tree The TreeID of the element tree to search
+   * @param points The points to locate
+   * @param elements Output MeshID of the element containing each point
+   *        (ID_NONE if none). Resized to the number of points
+   */
+  virtual void find_element_batch(TreeID tree,
+                                  const std::vector<Position>& points,
+                                  std::vector<MeshID>& elements) const;
+
+  //! \brief Finds the elements containing a batch of points using the global element tree
+  void find_element_batch(const std::vector<Position>& points,
+                          std::vector<MeshID>& elements) const
+  { find_element_batch(global_element_tree_, points, elements); }
 
   /**
    * @brief Finds the element containing a given point using the global element tree.
@@ -106,8 +278,20 @@ public:
    */
   virtual MeshID find_element(TreeID tree, const Position& point) const = 0;
 
+  //! \brief Find the closest surface primitive to a point
+  //! \param max_radius Search radius, primitives beyond it are not considered
+  //! \return Distance to and ID of the closest primitive, {INFTY, ID_NONE} if
+  //!         there is no primitive within the search radius
   virtual std::pair<double, MeshID> closest(TreeID tree,
-                                            const Position& origin) = 0;
+                                            const Position& origin,
+                                            double max_radius = INFTY) = 0;
+
+  //! \brief Distance to the closest surface primitive for a batch of points
+  //! \param distances Output distances, INFTY for points with no primitive within max_radius
+  virtual void closest_distance_batch(TreeID tree,
+                                      const std::vector<Position>& points,
+                                      std::vector<double>& distances,
+                                      double max_radius = INFTY);
 
   virtual bool occluded(TreeID tree,
                 const Position& origin,
@@ -116,16 +300,61 @@ public:
 
   virtual RTLibrary library() const = 0;
 
+  //! \brief Memory in bytes used by packed surface triangle data (see XDGConfig::cache_surface_triangles)
+  virtual size_t triangle_cache_memory() const { return 0; }
+
+  //! \brief Memory in bytes used by precomputed element transforms (see XDGConfig::cache_element_transforms)
+  virtual size_t element_cache_memory() const { return 0; }
+
+  //! \brief Add the memory held by the ray tracer to a report. By default
+  //! only the triangle and element caches are reported
+  virtual void memory_report(MemoryReport& report) const;
+
+  //! \brief Memory in bytes of the acceleration structure of a surface tree
+  //! (0 if not measured by the backend)
+  virtual size_t surface_tree_memory(SurfaceTreeID tree) const { return 0; }
+
+  //! \brief Whether surface_tree_memory includes the memory of the tree's
+  //! acceleration structure
+  virtual bool surface_tree_memory_measured(SurfaceTreeID tree) const { return false; }
+
+  //! \brief Memory in bytes of the acceleration structure of an element tree
+  //! (0 if not measured by the backend)
+  virtual size_t element_tree_memory(ElementTreeID tree) const { return 0; }
+
+  //! \brief Whether element_tree_memory includes the memory of the tree's
+  //! acceleration structure
+  virtual bool element_tree_memory_measured(ElementTreeID tree) const { return false; }
+
+  //! \brief Defer building the acceleration structures of newly created trees
+  //! until build_pending_trees is called. Trees can't be queried until built.
+  void defer_tree_builds(bool defer) { defer_tree_builds_ = defer; }
+
+  //! \brief Build all trees deferred by defer_tree_builds, concurrently where
+  //! supported, using up to XDGConfig::n_threads() threads
+  virtual void build_pending_trees() {}
+
 
   // Generic Accessors
   int num_registered_trees() const { return surface_trees_.size() + element_trees_.size(); };
   int num_registered_surface_trees() const { return surface_trees_.size(); };
   int num_registered_element_trees() const { return element_trees_.size(); };
 
+  //! \brief Tree containing the surfaces of all volumes (TREE_NONE until created)
+  TreeID global_surface_tree() const { return global_surface_tree_; }
+  //! \brief Tree containing the elements of all volumes (TREE_NONE until created)
+  TreeID global_element_tree() const { return global_element_tree_; }
+
 protected:
   // Common functions across RayTracers
   const double bounding_box_bump(const std::shared_ptr<MeshManager> mesh_manager, MeshID volume_id); // return a bump value based on the size of a bounding box (minimum 1e-3). Should this be a part of mesh_manager?
 
+  // check that the per-ray inputs of a batched query are consistent
+  void check_batch_sizes(const std::vector<Position>& origins,
+                         const std::vector<Direction>& directions,
+                         const std::vector<double>& dist_limits,
+                         const std::vector<PrimitiveExclusionSet*>& exclude_primitives) const;
+
   SurfaceTreeID next_surface_tree_id(); // get next surface treeid
   ElementTreeID next_element_tree_id(); // get next element treeid
 
@@ -144,6 +373,7 @@ protected:
   SurfaceTreeID next_surface_tree_id_ {0};
   ElementTreeID next_element_tree_id_ {0};
   double numerical_precision_ {1e-3};
+  bool defer_tree_builds_ {false}; //<! Whether tree builds are deferred until build_pending_trees
 };
 
 } // namespace xdg
@@ -0,0 +1,308 @@
+#ifndef _XDG_TET_TOPOLOGY_H
+#define _XDG_TET_TOPOLOGY_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "xdg/constants.h"
+#include "xdg/query_stats.h"
+#include "xdg/vec3da.h"
+#include "xdg/geometry/plucker.h"
+
+namespace xdg {
+
+//! \brief Whether a segment visitor is called with the index of each element
+template<typename F>
+constexpr bool visits_element_index = std::is_invocable_v<F&, MeshID, double, MeshIndex>;
+
+//! \brief Whether a type can be called as a segment visitor (see visit_segment)
+template<typename F>
+constexpr bool is_segment_visitor = std::is_invocable_v<F&, MeshID, double> || visits_element_index<F>;
+
+//! \brief Pass a track segment to a segment visitor
+//! \details Visitors are called with the (element ID, length) of each
+//! segment, or the (element ID, length, element index) if they accept the
+//! index, and may return void, or a bool that is false to stop the traversal
+//! after the segment
+//! \return Whether the traversal should continue
+template<typename F>
+inline bool visit_segment(F& on_segment, MeshID element, double length, MeshIndex index)
+{
+  auto visit = [&]() {
+    if constexpr (visits_element_index<F>) return on_segment(element, length, index);
+    else return on_segment(element, length);
+  };
+  if constexpr (std::is_void_v<decltype(visit())>) {
+    visit();
+    return true;
+  } else {
+    return static_cast<bool>(visit());
+  }
+}
+
+//! \brief Barycentric coordinates of a point with respect to a tetrahedron
+//! \return The coordinates of the point for each vertex, all NaN if the tetrahedron is degenerate
+inline std::array<double, 4> tet_barycentric_coordinates(const std::array<Vertex, 4>& v,
+                                                          const Position& point)
+{
+  Vertex e0 = v[1] - v[0];
+  Vertex e1 = v[2] - v[0];
+  Vertex e2 = v[3] - v[0];
+  Vertex r = point - v[0];
+  double inv_det = 1.0 / e0.dot(e1.cross(e2));
+  double l1 = r.dot(e1.cross(e2)) * inv_det;
+  double l2 = e0.dot(r.cross(e2)) * inv_det;
+  double l3 = e0.dot(e1.cross(r)) * inv_det;
+  if (!std::isfinite(inv_det)) l1 = l2 = l3 = std::numeric_limits<double>::quiet_NaN();
+  return {1.0 - (l1 + l2 + l3), l1, l2, l3};
+}
+
+//! \brief Select the next element of a point location walk
+//! \param bary Barycentric coordinates of the point in the current element
+//! \param face_ordering Local vertex indices of each element face
+//! \return The local index of the face to cross, -1 if the point is strictly
+//!         inside of the element and -2 if the walk can't continue (point on
+//!         an element boundary or degenerate element)
+inline int locate_step(const std::array<double, 4>& bary,
+                       const std::array<std::array<int, 3>, 4>& face_ordering)
+{
+  int min_vertex = 0;
+  for (int i = 1; i < 4; i++)
+    if (bary[i] < bary[min_vertex]) min_vertex = i;
+  double min_bary = bary[min_vertex];
+
+  if (std::isnan(min_bary)) return -2;
+  if (min_bary > PLUCKER_ZERO_TOL) return -1;
+  if (min_bary >= -PLUCKER_ZERO_TOL) return -2;
+
+  // move toward the point through the face opposite the vertex with the most
+  // negative coordinate
+  for (int f = 0; f < 4; f++) {
+    const auto& face = face_ordering[f];
+    if (face[0] != min_vertex && face[1] != min_vertex && face[2] != min_vertex) return f;
+  }
+  return -2;
+}
+
+/*! Flat, index-addressed copy of the tetrahedral mesh topology used for
+    element walks. All arrays are addressed by element index (see
+    MeshManager::element_index) or vertex index (see MeshManager::vertex_index)
+    so that traversal requires no ID lookups, hashing or allocation.
+ */
+struct TetTopology {
+
+  //! \brief Vertex indices of face i of an element, ordered so that the face normal points out of the element
+  std::array<MeshIndex, 3> face_vertex_indices(MeshIndex element, int i) const {
+    const MeshIndex* conn = &connectivity[4 * element];
+    return {conn[face_ordering[i][0]], conn[face_ordering[i][1]], conn[face_ordering[i][2]]};
+  }
+
+  //! \brief Coordinates of a vertex
+  Vertex vertex(MeshIndex vertex) const {
+    return {x[vertex], y[vertex], z[vertex]};
+  }
+
+  //! \brief Coordinates of the four vertices of an element
+  std::array<Vertex, 4> element_vertices(MeshIndex element) const {
+    const MeshIndex* conn = &connectivity[4 * element];
+    return {vertex(conn[0]), vertex(conn[1]), vertex(conn[2]), vertex(conn[3])};
+  }
+
+  //! \brief Coordinates of the vertices of face i of an element
+  std::array<Vertex, 3> face_vertices(MeshIndex element, int i) const {
+    auto [i0, i1, i2] = face_vertex_indices(element, i);
+    return {vertex(i0), vertex(i1), vertex(i2)};
+  }
+
+  //! \brief Find the face through which a ray exits an element and the distance to it
+  //! \note It is assumed that the provided position is within the element.
+  //! \param element The index of the current element
+  //! \param r The current position within the element
+  //! \param u The normalized direction of the ray
+  //! \return Pair containing the index of the next element (INDEX_NONE if the
+  //!         exit face is on the mesh boundary) and the distance to the exit point
+  std::pair<MeshIndex, double> next_element(MeshIndex element,
+                                            const Position& r,
+                                            const Direction& u) const
+  {
+    int idx_out = -1;
+    double min_dist = INFTY;
+    for (int i = 0; i < 4; i++) {
+      auto coords = face_vertices(element, i);
+      // exiting hits only, face normals point outward with respect to the element
+      auto result = plucker_ray_tri_intersect(coords.data(), r, u, INFTY, 0.0, true, 1);
+      if (!result.hit) continue;
+      double dist = std::max(0.0, result.t);
+      if (dist < min_dist) {
+        min_dist = dist;
+        idx_out = i;
+      }
+    }
+
+    if (idx_out == -1) return {INDEX_NONE, INFTY};
+    return {neighbors[4 * element + idx_out], min_dist};
+  }
+
+  //! \brief Walk a ray through the mesh, passing (element ID, length) segments to a visitor
+  //! \details Incremental Plücker traversal. The permuted inner products of the
+  //! ray with the edges of an element's entry face are carried over from the
+  //! previous element, so only the three edges joining the entry face to the
+  //! new vertex are evaluated per step. The exit face is the face whose edge
+  //! products are all positive and the exit point follows from the products as
+  //! barycentric weights. Steps with degenerate (zero) products, i.e. rays
+  //! through edges or vertices, fall back to next_element.
+  //! \note It is assumed that the provided position is within the starting element.
+  //! \param element The index of the starting element
+  //! \param start The starting position of the ray
+  //! \param u The normalized direction of the ray
+  //! \param distance The total distance to travel along the ray
+  //! \param on_segment Visitor called for each segment (see visit_segment)
+  //! \return Pair containing the index of the element following the last
+  //!         segment (INDEX_NONE if the walk left the mesh) and the sum of the
+  //!         segment lengths
+  template<typename F>
+  std::pair<MeshIndex, double> walk(MeshIndex element,
+                                    const Position& start,
+                                    const Direction& u,
+                                    double distance,
+                                    F&& on_segment) const
+  {
+    double traveled = 0.0;
+    // distance along the ray at which the current element was entered
+    double t_entry = 0.0;
+    // vertex indices of the entry face and the products of the ray with its
+    // edges, edge k runs from entry[k] to entry[(k + 1) % 3]
+    std::array<MeshIndex, 3> entry;
+    std::array<double, 3> entry_products;
+    bool has_entry = false;
+
+    while (t_entry < distance) {
+      XDG_COUNT_QUERY(TET_STEPS);
+      const MeshIndex* conn = &connectivity[4 * element];
+
+      // vertex positions relative to the ray origin
+      std::array<Vertex, 4> v;
+      for (int i = 0; i < 4; i++) v[i] = vertex(conn[i]) - start;
+
+      // position of each local vertex in the entry face (-1 if not present)
+      std::array<int, 4> entry_pos {-1, -1, -1, -1};
+      if (has_entry) {
+        for (int i = 0; i < 4; i++)
+          for (int k = 0; k < 3; k++)
+            if (conn[i] == entry[k]) entry_pos[i] = k;
+      }
+
+      // products of the ray with the directed edges between local vertices
+      std::array<std::array<double, 4>, 4> p;
+      for (int i = 0; i < 4; i++) {
+        for (int j = i + 1; j < 4; j++) {
+          int ki = entry_pos[i];
+          int kj = entry_pos[j];
+          if (ki != -1 && kj != -1)
+            p[i][j] = kj == (ki + 1) % 3 ? entry_products[ki] : -entry_products[kj];
+          else
+            p[i][j] = u.dot(v[i].cross(v[j]));
+          p[j][i] = -p[i][j];
+        }
+      }
+
+      // find the face the ray exits through, faces are ordered with outward normals
+      int face_out = -1;
+      for (int f = 0; f < 4; f++) {
+        const auto& face = face_ordering[f];
+        // the entry face can't be the exit face
+        if (entry_pos[face[0]] != -1 && entry_pos[face[1]] != -1 && entry_pos[face[2]] != -1) continue;
+        if (p[face[0]][face[1]] > 0.0 && p[face[1]][face[2]] > 0.0 && p[face[2]][face[0]] > 0.0) {
+          face_out = f;
+          break;
+        }
+      }
+
+      MeshIndex next;
+      double t_exit;
+      if (face_out == -1) {
+        // degenerate case, use the full ray-triangle tests for this element
+        auto exit = next_element(element, start + t_entry * u, u);
+        next = exit.first;
+        t_exit = t_entry + exit.second;
+        has_entry = false;
+      } else {
+        const auto& face = face_ordering[face_out];
+        double e0 = p[face[0]][face[1]];
+        double e1 = p[face[1]][face[2]];
+        double e2 = p[face[2]][face[0]];
+        // each vertex is weighted by the product of the opposing edge
+        Position exit_point = (e1 * v[face[0]] + e2 * v[face[1]] + e0 * v[face[2]]) / (e0 + e1 + e2);
+        t_exit = std::max(t_entry, exit_point.dot(u));
+        next = neighbors[4 * element + face_out];
+        entry = {conn[face[0]], conn[face[1]], conn[face[2]]};
+        entry_products = {e0, e1, e2};
+        has_entry = true;
+      }
+
+      double length = std::min(t_exit, distance) - t_entry;
+      traveled += length;
+      t_entry = t_exit;
+      bool proceed = visit_segment(on_segment, element_ids[element], length, element);
+      element = next;
+      if (element == INDEX_NONE || !proceed) break;
+    }
+    return {element, traveled};
+  }
+
+  //! \brief Walk face adjacencies from an element toward the element containing a point
+  //! \details At each step the walk crosses the face opposite the vertex with
+  //! the most negative barycentric coordinate of the point.
+  //! \param element The index of the starting element
+  //! \param point The point to locate
+  //! \param max_steps Maximum number of elements to visit
+  //! \return The index of the element strictly containing the point, or
+  //!         INDEX_NONE if the walk leaves the mesh, reaches the step limit or
+  //!         the point is on an element boundary
+  MeshIndex locate(MeshIndex element, const Position& point, int max_steps) const
+  {
+    for (int step = 0; step < max_steps && element != INDEX_NONE; step++) {
+      int face = locate_step(tet_barycentric_coordinates(element_vertices(element), point), face_ordering);
+      if (face == -1) return element;
+      if (face == -2) return INDEX_NONE;
+      element = neighbors[4 * element + face];
+    }
+    return INDEX_NONE;
+  }
+
+  bool empty() const { return n_elements == 0; }
+
+  void clear() {
+    n_elements = 0;
+    neighbors.clear();
+    connectivity.clear();
+    element_ids.clear();
+    x.clear();
+    y.clear();
+    z.clear();
+  }
+
+  //! \brief Memory used by the topology arrays in bytes
+  size_t memory() const {
+    return (neighbors.capacity() + connectivity.capacity()) * sizeof(MeshIndex) +
+           element_ids.capacity() * sizeof(MeshID) +
+           (x.capacity() + y.capacity() + z.capacity()) * sizeof(double);
+  }
+
+  // Data members
+  MeshIndex n_elements {0}; //!< Number of elements
+  std::array<std::array<int, 3>, 4> face_ordering; //!< Local vertex indices of each element face
+  std::vector<MeshIndex> neighbors; //!< Index of the element across each face (4 per element), INDEX_NONE on the boundary
+  std::vector<MeshIndex> connectivity; //!< Vertex indices of each element (4 per element)
+  std::vector<MeshID> element_ids; //!< Element ID of each element index
+  std::vector<double> x, y, z; //!< Vertex coordinates by vertex index
+};
+
+} // namespace xdg
+
+#endif // include guard
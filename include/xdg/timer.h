@@ -1,7 +1,11 @@
 #ifndef XDG_TIMER_H
 #define XDG_TIMER_H
 
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace xdg {
 
@@ -40,6 +44,89 @@ private:
   double elapsed_ {0.0};                 //!< elapsed time in [s]
 };
 
+//==============================================================================
+//! A completed timed scope
+//==============================================================================
+
+struct TimedScope {
+  std::string name;  //!< Name of the scope
+  std::string path;  //!< Names of the enclosing scopes on the same thread and this scope, separated by '/'
+  int thread {0};    //!< Index of the thread the scope ran on, in order of first use
+  int depth {0};     //!< Number of enclosing scopes on the same thread
+  double start {0.0};    //!< Start time relative to the registry's epoch in [s]
+  double duration {0.0}; //!< Elapsed time of the scope in [s]
+};
+
+//==============================================================================
+//! Registry of the timed scopes of all threads. Scopes are recorded by
+//! ScopedTimer and can be written as a Chrome trace (viewable in
+//! chrome://tracing or Perfetto) or summarized as a text tree
+//==============================================================================
+
+class TimingRegistry {
+public:
+  using clock = std::chrono::steady_clock;
+
+  //! The process wide registry
+  static TimingRegistry& instance();
+
+  //! Add a completed scope
+  void record(TimedScope scope);
+
+  //! Completed scopes in order of completion
+  std::vector<TimedScope> scopes() const;
+
+  //! Discard all recorded scopes
+  void clear();
+
+  //! Whether scopes are recorded. The registry is disabled by default, in
+  //! which case ScopedTimer is a no-op
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+  //! Time since the registry was created in [s]
+  double now() const;
+
+  //! Write the recorded scopes as complete ("X") events in the Chrome trace JSON format
+  void write_chrome_trace(const std::string& filename) const;
+
+  //! Text summary of the recorded scopes. Scopes with the same path are
+  //! combined and listed beneath their parent with their number of calls,
+  //! total time and fraction of the parent's time
+  std::string summary() const;
+
+private:
+  TimingRegistry();
+
+  mutable std::mutex mutex_;          //!< Guards the recorded scopes
+  std::vector<TimedScope> scopes_;    //!< Completed scopes
+  clock::time_point epoch_;           //!< Creation time of the registry
+  std::atomic<bool> enabled_ {false}; //!< Whether scopes are recorded
+};
+
+//==============================================================================
+//! Times the enclosing C++ scope and records it in the TimingRegistry.
+//! Scopes opened while another is active on the same thread are nested
+//! beneath it
+//==============================================================================
+
+class ScopedTimer {
+public:
+  explicit ScopedTimer(const std::string& name);
+  ~ScopedTimer() { stop(); }
+
+  //! End the scope before the timer is destroyed. Must be the innermost open scope of the thread
+  void stop();
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+  bool active_ {false}; //!< Whether the scope is recorded
+  std::string name_;    //!< Name of the scope
+  double start_ {0.0};  //!< Start time relative to the registry's epoch in [s]
+};
+
 //==============================================================================
 // Non-member functions
 //==============================================================================
@@ -1,17 +1,75 @@
 #ifndef XDG_UTIL_RNG_H
 #define XDG_UTIL_RNG_H
 
-#include <random>
+#include <atomic>
+#include <cstdint>
 
 namespace xdg {
 
-static std::random_device rd;
-static std::mt19937 gen(rd());
-static std::uniform_real_distribution<double> dis(0.0, 1.0);
+//! \brief SplitMix64 output function, a bijective mixing of a 64-bit value
+inline constexpr uint64_t splitmix64(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+/*! Counter-based random number stream. The n-th value of a stream is a pure
+    function of (seed, stream, n): the SplitMix64 output function applied to a
+    Weyl sequence whose origin is derived from the seed and stream number.
+    Streams share no state, so giving each history, track or sample its own
+    stream makes parallel sampling free of contention and reproducible
+    independent of the number of threads or the scheduling of work.
+ */
+class RandomStream {
+public:
+  //! Increment of the Weyl sequence (2^64 / golden ratio)
+  static constexpr uint64_t GOLDEN_GAMMA {0x9e3779b97f4a7c15ULL};
+
+  //! \param seed Seed shared by a set of streams
+  //! \param stream Index of the stream for the seed
+  //! \param counter Position in the stream of the next value
+  RandomStream(uint64_t seed = 0, uint64_t stream = 0, uint64_t counter = 0)
+  : key_(splitmix64(splitmix64(seed) ^ splitmix64(stream + GOLDEN_GAMMA))), counter_(counter) {}
+
+  //! \brief Next 64-bit value of the stream
+  uint64_t next() { return splitmix64(key_ + ++counter_ * GOLDEN_GAMMA); }
+
+  //! \brief Next value of the stream, uniform on [0, 1) with 53 bits of precision
+  double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+  //! \brief Next value of the stream, uniform on [min, max)
+  double uniform(double min, double max) { return min + (max - min) * uniform(); }
+
+  //! \brief Advance the stream by n values
+  void skip(uint64_t n) { counter_ += n; }
+
+  //! \brief Number of values drawn from the stream, including skipped values
+  uint64_t counter() const { return counter_; }
+
+private:
+  uint64_t key_; //!< Origin of the stream's Weyl sequence
+  uint64_t counter_; //!< Position in the stream
+};
+
+//! Seed of the per-thread streams used by rand_double
+constexpr uint64_t DEFAULT_RNG_SEED {42};
+
+//! \brief Random stream of the calling thread. Threads are assigned streams
+//! of DEFAULT_RNG_SEED in the order they first draw a value
+inline RandomStream& thread_random_stream()
+{
+  static std::atomic<uint64_t> n_streams {0};
+  thread_local RandomStream stream(DEFAULT_RNG_SEED, n_streams++);
+  return stream;
+}
 
 inline double rand_double(double min=0.0, double max=1.0)
 {
-  return min + (max - min) * dis(gen);
+  return thread_random_stream().uniform(min, max);
 }
 
 } // namespace xdg
@@ -20,6 +20,7 @@
 #include <fmt/format.h>
 
 #include "xdg/constants.h"
+#include "xdg/util/rng.h"
 
 namespace xdg {
 
@@ -167,12 +168,17 @@ using Vertex = Vec3da;
 using Position = Vec3da;
 using Direction = Vec3da;
 
-inline Direction rand_dir() {
-  double theta = drand48() * 2.0 * M_PI;
-  double u = 2.0*drand48() - 1.0;
+//! Isotropic direction sampled from a random stream
+inline Direction rand_dir(RandomStream& rng) {
+  double theta = rng.uniform() * 2.0 * M_PI;
+  double u = 2.0*rng.uniform() - 1.0;
   double phi = acos(u);
   return Direction(sin(phi) * cos(theta), sin(phi) * sin(theta), cos(phi)).normalize();
+}
 
+//! Isotropic direction sampled from the random stream of the calling thread
+inline Direction rand_dir() {
+  return rand_dir(thread_random_stream());
 }
 
 } // end namespace xdg
@@ -1,15 +1,74 @@
 #ifndef _XDG_INTERFACE_H
 #define _XDG_INTERFACE_H
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <shared_mutex>
 #include <unordered_map>
+#include <vector>
 
+#include "xdg/error.h"
 #include "xdg/mesh_manager_interface.h"
+#include "xdg/query_stats.h"
 #include "xdg/ray_tracing_interface.h"
 
 
 namespace xdg {
 
+//! Wall-clock time [s] spent in each phase of XDG::prepare_raytracer
+struct RayTracerBuildTimings {
+  double registration {0.0}; //!< registering volume surfaces and elements with the ray tracer
+  double tree_build {0.0}; //!< building the acceleration structures of all trees
+  double init {0.0}; //!< ray tracer initialization after the trees are built
+  double total {0.0}; //!< total time in prepare_raytracer
+};
+
+//! Ray tracing trees of a volume, resolved once with XDG::volume_handle so
+//! that repeated queries against the volume skip the volume-to-tree lookup
+struct VolumeHandle {
+  MeshID volume {ID_NONE}; //!< ID of the volume
+  TreeID surface_tree {TREE_NONE}; //!< Surface tree of the volume
+  TreeID element_tree {TREE_NONE}; //!< Element tree of the volume
+  uint64_t generation {0}; //!< Handle generation of the XDG the trees were resolved in
+
+  bool valid() const { return surface_tree != TREE_NONE; }
+};
+
+//! Progress of a track through the mesh for XDG::segments. Allows a long
+//! track to be traversed in pieces, e.g. into a fixed size buffer, and a
+//! single state to be reused across tracks without reallocating
+struct TrackState {
+  //! Start a new track from start to end
+  void reset(const Position& start, const Position& end) {
+    origin = start;
+    r = start;
+    u = end - start;
+    distance = u.length();
+    u /= distance;
+    traveled = 0.0;
+    element = ID_NONE;
+    last_element = ID_NONE;
+    crossings.clear();
+    crossings_found = false;
+    next_crossing = 0;
+  }
+
+  //! Whether the end of the track has been reached
+  bool done() const { return distance <= 0.0; }
+
+  Position origin; //!< Start of the track
+  Position r; //!< Current position along the track
+  Direction u; //!< Direction of the track
+  double distance {0.0}; //!< Distance remaining to the end of the track
+  double traveled {0.0}; //!< Distance traveled from the start of the track
+  MeshID element {ID_NONE}; //!< Element to resume the walk from, ID_NONE if it must be located
+  MeshID last_element {ID_NONE}; //!< Element of the last segment
+  std::vector<RayCrossing> crossings; //!< Surface crossings used to jump gaps in the mesh
+  bool crossings_found {false}; //!< Whether the surface crossings have been computed
+  size_t next_crossing {0}; //!< Index of the next crossing ahead of the current position
+};
+
 class XDG {
 
 public:
@@ -22,10 +81,49 @@ public:
   static std::shared_ptr<XDG> create(MeshLibrary mesh_lib = MeshLibrary::MOAB, RTLibrary ray_tracing_lib = RTLibrary::EMBREE);
 
   // Methods
+
+  //! Register all volumes with the ray tracer and build their trees. Trees
+  //! are built concurrently after registration using up to
+  //! XDGConfig::n_threads() threads
+  //!
+  //! If XDGConfig::lazy_volume_registration() is set, no trees are built here.
+  //! Instead each volume is registered on the first query made against it
+  //! and all volumes, along with the global trees, are registered on the
+  //! first query made against the global trees (find_element(point),
+  //! segments(start, end)). Queries are safe to call concurrently in this mode
   void prepare_raytracer();
 
+  //! Timings of the phases of the last call to prepare_raytracer or, in lazy
+  //! mode, of the last build of the global trees
+  const RayTracerBuildTimings& build_timings() const { return build_timings_; }
+
   void prepare_volume_for_raytracing(MeshID volume);
 
+  //! Whether volumes are registered on first use (see prepare_raytracer)
+  bool lazy_registration() const { return lazy_registration_; }
+
+  //! Whether a volume's trees are currently registered with the ray tracer
+  bool volume_registered(MeshID volume) const;
+
+  //! Volumes currently registered with the ray tracer
+  std::vector<MeshID> registered_volumes() const;
+
+  //! Release the trees of a volume to reclaim memory. The volume is
+  //! registered again the next time it is queried. The global trees are
+  //! released as well and rebuilt on the next global query. Only available
+  //! with lazy registration, waits for queries in progress to complete.
+  //! Handle queries made while the global trees are built don't lock and
+  //! must not overlap an eviction
+  //! @param volume The ID of the volume to evict
+  void evict_volume(MeshID volume);
+
+  //! Resolve the trees of a volume for use with the handle-based query
+  //! overloads, registering the volume first if needed. Once the volume is
+  //! evicted or the ray tracer is prepared again, queries with the handle
+  //! resolve the volume again on each use
+  //! @param volume The ID of the volume
+  VolumeHandle volume_handle(MeshID volume) const;
+
 // Geometric Queries
 MeshID find_volume(const Position& point,
                    const Direction& direction) const;
@@ -35,6 +133,47 @@ MeshID find_element(const Position& point) const;
 MeshID find_element(MeshID volume,
                     const Position& point) const;
 
+//! Locates a batch of points using the global element tree. Equivalent to
+//! calling find_element for each point, parallelized over XDGConfig::n_threads()
+//! threads where the ray tracer supports it
+//! @param points The points to locate
+//! @param elements Output element containing each point (ID_NONE if none), in the order of the points
+void find_element_batch(const std::vector<Position>& points,
+                        std::vector<MeshID>& elements) const;
+
+//! Locates a batch of points in the elements of a volume
+//! @param volume The ID of the volume to search
+//! @param points The points to locate
+//! @param elements Output element containing each point (ID_NONE if none), in the order of the points
+void find_element_batch(MeshID volume,
+                        const std::vector<Position>& points,
+                        std::vector<MeshID>& elements) const;
+
+//! Locate the element containing a point, starting from a nearby element
+//! such as the element of a particle's previous event. The mesh is walked
+//! from the hint toward the point, falling back to the global element tree
+//! if the walk leaves the mesh, reaches the step limit or ends on an element
+//! boundary, so the result is the same as find_element(point)
+//! @param point The point to locate
+//! @param hint_element The element to start the walk from (ID_NONE to skip the walk)
+//! @param max_steps Maximum number of elements visited by the walk
+//! @return The ID of the element containing the point, ID_NONE if none
+MeshID find_element(const Position& point,
+                    MeshID hint_element,
+                    int max_steps = 100) const;
+
+//! Finds every surface crossing along a ray in a single traversal of the
+//! global surface tree
+//! @param origin The origin of the ray
+//! @param direction The direction of the ray
+//! @param dist_limit Maximum distance along the ray
+//! @param max_crossings Maximum number of crossings, the nearest are kept (no limit if negative)
+//! @return The (distance, surface, element, sense) of each crossing sorted by distance
+std::vector<RayCrossing> surface_crossings(const Position& origin,
+                                           const Direction& direction,
+                                           double dist_limit = INFTY,
+                                           int max_crossings = -1) const;
+
 //! Returns a vector of segments between the start and end points on the mesh
 //! @param start The starting point of the query
 //! @param end The ending point of the query
@@ -43,6 +182,45 @@ std::vector<std::pair<MeshID, double>>
 segments(const Position& start,
          const Position& end) const;
 
+//! Visits the segments between the start and end points on the mesh without
+//! storing them
+//! @param start The starting point of the query
+//! @param end The ending point of the query
+//! @param on_segment Called with the element ID and length inside each element,
+//!        and the element index if the visitor accepts it (see visit_segment)
+template<typename F, typename = std::enable_if_t<is_segment_visitor<F>>>
+void segments(const Position& start,
+              const Position& end,
+              F&& on_segment) const
+{
+  TrackState track;
+  track.reset(start, end);
+  segments(track, on_segment);
+}
+
+//! Continues a track, visiting its segments until the end of the track is
+//! reached or the visitor returns false
+//! @param track The state of the track, updated to resume after the last segment visited
+//! @param on_segment Called with the element ID and length inside each
+//!        element, and the element index if the visitor accepts it. May
+//!        return a bool that is false to stop the traversal. Visitors may
+//!        make other queries on this XDG, but may not prepare the ray tracer
+//!        or evict volumes
+//! @return Whether the end of the track has been reached
+template<typename F>
+bool segments(TrackState& track,
+              F&& on_segment) const;
+
+//! Continues a track, filling a caller-provided buffer with its segments
+//! @param track The state of the track, updated to resume after the last segment written
+//! @param buffer Buffer the (element ID, length) segments are written to
+//! @param capacity Size of the buffer
+//! @return The number of segments written, less than the capacity only if the
+//!         end of the track has been reached
+size_t segments(TrackState& track,
+                std::pair<MeshID, double>* buffer,
+                size_t capacity) const;
+
 //! Returns a vector of segments between the start and end points on the mesh for a specified volume (subdomain)
 //! @param volume The ID of the volume to intersect with
 //! @param start The starting point of the query
@@ -66,20 +244,118 @@ next_element(MeshID current_element,
 bool point_in_volume(MeshID volume,
       const Position point,
       const Direction* direction = nullptr,
-      const std::vector<MeshID>* exclude_primitives = nullptr) const;
+      const PrimitiveExclusionSet* exclude_primitives = nullptr) const;
+
+bool point_in_volume(MeshID volume,
+      const Position point,
+      const Direction* direction,
+      const std::vector<MeshID>* exclude_primitives) const;
+
+//! Resolves a literal nullptr passed for the exclusions
+bool point_in_volume(MeshID volume,
+      const Position point,
+      const Direction* direction,
+      std::nullptr_t) const
+{ return point_in_volume(volume, point, direction, static_cast<const PrimitiveExclusionSet*>(nullptr)); }
+
+//! Point containment tests for a batch of points. Equivalent to calling
+//! point_in_volume for each point, using ray packets and up to
+//! XDGConfig::n_threads() threads where the ray tracer supports them
+//! @param volume The ID of the volume to test the points against
+//! @param points The points to test
+//! @param results Output, 1 if the point is inside of the volume and 0 otherwise, in the order of the points
+//! @param directions Direction of the ray fired from each point (default direction if empty)
+void point_in_volume_batch(MeshID volume,
+                           const std::vector<Position>& points,
+                           std::vector<uint8_t>& results,
+                           const std::vector<Direction>& directions = {}) const;
 
 std::pair<double, MeshID> ray_fire(MeshID volume,
                                    const Position& origin,
                                    const Direction& direction,
                                    const double dist_limit = INFTY,
                                    HitOrientation orientation = HitOrientation::EXITING,
-                                   std::vector<MeshID>* const exclude_primitives = nullptr) const;
+                                   PrimitiveExclusionSet* const exclude_primitives = nullptr) const;
 
+//! Fires a ray with primitive exclusions given as a list of IDs. The hit
+//! primitive is appended to the list. Prefer passing a PrimitiveExclusionSet
+//! for exclusion histories that grow over many queries.
+std::pair<double, MeshID> ray_fire(MeshID volume,
+                                   const Position& origin,
+                                   const Direction& direction,
+                                   const double dist_limit,
+                                   HitOrientation orientation,
+                                   std::vector<MeshID>* const exclude_primitives) const;
+
+//! Resolves a literal nullptr passed for the exclusions
+std::pair<double, MeshID> ray_fire(MeshID volume,
+                                   const Position& origin,
+                                   const Direction& direction,
+                                   const double dist_limit,
+                                   HitOrientation orientation,
+                                   std::nullptr_t) const
+{ return ray_fire(volume, origin, direction, dist_limit, orientation, static_cast<PrimitiveExclusionSet*>(nullptr)); }
+
+//! Fires a ray from within a volume, returning the distance, surface, hit
+//! element, element normal (pointing out of the volume) and the volume on the
+//! other side of the hit surface. A surface crossing needs no further queries
+//! (see surface_normal and MeshManager::next_volume). On a miss the record's
+//! surface is ID_NONE
+HitRecord ray_fire_record(MeshID volume,
+                          const Position& origin,
+                          const Direction& direction,
+                          const double dist_limit = INFTY,
+                          HitOrientation orientation = HitOrientation::EXITING,
+                          PrimitiveExclusionSet* const exclude_primitives = nullptr) const;
+
+//! Fires a batch of rays from within a volume. Equivalent to calling ray_fire for each ray
+//! @param volume The ID of the volume the rays are fired in
+//! @param origins The origin of each ray
+//! @param directions The direction of each ray
+//! @param hits Output distance and surface ID of each ray's hit ({INFTY, ID_NONE} for misses)
+//! @param dist_limits The maximum distance of each ray (INFTY for all rays if empty)
+//! @param orientation The hit orientation accepted by all rays
+//! @param exclude_primitives Per-ray primitive exclusion sets (none if empty)
+void ray_fire_batch(MeshID volume,
+                    const std::vector<Position>& origins,
+                    const std::vector<Direction>& directions,
+                    std::vector<std::pair<double, MeshID>>& hits,
+                    const std::vector<double>& dist_limits = {},
+                    HitOrientation orientation = HitOrientation::EXITING,
+                    const std::vector<PrimitiveExclusionSet*>& exclude_primitives = {}) const;
+
+//! Fires a batch of rays with per-ray primitive exclusions given as lists of
+//! IDs. The primitive hit by each ray is appended to its list
+void ray_fire_batch(MeshID volume,
+                    const std::vector<Position>& origins,
+                    const std::vector<Direction>& directions,
+                    std::vector<std::pair<double, MeshID>>& hits,
+                    const std::vector<double>& dist_limits,
+                    HitOrientation orientation,
+                    const std::vector<std::vector<MeshID>*>& exclude_primitives) const;
+
+//! @brief Find the closest surface element of a volume to a point
+//! @param max_radius Search radius, elements beyond it are not considered
+//! @return Distance to and ID of the closest element, {INFTY, ID_NONE} if
+//!         no element is within the search radius
 std::pair<double, MeshID> closest(MeshID volume,
-                                  const Position& origin) const;
+                                  const Position& origin,
+                                  double max_radius = INFTY) const;
 
+//! @brief Distance to the closest surface of a volume
+//! @param max_radius Search radius. Safety-distance queries that only need
+//!        to know whether a surface is nearer than some distance should pass
+//!        it here, INFTY is returned if no surface is within the radius
 double closest_distance(MeshID volume,
-                        const Position& origin) const;
+                        const Position& origin,
+                        double max_radius = INFTY) const;
+
+//! @brief Distance to the closest surface of a volume for a batch of points
+//! @param distances Output distances, INFTY for points with no surface within max_radius
+void closest_distance_batch(MeshID volume,
+                            const std::vector<Position>& points,
+                            std::vector<double>& distances,
+                            double max_radius = INFTY) const;
 
 bool occluded(MeshID volume,
               const Position& origin,
@@ -88,7 +364,80 @@ bool occluded(MeshID volume,
 
 Direction surface_normal(MeshID surface,
                          Position point,
-                         const std::vector<MeshID>* exclude_primitives = nullptr) const;
+                         const PrimitiveExclusionSet* exclude_primitives = nullptr) const;
+
+Direction surface_normal(MeshID surface,
+                         Position point,
+                         const std::vector<MeshID>* exclude_primitives) const;
+
+//! Resolves a literal nullptr passed for the exclusions
+Direction surface_normal(MeshID surface,
+                         Position point,
+                         std::nullptr_t) const
+{ return surface_normal(surface, point, static_cast<const PrimitiveExclusionSet*>(nullptr)); }
+
+// Handle-based Queries, equivalent to the queries above for handle.volume.
+// An invalid handle misses: no hit, no element and the point is outside
+bool point_in_volume(const VolumeHandle& handle,
+                     const Position& point,
+                     const Direction* direction = nullptr,
+                     const PrimitiveExclusionSet* exclude_primitives = nullptr) const;
+
+bool point_in_volume(const VolumeHandle& handle,
+                     const Position& point,
+                     const Direction* direction,
+                     const std::vector<MeshID>* exclude_primitives) const;
+
+bool point_in_volume(const VolumeHandle& handle,
+                     const Position& point,
+                     const Direction* direction,
+                     std::nullptr_t) const
+{ return point_in_volume(handle, point, direction, static_cast<const PrimitiveExclusionSet*>(nullptr)); }
+
+std::pair<double, MeshID> ray_fire(const VolumeHandle& handle,
+                                   const Position& origin,
+                                   const Direction& direction,
+                                   const double dist_limit = INFTY,
+                                   HitOrientation orientation = HitOrientation::EXITING,
+                                   PrimitiveExclusionSet* const exclude_primitives = nullptr) const;
+
+std::pair<double, MeshID> ray_fire(const VolumeHandle& handle,
+                                   const Position& origin,
+                                   const Direction& direction,
+                                   const double dist_limit,
+                                   HitOrientation orientation,
+                                   std::vector<MeshID>* const exclude_primitives) const;
+
+std::pair<double, MeshID> ray_fire(const VolumeHandle& handle,
+                                   const Position& origin,
+                                   const Direction& direction,
+                                   const double dist_limit,
+                                   HitOrientation orientation,
+                                   std::nullptr_t) const
+{ return ray_fire(handle, origin, direction, dist_limit, orientation, static_cast<PrimitiveExclusionSet*>(nullptr)); }
+
+HitRecord ray_fire_record(const VolumeHandle& handle,
+                          const Position& origin,
+                          const Direction& direction,
+                          const double dist_limit = INFTY,
+                          HitOrientation orientation = HitOrientation::EXITING,
+                          PrimitiveExclusionSet* const exclude_primitives = nullptr) const;
+
+std::pair<double, MeshID> closest(const VolumeHandle& handle,
+                                  const Position& origin,
+                                  double max_radius = INFTY) const;
+
+double closest_distance(const VolumeHandle& handle,
+                        const Position& origin,
+                        double max_radius = INFTY) const;
+
+bool occluded(const VolumeHandle& handle,
+              const Position& origin,
+              const Direction& direction,
+              double& dist) const;
+
+MeshID find_element(const VolumeHandle& handle,
+                    const Position& point) const;
 
 
   // Geometric Measurements
@@ -96,6 +445,27 @@ Direction surface_normal(MeshID surface,
   double measure_surface_area(MeshID surface) const;
   double measure_volume_area(MeshID surface) const;
 
+  // Query Statistics
+
+  //! @brief Counts of the ray, closest point and element queries made so far
+  //! and of the work done by them (see QueryCounter). Counters are kept per
+  //! thread in the Embree callbacks and the element walk and are summed here.
+  //! Counts are process wide, covering all XDG instances, and are zero unless
+  //! the library is built with XDG_ENABLE_QUERY_STATS
+  QueryStats query_stats() const { return xdg::query_stats(); }
+
+  //! @brief Zero the query counters of all threads
+  void reset_query_stats() { xdg::reset_query_stats(); }
+
+  // Memory
+
+  //! @brief Memory held by the mesh manager, the ray tracer and this class,
+  //! by subsystem, along with the memory of the trees of each registered
+  //! volume. With Embree, BVH memory is measured by a device memory monitor
+  //! and is attributed to a volume only if its tree was built while no other
+  //! tree was being built
+  MemoryReport memory_report() const;
+
 // Mutators
   void set_mesh_manager_interface(std::shared_ptr<MeshManager> mesh_manager) {
     mesh_manager_ = mesh_manager;
@@ -118,16 +488,141 @@ private:
   double _triangle_volume_contribution(const PrimitiveRef& triangle) const;
   double _triangle_area_contribution(const PrimitiveRef& triangle) const;
 
+  // Lock held by queries for their duration with lazy registration, empty otherwise
+  using QueryLock = std::shared_lock<std::shared_mutex>;
+
+  // Ensure a volume's trees are registered, the returned lock must be held while they're used
+  QueryLock volume_trees(MeshID volume) const;
+
+  // Whether a segment visitor of this XDG is running on the calling thread.
+  // The visitor's query holds the registration lock with every volume and the
+  // global trees registered, so queries made by the visitor don't lock again
+  bool in_segment_visitor() const { return segment_visitor_xdg_ == this; }
+
+  // Fatal error if called from a segment visitor of this XDG, as registering
+  // or releasing trees would wait on the lock held by the visitor's query
+  void check_not_in_segment_visitor(const std::string& method) const;
+
+  // Marks the calling thread as running a segment visitor of an XDG
+  class SegmentVisitorScope {
+  public:
+    explicit SegmentVisitorScope(const XDG* xdg) : enclosing_(segment_visitor_xdg_) { segment_visitor_xdg_ = xdg; }
+    ~SegmentVisitorScope() { segment_visitor_xdg_ = enclosing_; }
+  private:
+    const XDG* enclosing_;
+  };
+
+  // Current trees of a handle, resolving its volume again if the handle is
+  // stale. current is left invalid for an invalid handle. The returned lock
+  // must be held while the trees are used
+  QueryLock handle_trees(const VolumeHandle& handle, VolumeHandle& current) const;
+
+  // Ensure all volumes and the global trees are registered, the returned lock must be held while they're used
+  QueryLock global_trees() const;
+
+  // Register a volume's trees with the ray tracer
+  void register_volume_trees(MeshID volume) const;
+
+  // Register all volumes and build their trees along with the global trees
+  void build_all_trees() const;
+
 // Data members
   std::shared_ptr<RayTracer> ray_tracing_interface_ {nullptr};
   std::shared_ptr<MeshManager> mesh_manager_ {nullptr};
 
-  std::unordered_map<MeshID, TreeID> volume_to_surface_tree_map_;  //<! Map from mesh volume to raytracing tree
+  // volume trees are registered by const queries with lazy registration
+  mutable std::unordered_map<MeshID, TreeID> volume_to_surface_tree_map_;  //<! Map from mesh volume to raytracing tree
   std::unordered_map<MeshID, TreeID> surface_to_tree_map_; //<! Map from mesh surface to embree scnee
-  std::unordered_map<MeshID, TreeID> volume_to_point_location_tree_map_; //<! Map from mesh volume to embree point location tree
+  mutable std::unordered_map<MeshID, TreeID> volume_to_point_location_tree_map_; //<! Map from mesh volume to embree point location tree
   TreeID global_scene_; // TODO: does this need to be in the RayTacer class or the XDG? class
+  mutable RayTracerBuildTimings build_timings_; //<! Timings of the last prepare_raytracer call
+
+  bool lazy_registration_ {false}; //<! Whether volumes are registered on first use
+  mutable std::atomic<bool> global_trees_built_ {false}; //<! Whether the global trees are up to date
+  std::atomic<uint64_t> handle_generation_ {1}; //<! Incremented when the trees of resolved handles may be released
+  mutable std::shared_mutex registration_mutex_; //<! Guards tree registration with lazy registration
+  static thread_local const XDG* segment_visitor_xdg_; //<! XDG whose segment visitor is running on this thread
 };
 
+template<typename F>
+bool XDG::segments(TrackState& track,
+                   F&& on_segment) const
+{
+  QueryLock lock = global_trees();
+  MeshID ipc = mesh_manager()->implicit_complement();
+
+  bool stopped = false;
+  auto visit = [&](MeshID element, double length, MeshIndex index) {
+    track.last_element = element;
+    if (!lazy_registration_) {
+      stopped = !visit_segment(on_segment, element, length, index);
+    } else {
+      // queries made by the visitor run under the lock held here
+      SegmentVisitorScope scope(this);
+      stopped = !visit_segment(on_segment, element, length, index);
+    }
+    return !stopped;
+  };
+
+  while (track.distance > 0 && !stopped) {
+    MeshID current_element = track.element;
+    if (current_element == ID_NONE) {
+      // attempt to find an element at the current location
+      current_element = ray_tracing_interface()->find_element(track.r);
+      // at this point we may be on the face of an element, if we're declared inside that element, ignore it
+      if (current_element == track.last_element) current_element = ID_NONE;
+    }
+    if (current_element == ID_NONE) {
+      // surface crossings along the whole track are found with a single
+      // traversal the first time the track is outside of the mesh and used to
+      // jump across every implicit complement gap
+      if (!track.crossings_found) {
+        ray_tracing_interface()->surface_crossings(track.origin, track.u, track.crossings,
+                                                   track.traveled + track.distance);
+        track.crossings_found = true;
+      }
+      // the next crossing ahead of the current location into a volume other
+      // than the implicit complement is the entry point into the mesh. If
+      // there is none before the end point, the track is complete
+      for (; track.next_crossing < track.crossings.size(); track.next_crossing++) {
+        const RayCrossing& crossing = track.crossings[track.next_crossing];
+        if (crossing.distance <= track.traveled + TINY_BIT) continue;
+        auto [forward_parent, reverse_parent] = mesh_manager()->get_parent_volumes(crossing.surface);
+        MeshID entered = crossing.sense == Sense::FORWARD ? reverse_parent : forward_parent;
+        if (entered != ipc && entered != ID_NONE) break;
+      }
+      if (track.next_crossing == track.crossings.size()) {
+        track.distance = 0.0;
+        return true;
+      }
+      const RayCrossing& crossing = track.crossings[track.next_crossing++];
+
+      double hit_dist = crossing.distance - track.traveled + TINY_BIT;
+      // move up to the surface
+      track.r += track.u * hit_dist;
+      track.distance -= hit_dist;
+      track.traveled += hit_dist;
+
+      // Get the element on the other side of the hit face using adjacencies
+      current_element = mesh_manager()->get_boundary_face_element(crossing.primitive);
+      if (current_element == ID_NONE) {
+        warning("Ray fire hit surface {}, but no adjacent elements were found on the other side of the surface.", crossing.surface);
+        track.distance = 0.0;
+        return true;
+      }
+    }
+    auto [next, walked] = mesh_manager()->walk_elements(current_element, track.r, track.u, track.distance, visit);
+    // update location of the track
+    track.r += track.u * walked;
+    track.distance -= walked;
+    track.traveled += walked;
+    // a stopped walk resumes from the next element, otherwise the walk left
+    // the mesh and the next element must be located
+    track.element = stopped ? next : ID_NONE;
+  }
+  return track.done();
+}
+
 }
 
 
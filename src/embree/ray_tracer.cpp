@@ -1,9 +1,15 @@
+#include "xdg/config.h"
 #include "xdg/embree/ray_tracer.h"
 #include "xdg/error.h"
 #include "xdg/geometry_data.h"
+#include "xdg/query_stats.h"
 #include "xdg/ray.h"
 #include "xdg/tetrahedron_contain.h"
+#include "xdg/timer.h"
 
+#ifdef XDG_HAVE_OPENMP
+#include "omp.h"
+#endif
 
 namespace xdg {
 
@@ -12,10 +18,33 @@ void error(void* dum, RTCError code, const char* str) {
     fatal_error("Embree error: {}", str);
 }
 
+// tracks the bytes allocated by an Embree device. Called by Embree before
+// each allocation and after each free (negative bytes)
+bool memory_monitor(void* device_bytes, ssize_t bytes, [[maybe_unused]] bool post) {
+  static_cast<std::atomic<int64_t>*>(device_bytes)->fetch_add(bytes, std::memory_order_relaxed);
+  return true;
+}
+
 EmbreeRayTracer::EmbreeRayTracer()
 {
-  device_ = rtcNewDevice(nullptr);
+  // limit Embree's build threads to the number requested for XDG
+  int n_threads = XDGConfig::config().n_threads();
+  std::string device_config = n_threads > 0 ? fmt::format("threads={}", n_threads) : "";
+  device_ = rtcNewDevice(device_config.c_str());
   rtcSetDeviceErrorFunction(device_, (RTCErrorFunction)error, nullptr);
+  rtcSetDeviceMemoryMonitorFunction(device_, memory_monitor, &device_bytes_);
+
+  // packets are only passed intact to the user geometry callbacks if the
+  // device traces them natively, otherwise rays are fired one at a time
+  if (rtcGetDeviceProperty(device_, RTC_DEVICE_PROPERTY_NATIVE_RAY16_SUPPORTED))
+    packet_width_ = 16;
+  else if (rtcGetDeviceProperty(device_, RTC_DEVICE_PROPERTY_NATIVE_RAY8_SUPPORTED))
+    packet_width_ = 8;
+  else if (rtcGetDeviceProperty(device_, RTC_DEVICE_PROPERTY_NATIVE_RAY4_SUPPORTED))
+    packet_width_ = 4;
+
+  for (auto tree_type : {TreeType::SURFACE, TreeType::ELEMENT, TreeType::GLOBAL})
+    set_build_profile(tree_type, XDGConfig::config().build_profile(tree_type));
 }
 
 EmbreeRayTracer::~EmbreeRayTracer()
@@ -28,13 +57,220 @@ void EmbreeRayTracer::init()
 
 }
 
-RTCScene EmbreeRayTracer::create_embree_scene() {
+RTCScene EmbreeRayTracer::create_embree_scene(TreeType tree_type) {
   RTCScene rtcscene = rtcNewScene(device_);
-  rtcSetSceneFlags(rtcscene, RTC_SCENE_FLAG_ROBUST);
-  rtcSetSceneBuildQuality(rtcscene, RTC_BUILD_QUALITY_HIGH);
+  // robust traversal is always used so that hits on shared edges and vertices
+  // aren't missed
+  switch (build_profile(tree_type)) {
+    case BuildProfile::FAST_BUILD:
+      rtcSetSceneFlags(rtcscene, RTC_SCENE_FLAG_ROBUST | RTC_SCENE_FLAG_COMPACT);
+      rtcSetSceneBuildQuality(rtcscene, RTC_BUILD_QUALITY_LOW);
+      break;
+    case BuildProfile::BALANCED:
+      rtcSetSceneFlags(rtcscene, RTC_SCENE_FLAG_ROBUST);
+      rtcSetSceneBuildQuality(rtcscene, RTC_BUILD_QUALITY_MEDIUM);
+      break;
+    case BuildProfile::MAX_TRACE:
+      rtcSetSceneFlags(rtcscene, RTC_SCENE_FLAG_ROBUST);
+      rtcSetSceneBuildQuality(rtcscene, RTC_BUILD_QUALITY_HIGH);
+      break;
+  }
   return rtcscene;
 }
 
+void EmbreeRayTracer::commit_scene(RTCScene scene)
+{
+  if (defer_tree_builds_)
+    pending_scenes_.push_back(scene);
+  else
+    build_scene(scene);
+}
+
+void EmbreeRayTracer::build_scene(RTCScene scene)
+{
+  ScopedTimer timer("rtcCommitScene");
+  uint64_t commit_id;
+  bool exclusive;
+  int64_t bytes_before;
+  {
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    exclusive = commits_in_flight_++ == 0;
+    commit_id = ++commits_started_;
+    bytes_before = device_bytes_.load(std::memory_order_relaxed);
+  }
+
+  rtcCommitScene(scene);
+
+  std::lock_guard<std::mutex> lock(commit_mutex_);
+  commits_in_flight_--;
+  // allocations of commits that overlapped this one can't be told apart
+  if (!exclusive || commits_started_ != commit_id) return;
+  int64_t bvh_bytes = device_bytes_.load(std::memory_order_relaxed) - bytes_before;
+  scene_bvh_bytes_[scene] = std::max<int64_t>(bvh_bytes, 0);
+}
+
+void EmbreeRayTracer::release_scene(RTCScene scene)
+{
+  pending_scenes_.erase(std::remove(pending_scenes_.begin(), pending_scenes_.end(), scene),
+                        pending_scenes_.end());
+  {
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    scene_bvh_bytes_.erase(scene);
+  }
+  rtcReleaseScene(scene);
+}
+
+void EmbreeRayTracer::build_pending_trees()
+{
+  ScopedTimer timer("EmbreeRayTracer::build_pending_trees");
+  // the global scenes share their geometries with the volume scenes, so they
+  // are committed in a second pass once the volume scenes are built
+  auto is_global = [this](RTCScene scene) {
+    return scene == global_surface_scene_ || scene == global_element_scene_;
+  };
+  auto global_begin = std::stable_partition(pending_scenes_.begin(), pending_scenes_.end(),
+                                            [&](RTCScene scene) { return !is_global(scene); });
+  size_t n_volume_scenes = std::distance(pending_scenes_.begin(), global_begin);
+
+  // Embree doesn't guarantee that scenes sharing a geometry can be committed
+  // concurrently, so the volume scenes are committed in groups of scenes that
+  // share no geometries. The scenes of a group are built concurrently, each
+  // commit also using Embree's internal thread pool. Measuring the memory of
+  // each BVH requires that the commits don't overlap
+  bool concurrent = !XDGConfig::config().measure_tree_memory();
+  for (const auto& group : commit_groups(std::vector<RTCScene>(pending_scenes_.begin(), global_begin))) {
+    #ifdef XDG_HAVE_OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(std::max(XDGConfig::config().n_threads(), 1)) if(concurrent)
+    #endif
+    for (size_t i = 0; i < group.size(); ++i) {
+      build_scene(group[i]);
+    }
+  }
+
+  for (size_t i = n_volume_scenes; i < pending_scenes_.size(); ++i) {
+    build_scene(pending_scenes_[i]);
+  }
+  pending_scenes_.clear();
+}
+
+std::vector<std::vector<RTCScene>>
+EmbreeRayTracer::commit_groups(const std::vector<RTCScene>& scenes) const
+{
+  // surface geometries are attached to the surface scenes of the volumes on
+  // either side of them, element geometries to a single volume scene
+  std::unordered_map<RTCScene, std::vector<RTCScene>> neighbors;
+  auto tree_scene = [this](SurfaceTreeID tree) -> RTCScene {
+    if (tree < 0 || tree >= static_cast<TreeID>(surface_tree_scenes_.size())) return nullptr;
+    return surface_tree_scenes_[tree];
+  };
+  for (const auto& [geometry, surface_data] : surface_user_data_map_) {
+    RTCScene forward = tree_scene(surface_data->forward_vol);
+    RTCScene reverse = tree_scene(surface_data->reverse_vol);
+    if (!forward || !reverse) continue;
+    neighbors[forward].push_back(reverse);
+    neighbors[reverse].push_back(forward);
+  }
+
+  // greedily place each scene in the first group holding none of its neighbors
+  std::vector<std::vector<RTCScene>> groups;
+  std::unordered_map<RTCScene, size_t> scene_group;
+  for (RTCScene scene : scenes) {
+    std::vector<bool> taken(groups.size(), false);
+    auto it = neighbors.find(scene);
+    if (it != neighbors.end()) {
+      for (RTCScene neighbor : it->second) {
+        auto group = scene_group.find(neighbor);
+        if (group != scene_group.end()) taken[group->second] = true;
+      }
+    }
+    size_t group = std::find(taken.begin(), taken.end(), false) - taken.begin();
+    if (group == groups.size()) groups.emplace_back();
+    groups[group].push_back(scene);
+    scene_group[scene] = group;
+  }
+  return groups;
+}
+
+size_t EmbreeRayTracer::triangle_cache_memory() const
+{
+  size_t bytes = 0;
+  for (const auto& [geom, surface_data] : surface_user_data_map_) {
+    bytes += surface_data->triangle_cache.memory();
+  }
+  return bytes;
+}
+
+size_t EmbreeRayTracer::element_cache_memory() const
+{
+  size_t bytes = 0;
+  for (const auto& [geom, volume_data] : volume_user_data_map_) {
+    bytes += volume_data->transform_cache.memory();
+  }
+  return bytes;
+}
+
+void EmbreeRayTracer::memory_report(MemoryReport& report) const
+{
+  RayTracer::memory_report(report);
+
+  size_t ref_bytes = unordered_map_memory(primitive_ref_storage_);
+  for (const auto& [scene, refs] : primitive_ref_storage_) ref_bytes += vector_memory(refs);
+  for (const auto& refs : retired_primitive_ref_storage_) ref_bytes += vector_memory(refs);
+  report.add("ray_tracer/primitive_refs", ref_bytes);
+
+  // the caches are held by the user data, so only the user data itself is counted here
+  size_t user_data_bytes = unordered_map_memory(surface_user_data_map_) +
+                           unordered_map_memory(volume_user_data_map_) +
+                           surface_user_data_map_.size() * sizeof(SurfaceUserData) +
+                           volume_user_data_map_.size() * sizeof(VolumeElementsUserData);
+  report.add("ray_tracer/user_data", user_data_bytes);
+
+  // BVHs, scenes and geometries allocated by Embree
+  report.add("ray_tracer/embree_device", std::max<int64_t>(device_bytes_.load(std::memory_order_relaxed), 0));
+}
+
+size_t EmbreeRayTracer::scene_memory(RTCScene scene) const
+{
+  if (scene == nullptr) return 0;
+  size_t bytes = 0;
+  auto refs = primitive_ref_storage_.find(scene);
+  if (refs != primitive_ref_storage_.end()) bytes += vector_memory(refs->second);
+
+  std::lock_guard<std::mutex> lock(commit_mutex_);
+  auto bvh = scene_bvh_bytes_.find(scene);
+  if (bvh != scene_bvh_bytes_.end()) bytes += bvh->second;
+  return bytes;
+}
+
+bool EmbreeRayTracer::scene_memory_measured(RTCScene scene) const
+{
+  if (scene == nullptr) return false;
+  std::lock_guard<std::mutex> lock(commit_mutex_);
+  return scene_bvh_bytes_.count(scene);
+}
+
+size_t EmbreeRayTracer::surface_tree_memory(SurfaceTreeID tree) const
+{
+  if (tree < 0 || tree >= static_cast<TreeID>(surface_tree_scenes_.size())) return 0;
+  return scene_memory(surface_tree_scenes_[tree]);
+}
+
+bool EmbreeRayTracer::surface_tree_memory_measured(SurfaceTreeID tree) const
+{
+  if (tree < 0 || tree >= static_cast<TreeID>(surface_tree_scenes_.size())) return false;
+  return scene_memory_measured(surface_tree_scenes_[tree]);
+}
+
+size_t EmbreeRayTracer::element_tree_memory(ElementTreeID tree) const
+{
+  return scene_memory(element_scene(tree));
+}
+
+bool EmbreeRayTracer::element_tree_memory_measured(ElementTreeID tree) const
+{
+  return scene_memory_measured(element_scene(tree));
+}
+
 std::pair<SurfaceTreeID, ElementTreeID>
 EmbreeRayTracer::register_volume(const std::shared_ptr<MeshManager>& mesh_manager,
                                  MeshID volume_id)
@@ -50,9 +286,10 @@ SurfaceTreeID
 EmbreeRayTracer::create_surface_tree(const std::shared_ptr<MeshManager>& mesh_manager,
                            MeshID volume_id)
 {
+  ScopedTimer timer("EmbreeRayTracer::create_surface_tree");
   SurfaceTreeID tree = next_surface_tree_id();
   surface_trees_.push_back(tree);
-  auto volume_scene = this->create_embree_scene();
+  auto volume_scene = this->create_embree_scene(TreeType::SURFACE);
   auto volume_surfaces = mesh_manager->get_volume_surfaces(volume_id);
 
   // allocate total storage for all the primtives in a volume
@@ -99,8 +336,8 @@ EmbreeRayTracer::create_surface_tree(const std::shared_ptr<MeshManager>& mesh_ma
     }
   }
 
-  rtcCommitScene(volume_scene);
-  surface_volume_tree_to_scene_map_[tree] = volume_scene;
+  commit_scene(volume_scene);
+  set_tree_scene(surface_tree_scenes_, tree, volume_scene);
   return tree;
 }
 
@@ -120,9 +357,16 @@ EmbreeRayTracer::register_surface(const std::shared_ptr<MeshManager>& mesh_manag
     triangle_storage[storage_offset + i].primitive_id = surface_faces[i];
   }
 
+  bool native_triangles = XDGConfig::config().native_surface_triangles();
+
   // create new RTCGeometry for the surface
-  auto surface_geometry = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_USER);
-  rtcSetGeometryUserPrimitiveCount(surface_geometry, surf_face_count);
+  RTCGeometry surface_geometry;
+  if (native_triangles) {
+    surface_geometry = create_triangle_geometry(mesh_manager, surface);
+  } else {
+    surface_geometry = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_USER);
+    rtcSetGeometryUserPrimitiveCount(surface_geometry, surf_face_count);
+  }
   rtcAttachGeometry(volume_scene, surface_geometry);
   surface_to_geometry_map_[surface] = surface_geometry;
 
@@ -130,14 +374,28 @@ EmbreeRayTracer::register_surface(const std::shared_ptr<MeshManager>& mesh_manag
   auto surface_data = std::make_shared<SurfaceUserData>();
   surface_data->surface_id = surface;
   surface_data->mesh_manager = mesh_manager.get();
+  std::tie(surface_data->forward_parent, surface_data->reverse_parent) = mesh_manager->get_parent_volumes(surface);
   surface_data->prim_ref_buffer = tri_ref_ptr + storage_offset;
+  if (XDGConfig::config().cache_surface_triangles()) {
+    auto& cache = surface_data->triangle_cache;
+    cache.resize(surf_face_count);
+    for (size_t i = 0; i < surf_face_count; ++i) {
+      cache.set(i, mesh_manager->face_vertices(surface_faces[i]), mesh_manager->face_normal(surface_faces[i]));
+    }
+  }
   surface_user_data_map_[surface_geometry] = surface_data;
   rtcSetGeometryUserData(surface_geometry, surface_data.get());
 
   // Set RTC callbacks
-  rtcSetGeometryBoundsFunction(surface_geometry, (RTCBoundsFunction)&TriangleBoundsFunc, nullptr);
-  rtcSetGeometryIntersectFunction(surface_geometry, (RTCIntersectFunctionN)&TriangleIntersectionFunc);
-  rtcSetGeometryOccludedFunction(surface_geometry, (RTCOccludedFunctionN)&TriangleOcclusionFunc);
+  if (native_triangles) {
+    // candidate hits from Embree's triangle intersector are refined in double precision
+    rtcSetGeometryIntersectFilterFunction(surface_geometry, (RTCFilterFunctionN)&TriangleIntersectionFilterFunc);
+    rtcSetGeometryOccludedFilterFunction(surface_geometry, (RTCFilterFunctionN)&TriangleOcclusionFilterFunc);
+  } else {
+    rtcSetGeometryBoundsFunction(surface_geometry, (RTCBoundsFunction)&TriangleBoundsFunc, nullptr);
+    rtcSetGeometryIntersectFunction(surface_geometry, (RTCIntersectFunctionN)&TriangleIntersectionFunc);
+    rtcSetGeometryOccludedFunction(surface_geometry, (RTCOccludedFunctionN)&TriangleOcclusionFunc);
+  }
   rtcCommitGeometry(surface_geometry);
 
   // increment storage offset by number of faces in this surface
@@ -146,15 +404,44 @@ EmbreeRayTracer::register_surface(const std::shared_ptr<MeshManager>& mesh_manag
   return {surface_geometry, surface_data};
 }
 
+RTCGeometry
+EmbreeRayTracer::create_triangle_geometry(const std::shared_ptr<MeshManager>& mesh_manager,
+                                          MeshID surface)
+{
+  auto vertices = mesh_manager->get_surface_vertices(surface);
+  auto connectivity = mesh_manager->get_surface_connectivity(surface);
+
+  RTCGeometry geometry = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_TRIANGLE);
+
+  float* vertex_buffer = (float*)rtcSetNewGeometryBuffer(geometry, RTC_BUFFER_TYPE_VERTEX, 0,
+                                                         RTC_FORMAT_FLOAT3, 3 * sizeof(float),
+                                                         vertices.size());
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    vertex_buffer[3 * i] = vertices[i].x;
+    vertex_buffer[3 * i + 1] = vertices[i].y;
+    vertex_buffer[3 * i + 2] = vertices[i].z;
+  }
+
+  // triangles are stored in the same order as get_surface_faces so that
+  // Embree primitive IDs index into the surface's primitive references
+  unsigned* index_buffer = (unsigned*)rtcSetNewGeometryBuffer(geometry, RTC_BUFFER_TYPE_INDEX, 0,
+                                                              RTC_FORMAT_UINT3, 3 * sizeof(unsigned),
+                                                              connectivity.size() / 3);
+  std::copy(connectivity.begin(), connectivity.end(), index_buffer);
+
+  return geometry;
+}
+
 ElementTreeID
 EmbreeRayTracer::create_element_tree(const std::shared_ptr<MeshManager>& mesh_manager,
                                      MeshID volume)
 {
+  ScopedTimer timer("EmbreeRayTracer::create_element_tree");
   auto volume_elements = mesh_manager->get_volume_elements(volume);
   if (volume_elements.size() == 0) return TREE_NONE;
 
   // create a new geometry
-  RTCScene volume_element_scene = create_embree_scene();
+  RTCScene volume_element_scene = create_embree_scene(TreeType::ELEMENT);
   // create primitive references for the volumetric elements
   this->primitive_ref_storage_[volume_element_scene].resize(volume_elements.size());
   auto& volume_element_storage = this->primitive_ref_storage_[volume_element_scene];
@@ -170,6 +457,13 @@ EmbreeRayTracer::create_element_tree(const std::shared_ptr<MeshManager>& mesh_ma
   volume_elements_data->volume_id = volume;
   volume_elements_data->mesh_manager = mesh_manager.get();
   volume_elements_data->prim_ref_buffer = volume_element_storage.data();
+  if (XDGConfig::config().cache_element_transforms()) {
+    auto& cache = volume_elements_data->transform_cache;
+    cache.resize(volume_elements.size());
+    for (size_t i = 0; i < volume_elements.size(); ++i) {
+      cache.set(i, mesh_manager->tet_vertices(volume_elements[i]));
+    }
+  }
   this->volume_user_data_map_[element_geometry] = volume_elements_data;
 
   rtcSetGeometryUserData(element_geometry, volume_elements_data.get());
@@ -179,50 +473,157 @@ EmbreeRayTracer::create_element_tree(const std::shared_ptr<MeshManager>& mesh_ma
   rtcSetGeometryOccludedFunction(element_geometry, (RTCOccludedFunctionN)&TetrahedronOcclusionFunc);
 
   rtcCommitGeometry(element_geometry);
-  rtcCommitScene(volume_element_scene);
+  commit_scene(volume_element_scene);
 
   ElementTreeID tree = next_element_tree_id();
   element_trees_.push_back(tree);
-  element_volume_tree_to_scene_map_[tree] = volume_element_scene;
+  set_tree_scene(element_tree_scenes_, tree, volume_element_scene);
   return tree;
 }
 
 void EmbreeRayTracer::create_global_surface_tree()
 {
-  if (global_surface_scene_ != nullptr) {
-    rtcReleaseScene(global_surface_scene_);
-  }
-  global_surface_scene_ = create_embree_scene();
+  ScopedTimer timer("EmbreeRayTracer::create_global_surface_tree");
+  if (global_surface_scene_ != nullptr) release_scene(global_surface_scene_);
+  global_surface_scene_ = create_embree_scene(TreeType::GLOBAL);
 
   for(auto& [geom, surface_data] : surface_user_data_map_) {
       rtcAttachGeometry(global_surface_scene_, geom);
   }
 
-  rtcCommitScene(global_surface_scene_);
+  commit_scene(global_surface_scene_);
   SurfaceTreeID tree = next_surface_tree_id();
   surface_trees_.push_back(tree);
-  surface_volume_tree_to_scene_map_[tree] = global_surface_scene_;
+  set_tree_scene(surface_tree_scenes_, tree, global_surface_scene_);
   global_surface_tree_ = tree;
 }
 
 void EmbreeRayTracer::create_global_element_tree()
 {
-  if (global_element_scene_ != nullptr) {
-    rtcReleaseScene(global_element_scene_);
-  }
-  global_element_scene_ = create_embree_scene();
+  ScopedTimer timer("EmbreeRayTracer::create_global_element_tree");
+  if (global_element_scene_ != nullptr) release_scene(global_element_scene_);
+  global_element_scene_ = create_embree_scene(TreeType::GLOBAL);
 
   for (auto& [vol_geom, data] : volume_user_data_map_) {
     rtcAttachGeometry(global_element_scene_, vol_geom);
   }
-  rtcCommitScene(global_element_scene_);
+  commit_scene(global_element_scene_);
 
   ElementTreeID tree = next_element_tree_id();
   element_trees_.push_back(tree);
-  element_volume_tree_to_scene_map_[tree] = global_element_scene_;
+  set_tree_scene(element_tree_scenes_, tree, global_element_scene_);
   global_element_tree_ = tree;
 }
 
+void EmbreeRayTracer::release_global_trees()
+{
+  if (global_surface_scene_ != nullptr) {
+    release_scene(global_surface_scene_);
+    set_tree_scene(surface_tree_scenes_, global_surface_tree_, nullptr);
+    surface_trees_.erase(std::remove(surface_trees_.begin(), surface_trees_.end(), global_surface_tree_),
+                         surface_trees_.end());
+    global_surface_scene_ = nullptr;
+    global_surface_tree_ = TREE_NONE;
+  }
+
+  if (global_element_scene_ != nullptr) {
+    release_scene(global_element_scene_);
+    set_tree_scene(element_tree_scenes_, global_element_tree_, nullptr);
+    element_trees_.erase(std::remove(element_trees_.begin(), element_trees_.end(), global_element_tree_),
+                         element_trees_.end());
+    global_element_scene_ = nullptr;
+    global_element_tree_ = TREE_NONE;
+  }
+}
+
+void EmbreeRayTracer::unregister_volume(TreeID surface_tree, TreeID element_tree)
+{
+  // the global trees hold references to the geometries of every volume
+  release_global_trees();
+
+  RTCScene volume_surface_scene = surface_scene(surface_tree);
+  // surfaces shared with the registered volume on their other side are kept
+  // and their primitive references must remain valid. Surfaces no longer
+  // used by any registered volume are released
+  for (auto it = surface_user_data_map_.begin(); it != surface_user_data_map_.end();) {
+    auto& surface_data = it->second;
+    if (surface_data->forward_vol == surface_tree) surface_data->forward_vol = TREE_NONE;
+    if (surface_data->reverse_vol == surface_tree) surface_data->reverse_vol = TREE_NONE;
+    if (surface_data->forward_vol != TREE_NONE || surface_data->reverse_vol != TREE_NONE) {
+      ++it;
+      continue;
+    }
+    surface_to_geometry_map_.erase(surface_data->surface_id);
+    rtcReleaseGeometry(it->first);
+    it = surface_user_data_map_.erase(it);
+  }
+
+  auto surface_storage = primitive_ref_storage_.find(volume_surface_scene);
+  if (surface_storage != primitive_ref_storage_.end()) {
+    if (!surface_storage->second.empty())
+      retired_primitive_ref_storage_.push_back(std::move(surface_storage->second));
+    primitive_ref_storage_.erase(surface_storage);
+  }
+  release_retired_storage();
+  release_scene(volume_surface_scene);
+  set_tree_scene(surface_tree_scenes_, surface_tree, nullptr);
+  surface_trees_.erase(std::remove(surface_trees_.begin(), surface_trees_.end(), surface_tree),
+                       surface_trees_.end());
+
+  if (element_tree == TREE_NONE) return;
+
+  // the element geometry belongs to this volume alone and is released with its tree
+  RTCScene volume_element_scene = element_scene(element_tree);
+  const PrimitiveRef* element_refs = primitive_ref_storage_.at(volume_element_scene).data();
+  for (auto it = volume_user_data_map_.begin(); it != volume_user_data_map_.end(); ++it) {
+    if (it->second->prim_ref_buffer != element_refs) continue;
+    rtcReleaseGeometry(it->first);
+    volume_user_data_map_.erase(it);
+    break;
+  }
+  release_scene(volume_element_scene);
+  primitive_ref_storage_.erase(volume_element_scene);
+  set_tree_scene(element_tree_scenes_, element_tree, nullptr);
+  element_trees_.erase(std::remove(element_trees_.begin(), element_trees_.end(), element_tree),
+                       element_trees_.end());
+}
+
+void EmbreeRayTracer::release_retired_storage()
+{
+  std::vector<const PrimitiveRef*> buffers;
+  buffers.reserve(surface_user_data_map_.size());
+  for (const auto& [geometry, surface_data] : surface_user_data_map_)
+    buffers.push_back(surface_data->prim_ref_buffer);
+  std::sort(buffers.begin(), buffers.end(), std::less<const PrimitiveRef*>());
+
+  // storage is in use if any remaining surface buffer starts within it
+  auto in_use = [&buffers](const std::vector<PrimitiveRef>& storage) {
+    const PrimitiveRef* begin = storage.data();
+    const PrimitiveRef* end = begin + storage.size();
+    auto it = std::lower_bound(buffers.begin(), buffers.end(), begin, std::less<const PrimitiveRef*>());
+    return it != buffers.end() && std::less<const PrimitiveRef*>()(*it, end);
+  };
+  retired_primitive_ref_storage_.erase(
+    std::remove_if(retired_primitive_ref_storage_.begin(), retired_primitive_ref_storage_.end(),
+                   [&in_use](const std::vector<PrimitiveRef>& storage) { return !in_use(storage); }),
+    retired_primitive_ref_storage_.end());
+}
+
+void EmbreeRayTracer::find_element_batch(TreeID tree,
+                                         const std::vector<Position>& points,
+                                         std::vector<MeshID>& elements) const
+{
+  // the element containment callbacks handle single rays only, so points
+  // are located independently across threads rather than in packets
+  elements.resize(points.size());
+  #ifdef XDG_HAVE_OPENMP
+  #pragma omp parallel for schedule(static) num_threads(std::max(XDGConfig::config().n_threads(), 1))
+  #endif
+  for (size_t i = 0; i < points.size(); ++i) {
+    elements[i] = find_element(tree, points[i]);
+  }
+}
+
 MeshID EmbreeRayTracer::find_element(const Position& point) const
 {
   return find_element(global_element_tree_, point);
@@ -233,13 +634,12 @@ MeshID EmbreeRayTracer::find_element(ElementTreeID tree,
                                      const Position& point) const
 {
 
-  if (!element_volume_tree_to_scene_map_.count(tree)) {
+  RTCScene scene = element_scene(tree);
+  if (!scene) {
     warning(fmt::format("Tree {} does not have a point location tree", tree));
     return ID_NONE;
   }
 
-  RTCScene scene = element_volume_tree_to_scene_map_.at(tree);
-
   RTCElementDualRay ray;
   ray.set_org(point);
   ray.set_dir({1.0, 0.0, 0.0});
@@ -248,6 +648,7 @@ MeshID EmbreeRayTracer::find_element(ElementTreeID tree,
 
   // fire an occlusion ray
   {
+    XDG_COUNT_QUERY(ELEMENT_QUERIES);
     rtcOccluded1(scene, (RTCRay*)&ray);
   }
 
@@ -259,9 +660,9 @@ MeshID EmbreeRayTracer::find_element(ElementTreeID tree,
 bool EmbreeRayTracer::point_in_volume(SurfaceTreeID tree,
                                 const Position& point,
                                 const Direction* direction,
-                                const std::vector<MeshID>* exclude_primitives) const
+                                const PrimitiveExclusionSet* exclude_primitives) const
 {
-  RTCScene scene = surface_volume_tree_to_scene_map_.at(tree);
+  RTCScene scene = surface_scene(tree);
   RTCDualRayHit rayhit; // embree specfic rayhit struct (payload?)
   rayhit.ray.set_org(point);
   if (direction != nullptr) rayhit.ray.set_dir(*direction);
@@ -271,10 +672,10 @@ bool EmbreeRayTracer::point_in_volume(SurfaceTreeID tree,
   rayhit.ray.set_tfar(INFTY);
   rayhit.ray.set_tnear(0.0);
   rayhit.ray.volume_tree = tree;
-
-  if (exclude_primitives != nullptr) rayhit.ray.exclude_primitives = exclude_primitives;
+  rayhit.ray.exclude_primitives = exclude_primitives;
 
   {
+    XDG_COUNT_QUERY(RAYS);
     rtcIntersect1(scene, (RTCRayHit*)&rayhit);
   }
 
@@ -286,16 +687,100 @@ bool EmbreeRayTracer::point_in_volume(SurfaceTreeID tree,
   return rayhit.ray.ddir.dot(rayhit.hit.dNg) > 0.0;
 }
 
-std::pair<double, MeshID>
-EmbreeRayTracer::ray_fire(SurfaceTreeID tree,
-                    const Position& origin,
-                    const Direction& direction,
-                    const double dist_limit,
-                    HitOrientation orientation,
-                    std::vector<MeshID>* const exclude_primitves)
+void
+EmbreeRayTracer::point_in_volume_batch(SurfaceTreeID tree,
+                                       const std::vector<Position>& points,
+                                       std::vector<uint8_t>& results,
+                                       const std::vector<Direction>& directions) const
 {
-  RTCScene scene = surface_volume_tree_to_scene_map_.at(tree);
-  RTCDualRayHit rayhit;
+  if (!directions.empty() && directions.size() != points.size())
+    fatal_error("Number of ray directions ({}) does not match the number of points ({})",
+                directions.size(), points.size());
+  RTCScene scene = surface_scene(tree);
+
+  switch (packet_width_) {
+    case 16:
+      point_in_volume_packets<16>(scene, tree, points, results, directions);
+      break;
+    case 8:
+      point_in_volume_packets<8>(scene, tree, points, results, directions);
+      break;
+    case 4:
+      point_in_volume_packets<4>(scene, tree, points, results, directions);
+      break;
+    default:
+      point_in_volume_packets<1>(scene, tree, points, results, directions);
+  }
+}
+
+template<int N>
+void
+EmbreeRayTracer::point_in_volume_packets(RTCScene scene,
+                                         SurfaceTreeID tree,
+                                         const std::vector<Position>& points,
+                                         std::vector<uint8_t>& results,
+                                         const std::vector<Direction>& directions) const
+{
+  size_t n_points = points.size();
+  results.resize(n_points);
+  const Direction default_direction {1. / std::sqrt(2.0), 1. / std::sqrt(2.0), 0.0};
+
+  // each packet writes a disjoint range of the results, so the output is
+  // independent of the number of threads
+  size_t n_packets = (n_points + N - 1) / N;
+  #ifdef XDG_HAVE_OPENMP
+  #pragma omp parallel for schedule(static) num_threads(std::max(XDGConfig::config().n_threads(), 1))
+  #endif
+  for (size_t packet = 0; packet < n_packets; ++packet) {
+    size_t offset = packet * N;
+    int n_active = std::min(n_points - offset, static_cast<size_t>(N));
+
+    if constexpr (N == 1) {
+      const Direction* direction = directions.empty() ? nullptr : &directions[offset];
+      results[offset] = point_in_volume(tree, points[offset], direction);
+      continue;
+    } else {
+      RTCDualRayHitN<N> rayhit;
+      alignas(64) int valid[N];
+      for (int i = 0; i < N; i++) {
+        valid[i] = i < n_active ? -1 : 0;
+        if (i >= n_active) continue;
+
+        size_t idx = offset + i;
+        rayhit.set_org(i, points[idx]);
+        rayhit.set_dir(i, directions.empty() ? default_direction : directions[idx]);
+        rayhit.set_tfar(i, INFTY);
+        rayhit.set_tnear(i, 0.0);
+        rayhit.rf_type[i] = RayFireType::VOLUME;
+        rayhit.orientation[i] = HitOrientation::ANY;
+        rayhit.volume_tree[i] = tree;
+        rayhit.exclude_primitives[i] = nullptr;
+      }
+
+      XDG_COUNT_QUERY_N(RAYS, n_active);
+      if constexpr (N == 4) rtcIntersect4(valid, scene, &rayhit);
+      else if constexpr (N == 8) rtcIntersect8(valid, scene, &rayhit);
+      else rtcIntersect16(valid, scene, &rayhit);
+
+      // as in point_in_volume, an exiting hit means the point is inside
+      for (int i = 0; i < n_active; i++) {
+        bool hit = rayhit.hit.geomID[i] != RTC_INVALID_GEOMETRY_ID;
+        results[offset + i] = hit && rayhit.dir(i).dot(rayhit.dNg[i]) > 0.0;
+      }
+    }
+  }
+}
+
+void
+EmbreeRayTracer::fire_volume_ray(SurfaceTreeID tree,
+                                 const Position& origin,
+                                 const Direction& direction,
+                                 const double dist_limit,
+                                 HitOrientation orientation,
+                                 const PrimitiveExclusionSet* exclude_primitves,
+                                 RTCDualRayHit& rayhit) const
+{
+  RTCScene scene = surface_scene(tree);
   // set ray data
   rayhit.ray.set_org(origin);
   rayhit.ray.set_dir(direction);
@@ -310,12 +795,25 @@ EmbreeRayTracer::ray_fire(SurfaceTreeID tree,
 
   // fire the ray
   {
+    XDG_COUNT_QUERY(RAYS);
     rtcIntersect1(scene, (RTCRayHit*)&rayhit);
     // TODO: I don't quite understand this...
     rayhit.hit.Ng_x *= -1.0;
     rayhit.hit.Ng_y *= -1.0;
     rayhit.hit.Ng_z *= -1.0;
   }
+}
+
+std::pair<double, MeshID>
+EmbreeRayTracer::ray_fire(SurfaceTreeID tree,
+                    const Position& origin,
+                    const Direction& direction,
+                    const double dist_limit,
+                    HitOrientation orientation,
+                    PrimitiveExclusionSet* const exclude_primitves)
+{
+  RTCDualRayHit rayhit;
+  fire_volume_ray(tree, origin, direction, dist_limit, orientation, exclude_primitves, rayhit);
 
   if (rayhit.hit.geomID == RTC_INVALID_GEOMETRY_ID)
     return {INFTY, ID_NONE};
@@ -325,16 +823,167 @@ EmbreeRayTracer::ray_fire(SurfaceTreeID tree,
     return {rayhit.ray.dtfar, rayhit.hit.surface};
 }
 
+HitRecord
+EmbreeRayTracer::ray_fire_record(SurfaceTreeID tree,
+                                 const Position& origin,
+                                 const Direction& direction,
+                                 const double dist_limit,
+                                 HitOrientation orientation,
+                                 PrimitiveExclusionSet* const exclude_primitives)
+{
+  RTCDualRayHit rayhit;
+  fire_volume_ray(tree, origin, direction, dist_limit, orientation, exclude_primitives, rayhit);
+
+  HitRecord record;
+  if (rayhit.hit.geomID == RTC_INVALID_GEOMETRY_ID) return record;
+
+  record.distance = rayhit.ray.dtfar;
+  record.surface = rayhit.hit.surface;
+  record.primitive = rayhit.hit.primitive_ref->primitive_id;
+  record.normal = rayhit.hit.dNg;
+  record.next_volume = rayhit.hit.next_volume;
+  if (exclude_primitives) exclude_primitives->push_back(record.primitive);
+  return record;
+}
+
+void
+EmbreeRayTracer::surface_crossings(SurfaceTreeID tree,
+                                   const Position& origin,
+                                   const Direction& direction,
+                                   std::vector<RayCrossing>& crossings,
+                                   double dist_limit,
+                                   int max_crossings) const
+{
+  crossings.clear();
+  if (max_crossings == 0) return;
+
+  RTCScene scene = surface_scene(tree);
+  RTCDualRayHit rayhit;
+  rayhit.ray.set_org(origin);
+  rayhit.ray.set_dir(direction);
+  rayhit.ray.set_tfar(dist_limit);
+  rayhit.ray.set_tnear(0.0);
+  rayhit.ray.rf_type = RayFireType::ACCUMULATE_HITS;
+  rayhit.ray.orientation = HitOrientation::ANY;
+  rayhit.ray.volume_tree = tree;
+  rayhit.ray.crossings = &crossings;
+  rayhit.ray.max_crossings = max_crossings;
+
+  // crossings are recorded by the intersection callbacks, which never commit
+  // a hit so that the traversal visits every primitive along the ray
+  XDG_COUNT_QUERY(RAYS);
+  rtcIntersect1(scene, (RTCRayHit*)&rayhit);
+
+  std::sort(crossings.begin(), crossings.end(),
+            [](const RayCrossing& a, const RayCrossing& b) { return a.distance < b.distance; });
+
+  // a ray through an edge or vertex hits each primitive sharing it, keep one
+  // crossing per surface at each location. Capped crossings were already
+  // deduplicated as they were added
+  if (max_crossings < 0) remove_duplicate_crossings(crossings);
+}
+
+void
+EmbreeRayTracer::ray_fire_batch(SurfaceTreeID tree,
+                                const std::vector<Position>& origins,
+                                const std::vector<Direction>& directions,
+                                const std::vector<double>& dist_limits,
+                                std::vector<std::pair<double, MeshID>>& hits,
+                                HitOrientation orientation,
+                                const std::vector<PrimitiveExclusionSet*>& exclude_primitives)
+{
+  check_batch_sizes(origins, directions, dist_limits, exclude_primitives);
+  RTCScene scene = surface_scene(tree);
+
+  switch (packet_width_) {
+    case 16:
+      ray_fire_packets<16>(scene, tree, origins, directions, dist_limits, hits, orientation, exclude_primitives);
+      break;
+    case 8:
+      ray_fire_packets<8>(scene, tree, origins, directions, dist_limits, hits, orientation, exclude_primitives);
+      break;
+    case 4:
+      ray_fire_packets<4>(scene, tree, origins, directions, dist_limits, hits, orientation, exclude_primitives);
+      break;
+    default:
+      RayTracer::ray_fire_batch(tree, origins, directions, dist_limits, hits, orientation, exclude_primitives);
+  }
+}
+
+template<int N>
+void
+EmbreeRayTracer::ray_fire_packets(RTCScene scene,
+                                  SurfaceTreeID tree,
+                                  const std::vector<Position>& origins,
+                                  const std::vector<Direction>& directions,
+                                  const std::vector<double>& dist_limits,
+                                  std::vector<std::pair<double, MeshID>>& hits,
+                                  HitOrientation orientation,
+                                  const std::vector<PrimitiveExclusionSet*>& exclude_primitives)
+{
+  size_t n_rays = origins.size();
+  hits.resize(n_rays);
+
+  // each packet writes a disjoint range of the hits and exclusion sets, so
+  // the output is independent of the number of threads
+  size_t n_packets = (n_rays + N - 1) / N;
+  #ifdef XDG_HAVE_OPENMP
+  #pragma omp parallel for schedule(static) num_threads(std::max(XDGConfig::config().n_threads(), 1))
+  #endif
+  for (size_t packet = 0; packet < n_packets; ++packet) {
+    size_t offset = packet * N;
+    int n_active = std::min(n_rays - offset, static_cast<size_t>(N));
+
+    RTCDualRayHitN<N> rayhit;
+    alignas(64) int valid[N];
+    for (int i = 0; i < N; i++) {
+      valid[i] = i < n_active ? -1 : 0;
+      if (i >= n_active) continue;
+
+      size_t idx = offset + i;
+      // set ray data
+      rayhit.set_org(i, origins[idx]);
+      rayhit.set_dir(i, directions[idx]);
+      rayhit.set_tfar(i, dist_limits.empty() ? INFTY : dist_limits[idx]);
+      rayhit.set_tnear(i, 0.0);
+      rayhit.rf_type[i] = RayFireType::VOLUME;
+      rayhit.orientation[i] = orientation;
+      rayhit.volume_tree[i] = tree;
+      rayhit.exclude_primitives[i] = exclude_primitives.empty() ? nullptr : exclude_primitives[idx];
+    }
+
+    // fire the packet
+    XDG_COUNT_QUERY_N(RAYS, n_active);
+    if constexpr (N == 4) rtcIntersect4(valid, scene, &rayhit);
+    else if constexpr (N == 8) rtcIntersect8(valid, scene, &rayhit);
+    else rtcIntersect16(valid, scene, &rayhit);
+
+    for (int i = 0; i < n_active; i++) {
+      size_t idx = offset + i;
+      if (rayhit.hit.geomID[i] == RTC_INVALID_GEOMETRY_ID) {
+        hits[idx] = {INFTY, ID_NONE};
+        continue;
+      }
+      if (!exclude_primitives.empty() && exclude_primitives[idx])
+        exclude_primitives[idx]->push_back(rayhit.primitive_ref[i]->primitive_id);
+      hits[idx] = {rayhit.dtfar[i], rayhit.surface[i]};
+    }
+  }
+}
+
 std::pair<double, MeshID> EmbreeRayTracer::closest(SurfaceTreeID tree,
-                                                   const Position& point)
+                                                   const Position& point,
+                                                   double max_radius)
 {
-  RTCScene scene = surface_volume_tree_to_scene_map_.at(tree);
+  RTCScene scene = surface_scene(tree);
   RTCDPointQuery query;
   query.set_point(point);
+  query.set_radius(max_radius);
 
   RTCPointQueryContext context;
   rtcInitPointQueryContext(&context);
 
+  XDG_COUNT_QUERY(CLOSEST_QUERIES);
   rtcPointQuery(scene, &query, &context, (RTCPointQueryFunction)&TriangleClosestFunc, &scene);
 
   if (query.geomID == RTC_INVALID_GEOMETRY_ID) {
@@ -344,12 +993,28 @@ std::pair<double, MeshID> EmbreeRayTracer::closest(SurfaceTreeID tree,
   return {query.dradius, query.primitive_ref->primitive_id};
 }
 
+void EmbreeRayTracer::closest_distance_batch(SurfaceTreeID tree,
+                                             const std::vector<Position>& points,
+                                             std::vector<double>& distances,
+                                             double max_radius)
+{
+  // point queries are traversed one at a time by Embree, the cost of each
+  // varies with the search radius so points are scheduled dynamically
+  distances.resize(points.size());
+  #ifdef XDG_HAVE_OPENMP
+  #pragma omp parallel for schedule(dynamic, 64) num_threads(std::max(XDGConfig::config().n_threads(), 1))
+  #endif
+  for (size_t i = 0; i < points.size(); ++i) {
+    distances[i] = closest(tree, points[i], max_radius).first;
+  }
+}
+
 bool EmbreeRayTracer::occluded(SurfaceTreeID tree,
                          const Position& origin,
                          const Direction& direction,
                          double& distance) const
 {
-  RTCScene scene = surface_volume_tree_to_scene_map_.at(tree);
+  RTCScene scene = surface_scene(tree);
   RTCSurfaceDualRay ray;
   ray.set_org(origin);
   ray.set_dir(direction);
@@ -362,6 +1027,7 @@ bool EmbreeRayTracer::occluded(SurfaceTreeID tree,
 
   // fire the ray
   {
+    XDG_COUNT_QUERY(RAYS);
     rtcOccluded1(scene, (RTCRay*)&ray);
   }
 
@@ -259,7 +259,7 @@ GPRTRayTracer::create_element_tree(const std::shared_ptr<MeshManager>& mesh_mana
 bool GPRTRayTracer::point_in_volume(SurfaceTreeID tree, 
                                     const Position& point,
                                     const Direction* direction,
-                                    const std::vector<MeshID>* exclude_primitives) const
+                                    const PrimitiveExclusionSet* exclude_primitives) const
 {
   GPRTAccel volume = surface_volume_tree_to_accel_map.at(tree);
   auto rayGen = rayGenPrograms_.at(RayGenType::POINT_IN_VOLUME);
@@ -282,7 +282,10 @@ bool GPRTRayTracer::point_in_volume(SurfaceTreeID tree,
   if (exclude_primitives) {
     if (!exclude_primitives->empty()) gprtBufferResize(context_, excludePrimitivesBuffer_, exclude_primitives->size(), false);
     gprtBufferMap(excludePrimitivesBuffer_);
-    std::copy(exclude_primitives->begin(), exclude_primitives->end(), gprtBufferGetHostPointer(excludePrimitivesBuffer_));
+    {
+      MeshID* excluded = gprtBufferGetHostPointer(excludePrimitivesBuffer_);
+      for (size_t i = 0; i < exclude_primitives->size(); i++) excluded[i] = (*exclude_primitives)[i];
+    }
     gprtBufferUnmap(excludePrimitivesBuffer_);
 
     ray[0].exclude_primitives = gprtBufferGetDevicePointer(excludePrimitivesBuffer_);
@@ -320,7 +323,7 @@ std::pair<double, MeshID> GPRTRayTracer::ray_fire(SurfaceTreeID tree,
                                                   const Direction& direction,
                                                   double dist_limit,
                                                   HitOrientation orientation,
-                                                  std::vector<MeshID>* const exclude_primitives) 
+                                                  PrimitiveExclusionSet* const exclude_primitives) 
 {
   GPRTAccel volume = surface_volume_tree_to_accel_map.at(tree);
   auto rayGen = rayGenPrograms_.at(RayGenType::RAY_FIRE);
@@ -339,7 +342,10 @@ std::pair<double, MeshID> GPRTRayTracer::ray_fire(SurfaceTreeID tree,
   if (exclude_primitives) {
     if (!exclude_primitives->empty()) gprtBufferResize(context_, excludePrimitivesBuffer_, exclude_primitives->size(), false);
     gprtBufferMap(excludePrimitivesBuffer_);
-    std::copy(exclude_primitives->begin(), exclude_primitives->end(), gprtBufferGetHostPointer(excludePrimitivesBuffer_));
+    {
+      MeshID* excluded = gprtBufferGetHostPointer(excludePrimitivesBuffer_);
+      for (size_t i = 0; i < exclude_primitives->size(); i++) excluded[i] = (*exclude_primitives)[i];
+    }
     gprtBufferUnmap(excludePrimitivesBuffer_);
 
     ray[0].exclude_primitives = gprtBufferGetDevicePointer(excludePrimitivesBuffer_);
@@ -4,6 +4,7 @@
 #include "xdg/error.h"
 #include "xdg/geometry/plucker.h"
 #include "xdg/geometry/face_common.h"
+#include "xdg/timer.h"
 #include "xdg/util/str_utils.h"
 
 #include "libmesh/boundary_info.h"
@@ -21,12 +22,15 @@ LibMeshManager::LibMeshManager(const libMesh::MeshBase* ptr) {
 LibMeshManager::LibMeshManager() : MeshManager() {}
 
 void LibMeshManager::load_file(const std::string &filepath) {
+  ScopedTimer timer("LibMeshManager::load_file");
   managed_mesh_ = std::make_unique<libMesh::Mesh>(*XDGConfig::config().libmesh_comm(), 3);
   managed_mesh_->read(filepath);
   mesh_ = managed_mesh_.get();
 }
 
 void LibMeshManager::init() {
+  ScopedTimer timer("LibMeshManager::init");
+
   // ensure that the mesh is 3-dimensional, for our use case this is expected
   if (mesh()->mesh_dimension() != 3) {
     fatal_error("Mesh must be 3-dimensional");
@@ -167,6 +171,7 @@ void LibMeshManager::add_surface_to_volume(MeshID volume, MeshID surface, Sense
 }
 
 void LibMeshManager::parse_metadata() {
+  ScopedTimer timer("LibMeshManager::parse_metadata");
   // surface metadata
   auto boundary_info = mesh()->get_boundary_info();
   auto sideset_name_map = boundary_info.get_sideset_name_map();
@@ -201,6 +206,32 @@ void LibMeshManager::parse_metadata() {
   }
 }
 
+void LibMeshManager::memory_report(MemoryReport& report) const {
+  MeshManager::memory_report(report);
+
+  report.add("mesh/libmesh_sidepair_maps", unordered_map_memory(mesh_id_to_sidepair_) +
+                                           unordered_map_memory(sidepair_to_mesh_id_));
+
+  size_t surface_bytes = unordered_map_memory(sideset_face_map_) +
+                         unordered_map_memory(subdomain_interface_map_) +
+                         unordered_map_memory(sideset_interface_map_) +
+                         unordered_map_memory(sideset_interface_face_map_) +
+                         unordered_map_memory(sideset_surface_map_) +
+                         unordered_map_memory(surface_map_) +
+                         unordered_map_memory(surface_senses_);
+  for (const auto& map : {&sideset_face_map_, &sideset_surface_map_, &surface_map_})
+    for (const auto& [id, faces] : *map) surface_bytes += vector_memory(faces);
+  for (const auto& [pair, faces] : subdomain_interface_map_)
+    surface_bytes += ordered_map_memory(faces);
+  for (const auto& [sideset, pairs] : sideset_interface_map_)
+    surface_bytes += ordered_map_memory(pairs);
+  for (const auto& [sideset, pair_faces] : sideset_interface_face_map_) {
+    surface_bytes += ordered_map_memory(pair_faces);
+    for (const auto& [pair, faces] : pair_faces) surface_bytes += vector_memory(faces);
+  }
+  report.add("mesh/libmesh_surface_maps", surface_bytes);
+}
+
 void LibMeshManager::map_id_spaces() {
   // build the BlockMapping for volume elements
   std::vector<MeshID> volume_element_ids;
@@ -541,6 +572,30 @@ LibMeshManager::element_vertices(MeshID element) const {
   return vertices;
 }
 
+std::array<Vertex, 4>
+LibMeshManager::tet_vertices(MeshID element) const {
+  const auto& elem = mesh()->elem_ref(element);
+  std::array<Vertex, 4> vertices;
+  for (unsigned int i = 0; i < 4; ++i) {
+    const auto& node = elem.node_ref(i);
+    vertices[i] = {node(0), node(1), node(2)};
+  }
+  return vertices;
+}
+
+const std::array<std::array<int, 3>, 4>&
+LibMeshManager::tet_face_ordering() const {
+  // libMesh's side-to-node mapping for first order tetrahedra
+  static const std::array<std::array<int, 3>, 4> ordering = [] {
+    std::array<std::array<int, 3>, 4> ordering;
+    for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 3; j++)
+        ordering[i][j] = libMesh::Tet4::side_nodes_map[i][j];
+    return ordering;
+  }();
+  return ordering;
+}
+
 std::array<Vertex, 3>
 LibMeshManager::face_vertices(MeshID element) const {
   const auto& side_pair = sidepair(element);
@@ -0,0 +1,43 @@
+#include "fmt/format.h"
+
+#include "xdg/memory_report.h"
+
+namespace xdg {
+
+size_t MemoryReport::subsystem(const std::string& name) const
+{
+  size_t bytes = 0;
+  for (const auto& [subsystem, subsystem_bytes] : subsystems)
+    if (subsystem == name) bytes += subsystem_bytes;
+  return bytes;
+}
+
+size_t MemoryReport::total() const
+{
+  size_t bytes = 0;
+  for (const auto& [subsystem, subsystem_bytes] : subsystems) bytes += subsystem_bytes;
+  return bytes;
+}
+
+std::string MemoryReport::to_string() const
+{
+  constexpr double MIB {1024.0 * 1024.0};
+
+  std::string out = fmt::format("{:<44} {:>16} {:>12}\n", "Subsystem", "Bytes", "MiB");
+  for (const auto& [subsystem, bytes] : subsystems)
+    out += fmt::format("{:<44} {:>16} {:>12.3f}\n", subsystem, bytes, bytes / MIB);
+  out += fmt::format("{:<44} {:>16} {:>12.3f}\n", "Total", total(), total() / MIB);
+
+  if (volumes.empty()) return out;
+
+  out += fmt::format("\n{:<44} {:>16} {:>12}\n", "Volume", "Bytes", "MiB");
+  for (const auto& [volume, bytes] : volumes) {
+    out += fmt::format("{:<44} {:>16} {:>12.3f}", volume, bytes, bytes / MIB);
+    out += unmeasured_volumes.count(volume) ? "  (BVH not measured)\n" : "\n";
+  }
+  if (!unmeasured_volumes.empty())
+    out += "BVHs built concurrently aren't measured, see XDGConfig::measure_tree_memory\n";
+  return out;
+}
+
+} // namespace xdg
@@ -7,6 +7,7 @@
 #include "xdg/geometry/plucker.h"
 #include "xdg/geometry/face_common.h"
 #include "xdg/element_face_accessor.h"
+#include "xdg/query_stats.h"
 
 namespace xdg {
 
@@ -72,6 +73,16 @@ MeshManager::num_volume_elements() const
   return n_elements;
 }
 
+void
+MeshManager::memory_report(MemoryReport& report) const
+{
+  report.add("mesh/tet_topology", tet_topology_.memory());
+  report.add("mesh/id_maps", vector_memory(volume_element_id_map_.blocks()) +
+                             vector_memory(vertex_id_map_.blocks()) +
+                             vector_memory(volumes_) + vector_memory(surfaces_));
+  report.add("mesh/metadata", ordered_map_memory(volume_metadata_) + ordered_map_memory(surface_metadata_));
+}
+
 std::vector<MeshID>
 MeshManager::get_volume_faces(MeshID volume) const
 {
@@ -103,35 +114,66 @@ MeshManager::get_surface_property(MeshID surface, PropertyType type) const
   return surface_metadata_.at({surface, type});
 }
 
+std::array<Vertex, 4>
+MeshManager::tet_vertices(MeshID element) const
+{
+  auto vertices = element_vertices(element);
+  if (vertices.size() != 4)
+    fatal_error("Element {} is not a tetrahedron", element);
+  return {vertices[0], vertices[1], vertices[2], vertices[3]};
+}
+
+void
+MeshManager::build_tet_topology(const std::array<std::array<int, 3>, 4>& face_ordering)
+{
+  tet_topology_.clear();
+
+  MeshIndex n_elements = num_volume_elements();
+  if (n_elements == 0) return;
+
+  tet_topology_.face_ordering = face_ordering;
+  tet_topology_.connectivity.resize(4 * n_elements);
+  tet_topology_.neighbors.resize(4 * n_elements);
+  tet_topology_.element_ids.resize(n_elements);
+
+  for (MeshIndex i = 0; i < n_elements; i++) {
+    MeshID element = element_id(i);
+    tet_topology_.element_ids[i] = element;
+
+    auto conn = element_connectivity(element);
+    if (conn.size() != 4)
+      fatal_error("Element {} is not a tetrahedron, cannot build tetrahedral topology", element);
+
+    for (int j = 0; j < 4; j++) {
+      tet_topology_.connectivity[4 * i + j] = vertex_index(conn[j]);
+      MeshID neighbor = adjacent_element(element, j);
+      tet_topology_.neighbors[4 * i + j] = neighbor == ID_NONE ? INDEX_NONE : element_index(neighbor);
+    }
+  }
+
+  int n_vertices = num_vertices();
+  tet_topology_.x.resize(n_vertices);
+  tet_topology_.y.resize(n_vertices);
+  tet_topology_.z.resize(n_vertices);
+  for (int i = 0; i < n_vertices; i++) {
+    Vertex v = vertex_coordinates(vertex_id(i));
+    tet_topology_.x[i] = v.x;
+    tet_topology_.y[i] = v.y;
+    tet_topology_.z[i] = v.z;
+  }
+
+  tet_topology_.n_elements = n_elements;
+}
+
 std::vector<std::pair<MeshID, double>>
 MeshManager::walk_elements(MeshID starting_element,
                            const Position& start,
                            const Direction& u,
                            double distance) const
 {
-  // a copy of the start position that will be updated as elements are traversed
-  Position r = start;
   std::vector<std::pair<MeshID, double>> result;
-
-  MeshID elem = starting_element;
-  while (distance > 0) {
-    // find the exit point from the current element and determine the next element
-    // if one exists
-    auto exit = next_element(elem, r, u);
-    // ensure we are not traveling beyond the end of the ray
-    exit.second = std::min(exit.second, distance);
-    distance -= exit.second;
-    // only add to the result if the distance is greater than 0
-    result.push_back({elem, exit.second});
-    r += exit.second * u;
-    elem = exit.first;
-
-    // if there is no next element, we're exiting the mesh
-    if (elem == ID_NONE) {
-      break;
-    }
-  }
-
+  walk_elements(starting_element, start, u, distance,
+                [&result](MeshID element, double length) { result.push_back({element, length}); });
   return result;
 }
 
@@ -146,23 +188,48 @@ MeshManager::walk_elements(MeshID starting_element,
   return walk_elements(starting_element, start, u, distance);
 }
 
+MeshID
+MeshManager::locate_element(MeshID hint_element,
+                            const Position& point,
+                            int max_steps) const
+{
+  if (!tet_topology_.empty()) {
+    MeshIndex element = tet_topology_.locate(element_index(hint_element), point, max_steps);
+    return element == INDEX_NONE ? ID_NONE : tet_topology_.element_ids[element];
+  }
+
+  const auto& face_ordering = tet_face_ordering();
+  MeshID element = hint_element;
+  for (int step = 0; step < max_steps && element != ID_NONE; step++) {
+    int face = locate_step(tet_barycentric_coordinates(tet_vertices(element), point), face_ordering);
+    if (face == -1) return element;
+    if (face == -2) return ID_NONE;
+    element = adjacent_element(element, face);
+  }
+  return ID_NONE;
+}
+
 std::pair<MeshID, double>
 MeshManager::next_element(MeshID current_element,
                            const Position& r,
                            const Position& u) const
 {
+  XDG_COUNT_QUERY(TET_STEPS);
+  if (!tet_topology_.empty()) {
+    auto exit = tet_topology_.next_element(element_index(current_element), r, u);
+    MeshID next = exit.first == INDEX_NONE ? ID_NONE : tet_topology_.element_ids[exit.first];
+    return {next, exit.second};
+  }
+
   std::array<double, 4> dists = {INFTY, INFTY, INFTY, INFTY};
   std::array<bool, 4> hit_types;
 
-  auto element_face_accessor = ElementFaceAccessor::create(this, current_element);
+  ElementFaceAccessor element_face_accessor(this, current_element);
 
   // get the faces (triangles) of this element
   for (int i = 0; i < 4; i++) {
     // triangle connectivity
-    auto coords = element_face_accessor->face_vertices(i);
-
-    // get the normal of the triangle face
-    const Position normal = triangle_normal(coords);
+    auto coords = element_face_accessor.face_vertices(i);
 
     // exiting hit only, assumes triangle normals point outward
     // with respect to the element
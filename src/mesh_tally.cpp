@@ -0,0 +1,106 @@
+#include <algorithm>
+
+#include "xdg/mesh_tally.h"
+#include "xdg/config.h"
+#include "xdg/error.h"
+#include "xdg/xdg.h"
+
+#ifdef XDG_HAVE_OPENMP
+#include "omp.h"
+#endif
+
+using namespace xdg;
+
+MeshTally::MeshTally(std::shared_ptr<MeshManager> mesh_manager,
+                     TallyAccumulation accumulation,
+                     int n_threads)
+: mesh_manager_(mesh_manager), accumulation_(accumulation), n_threads_(n_threads)
+{
+  if (!mesh_manager_) fatal_error("A mesh manager is required to create a mesh tally");
+  if (n_threads_ < 1) n_threads_ = std::max(XDGConfig::config().n_threads(), 1);
+  n_elements_ = mesh_manager_->num_volume_elements();
+
+  switch (accumulation_) {
+    case TallyAccumulation::THREAD_PRIVATE:
+      thread_scores_.resize(n_threads_);
+      for (auto& scores : thread_scores_) scores.resize(n_elements_, 0.0);
+      break;
+    case TallyAccumulation::ATOMIC:
+      // atomics can't be copied or moved, so the vector is sized on construction
+      atomic_scores_ = std::vector<std::atomic<double>>(n_elements_);
+      break;
+    case TallyAccumulation::STRIPED_LOCK:
+      shared_scores_.resize(n_elements_, 0.0);
+      stripes_ = std::vector<LockStripe>(N_LOCK_STRIPES);
+      break;
+  }
+  reset();
+}
+
+void MeshTally::score_track(const XDG& xdg,
+                            const Position& start,
+                            const Position& end,
+                            int thread)
+{
+  // the walk provides the element index, avoiding an ID lookup per segment
+  xdg.segments(start, end, [&](MeshID, double length, MeshIndex index) {
+    score_index(index, length, thread);
+  });
+}
+
+void MeshTally::score_tracks(const XDG& xdg,
+                             const std::vector<std::pair<Position, Position>>& tracks)
+{
+  #ifdef XDG_HAVE_OPENMP
+  #pragma omp parallel for schedule(dynamic, 64) num_threads(n_threads_)
+  #endif
+  for (size_t i = 0; i < tracks.size(); ++i) {
+    int thread = 0;
+    #ifdef XDG_HAVE_OPENMP
+    thread = omp_get_thread_num();
+    #endif
+    score_track(xdg, tracks[i].first, tracks[i].second, thread);
+  }
+}
+
+void MeshTally::finalize(bool normalize)
+{
+  results_.resize(n_elements_);
+
+  #ifdef XDG_HAVE_OPENMP
+  #pragma omp parallel for schedule(static) num_threads(n_threads_)
+  #endif
+  for (MeshIndex i = 0; i < n_elements_; ++i) {
+    double total = 0.0;
+    switch (accumulation_) {
+      case TallyAccumulation::THREAD_PRIVATE:
+        for (const auto& scores : thread_scores_) total += scores[i];
+        break;
+      case TallyAccumulation::ATOMIC:
+        total = atomic_scores_[i].load(std::memory_order_relaxed);
+        break;
+      case TallyAccumulation::STRIPED_LOCK:
+        total = shared_scores_[i];
+        break;
+    }
+    if (normalize) total /= mesh_manager_->element_volume(mesh_manager_->element_id(i));
+    results_[i] = total;
+  }
+}
+
+void MeshTally::reset()
+{
+  for (auto& scores : thread_scores_) std::fill(scores.begin(), scores.end(), 0.0);
+  for (auto& score : atomic_scores_) score.store(0.0, std::memory_order_relaxed);
+  std::fill(shared_scores_.begin(), shared_scores_.end(), 0.0);
+  results_.clear();
+}
+
+size_t MeshTally::memory() const
+{
+  size_t bytes = (shared_scores_.capacity() + results_.capacity()) * sizeof(double) +
+                 atomic_scores_.capacity() * sizeof(std::atomic<double>) +
+                 stripes_.capacity() * sizeof(LockStripe);
+  for (const auto& scores : thread_scores_) bytes += scores.capacity() * sizeof(double);
+  return bytes;
+}
@@ -4,6 +4,7 @@
 #include "moab/Range.hpp"
 
 #include "xdg/moab/direct_access.h"
+#include "xdg/timer.h"
 
 namespace xdg {
 
@@ -17,11 +18,27 @@ MBDirectAccess::MBDirectAccess(Interface* mbi)
 
 void
 MBDirectAccess::setup() {
-  face_data_.setup(mbi);
-  element_data_.setup(mbi);
-  vertex_data_.setup(mbi);
-  element_adjacency_data_.setup(mbi);
-  boundary_face_adjacency_data_.setup(mbi, face_data_);
+  ScopedTimer timer("MBDirectAccess::setup");
+  {
+    ScopedTimer phase_timer("face_data");
+    face_data_.setup(mbi);
+  }
+  {
+    ScopedTimer phase_timer("element_data");
+    element_data_.setup(mbi);
+  }
+  {
+    ScopedTimer phase_timer("vertex_data");
+    vertex_data_.setup(mbi);
+  }
+  {
+    ScopedTimer phase_timer("element_adjacency");
+    element_adjacency_data_.setup(mbi);
+  }
+  {
+    ScopedTimer phase_timer("boundary_face_adjacency");
+    boundary_face_adjacency_data_.setup(mbi, face_data_);
+  }
 }
 
 void
@@ -34,6 +51,24 @@ MBDirectAccess::clear()
   boundary_face_adjacency_data_.clear();
 }
 
+size_t
+MBDirectAccess::memory() const
+{
+  size_t bytes = 0;
+  for (const auto* data : {&face_data_, &element_data_})
+    bytes += vector_memory(data->first_elements) + vector_memory(data->vconn);
+
+  bytes += unordered_map_memory(element_adjacency_data_.adj_info_);
+  for (const auto& [element, adjacencies] : element_adjacency_data_.adj_info_)
+    bytes += vector_memory(adjacencies);
+
+  bytes += unordered_map_memory(boundary_face_adjacency_data_.boundary_face_to_element_);
+
+  bytes += vector_memory(vertex_data_.tx) + vector_memory(vertex_data_.ty) +
+           vector_memory(vertex_data_.tz) + vector_memory(vertex_data_.first_vertices);
+  return bytes;
+}
+
 void
 MBDirectAccess::update() {
   clear();
@@ -11,6 +11,7 @@
 #include "xdg/geometry/face_common.h"
 #include "xdg/geometry/measure.h"
 #include "xdg/moab/tag_conventions.h"
+#include "xdg/timer.h"
 #include "xdg/util/str_utils.h"
 #include "xdg/geometry/measure.h"
 #include "xdg/vec3da.h"
@@ -35,9 +36,17 @@ MOABMeshManager::MOABMeshManager(moab::Interface* mbi) : moab_raw_ptr_(mbi)
 };
 
 void MOABMeshManager::init() {
+  ScopedTimer timer("MOABMeshManager::init");
+
   // initialize the direct access manager
   this->mb_direct()->setup();
 
+  // store MOAB's canonical tetrahedron face ordering for element traversal
+  const auto& ordering = this->mb_direct()->get_face_ordering(moab::MBTET);
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 3; j++)
+      tet_face_ordering_[i][j] = ordering[i][j];
+
   // populate ID to index mappings
 
   // define a function to convert from a handle to an ID
@@ -62,6 +71,7 @@ void MOABMeshManager::init() {
   // ensure all of the necessary tag handles exist
   this->setup_tags();
 
+  ScopedTimer geometry_timer("geometry_sets");
   // populate volumes vector and ID map
   auto moab_volume_handles = this->_ents_of_dim(3);
   std::vector<int> moab_volume_ids = this->tag_data<int>(global_id_tag_,
@@ -104,6 +114,11 @@ void MOABMeshManager::init() {
   }
 
   MeshID ipc = create_implicit_complement();
+  geometry_timer.stop();
+
+  // build the flat element topology used for element walks
+  ScopedTimer topology_timer("build_tet_topology");
+  build_tet_topology(tet_face_ordering_);
 }
 
 void MOABMeshManager::setup_tags() {
@@ -142,6 +157,7 @@ void MOABMeshManager::setup_tags() {
 // Methods
 void MOABMeshManager::load_file(const std::string& filepath)
 {
+  ScopedTimer timer("MOABMeshManager::load_file");
   this->moab_interface()->load_file(filepath.c_str());
 }
 
@@ -345,6 +361,13 @@ std::vector<Vertex> MOABMeshManager::element_vertices(MeshID element) const
   return std::vector<Vertex>(out.begin(), out.end());
 }
 
+std::array<Vertex, 4> MOABMeshManager::tet_vertices(MeshID element) const
+{
+  moab::EntityHandle element_handle;
+  this->moab_interface()->handle_from_id(moab::MBTET, element, element_handle);
+  return this->mb_direct()->get_element_coords(element_handle);
+}
+
 std::array<Vertex, 3> MOABMeshManager::face_vertices(MeshID element) const
 {
   moab::EntityHandle element_handle;
@@ -488,6 +511,7 @@ MOABMeshManager::element_volume(MeshID element) const
 void
 MOABMeshManager::parse_metadata()
 {
+  ScopedTimer timer("MOABMeshManager::parse_metadata");
   // loop over all groups
   moab::Range groups;
 
@@ -590,6 +614,23 @@ MOABMeshManager::parse_metadata()
   graveyard_check();
 }
 
+void
+MOABMeshManager::memory_report(MemoryReport& report) const
+{
+  MeshManager::memory_report(report);
+
+  // MOAB's estimate of the memory held by its entities, tags and sets
+  unsigned long long moab_total {0}, moab_amortized {0};
+  this->moab_interface()->estimated_memory_use(nullptr, 0, &moab_total, &moab_amortized);
+  report.add("mesh/moab", moab_total);
+
+  if (mdam_) report.add("mesh/moab_direct_access", mdam_->memory());
+
+  report.add("mesh/moab_id_maps", unordered_map_memory(volume_id_map_) +
+                                  unordered_map_memory(surface_id_map_) +
+                                  unordered_map_memory(element_volume_ids_));
+}
+
 void
 MOABMeshManager::graveyard_check()
 {
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "xdg/query_stats.h"
+
+namespace xdg {
+
+namespace {
+
+// Counters of the running threads and the totals of threads that have exited
+struct QueryCounterRegistry {
+  std::mutex mutex;
+  std::vector<detail::ThreadQueryCounters*> threads;
+  QueryStats retired;
+};
+
+// The registry is never destroyed so that thread_local counters destroyed
+// during program exit can still deregister
+QueryCounterRegistry& registry()
+{
+  static QueryCounterRegistry* registry = new QueryCounterRegistry();
+  return *registry;
+}
+
+} // namespace
+
+namespace detail {
+
+ThreadQueryCounters::ThreadQueryCounters()
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.threads.push_back(this);
+}
+
+ThreadQueryCounters::~ThreadQueryCounters()
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.retired += snapshot();
+  reg.threads.erase(std::remove(reg.threads.begin(), reg.threads.end(), this), reg.threads.end());
+}
+
+QueryStats ThreadQueryCounters::snapshot() const
+{
+  QueryStats stats;
+  for (size_t i = 0; i < N_QUERY_COUNTERS; i++) stats.counts[i] = counts[i].load(std::memory_order_relaxed);
+  return stats;
+}
+
+void ThreadQueryCounters::reset()
+{
+  for (auto& count : counts) count.store(0, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+QueryStats query_stats()
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  QueryStats stats = reg.retired;
+  for (const auto* counters : reg.threads) stats += counters->snapshot();
+  return stats;
+}
+
+void reset_query_stats()
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.retired = {};
+  for (auto* counters : reg.threads) counters->reset();
+}
+
+} // namespace xdg
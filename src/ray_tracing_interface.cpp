@@ -1,4 +1,5 @@
 #include <algorithm>
+#include "xdg/error.h"
 #include "xdg/ray_tracing_interface.h"
 
 // Any methods which are identical for all RT backends should be defined here
@@ -17,6 +18,169 @@ ElementTreeID RayTracer::next_element_tree_id()
   return ++next_element_tree_id_;
 }
 
+void RayTracer::unregister_volume(TreeID surface_tree, TreeID element_tree)
+{
+  fatal_error("Releasing volume trees is not supported by the {} ray tracer",
+              RT_LIB_TO_STR.at(library()));
+}
+
+bool RayTracer::point_in_volume(TreeID tree,
+                                const Position& point,
+                                const Direction* direction,
+                                const std::vector<MeshID>* exclude_primitives) const
+{
+  if (!exclude_primitives)
+    return point_in_volume(tree, point, direction, static_cast<const PrimitiveExclusionSet*>(nullptr));
+
+  PrimitiveExclusionSet exclusions(*exclude_primitives);
+  return point_in_volume(tree, point, direction, &exclusions);
+}
+
+std::pair<double, MeshID>
+RayTracer::ray_fire(TreeID tree,
+                    const Position& origin,
+                    const Direction& direction,
+                    const double dist_limit,
+                    HitOrientation orientation,
+                    std::vector<MeshID>* const exclude_primitives)
+{
+  if (!exclude_primitives) {
+    PrimitiveExclusionSet* no_exclusions {nullptr};
+    return ray_fire(tree, origin, direction, dist_limit, orientation, no_exclusions);
+  }
+
+  PrimitiveExclusionSet exclusions(*exclude_primitives);
+  auto hit = ray_fire(tree, origin, direction, dist_limit, orientation, &exclusions);
+  if (exclusions.size() > exclude_primitives->size()) exclude_primitives->push_back(exclusions.back());
+  return hit;
+}
+
+HitRecord RayTracer::ray_fire_record(TreeID tree,
+                                     const Position& origin,
+                                     const Direction& direction,
+                                     const double dist_limit,
+                                     HitOrientation orientation,
+                                     PrimitiveExclusionSet* const exclude_primitives)
+{
+  fatal_error("Ray fire hit records are not supported by the {} ray tracer",
+              RT_LIB_TO_STR.at(library()));
+  return {};
+}
+
+void RayTracer::surface_crossings(TreeID tree,
+                                  const Position& origin,
+                                  const Direction& direction,
+                                  std::vector<RayCrossing>& crossings,
+                                  double dist_limit,
+                                  int max_crossings) const
+{
+  fatal_error("Multi-hit ray queries are not supported by the {} ray tracer",
+              RT_LIB_TO_STR.at(library()));
+}
+
+void RayTracer::check_batch_sizes(const std::vector<Position>& origins,
+                                  const std::vector<Direction>& directions,
+                                  const std::vector<double>& dist_limits,
+                                  const std::vector<PrimitiveExclusionSet*>& exclude_primitives) const
+{
+  if (directions.size() != origins.size())
+    fatal_error("Number of ray directions ({}) does not match the number of ray origins ({})",
+                directions.size(), origins.size());
+  if (!dist_limits.empty() && dist_limits.size() != origins.size())
+    fatal_error("Number of ray distance limits ({}) does not match the number of ray origins ({})",
+                dist_limits.size(), origins.size());
+  if (!exclude_primitives.empty() && exclude_primitives.size() != origins.size())
+    fatal_error("Number of primitive exclusion sets ({}) does not match the number of ray origins ({})",
+                exclude_primitives.size(), origins.size());
+}
+
+void RayTracer::ray_fire_batch(TreeID tree,
+                               const std::vector<Position>& origins,
+                               const std::vector<Direction>& directions,
+                               const std::vector<double>& dist_limits,
+                               std::vector<std::pair<double, MeshID>>& hits,
+                               HitOrientation orientation,
+                               const std::vector<PrimitiveExclusionSet*>& exclude_primitives)
+{
+  check_batch_sizes(origins, directions, dist_limits, exclude_primitives);
+
+  hits.resize(origins.size());
+  for (size_t i = 0; i < origins.size(); i++) {
+    double dist_limit = dist_limits.empty() ? INFTY : dist_limits[i];
+    PrimitiveExclusionSet* exclude = exclude_primitives.empty() ? nullptr : exclude_primitives[i];
+    hits[i] = ray_fire(tree, origins[i], directions[i], dist_limit, orientation, exclude);
+  }
+}
+
+void RayTracer::ray_fire_batch(TreeID tree,
+                               const std::vector<Position>& origins,
+                               const std::vector<Direction>& directions,
+                               const std::vector<double>& dist_limits,
+                               std::vector<std::pair<double, MeshID>>& hits,
+                               HitOrientation orientation,
+                               const std::vector<std::vector<MeshID>*>& exclude_primitives)
+{
+  // the lists are converted to sets for the batch and the primitive hit by
+  // each ray is appended to its list afterward
+  std::vector<PrimitiveExclusionSet> exclusions(exclude_primitives.size());
+  std::vector<PrimitiveExclusionSet*> exclusion_sets(exclude_primitives.size(), nullptr);
+  for (size_t i = 0; i < exclude_primitives.size(); i++) {
+    if (!exclude_primitives[i]) continue;
+    exclusions[i] = PrimitiveExclusionSet(*exclude_primitives[i]);
+    exclusion_sets[i] = &exclusions[i];
+  }
+
+  ray_fire_batch(tree, origins, directions, dist_limits, hits, orientation, exclusion_sets);
+
+  for (size_t i = 0; i < exclude_primitives.size(); i++) {
+    if (exclusion_sets[i] && exclusions[i].size() > exclude_primitives[i]->size())
+      exclude_primitives[i]->push_back(exclusions[i].back());
+  }
+}
+
+void RayTracer::point_in_volume_batch(TreeID tree,
+                                      const std::vector<Position>& points,
+                                      std::vector<uint8_t>& results,
+                                      const std::vector<Direction>& directions) const
+{
+  if (!directions.empty() && directions.size() != points.size())
+    fatal_error("Number of ray directions ({}) does not match the number of points ({})",
+                directions.size(), points.size());
+
+  results.resize(points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    const Direction* direction = directions.empty() ? nullptr : &directions[i];
+    results[i] = point_in_volume(tree, points[i], direction);
+  }
+}
+
+void RayTracer::find_element_batch(TreeID tree,
+                                   const std::vector<Position>& points,
+                                   std::vector<MeshID>& elements) const
+{
+  elements.resize(points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    elements[i] = find_element(tree, points[i]);
+  }
+}
+
+void RayTracer::closest_distance_batch(TreeID tree,
+                                       const std::vector<Position>& points,
+                                       std::vector<double>& distances,
+                                       double max_radius)
+{
+  distances.resize(points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    distances[i] = closest(tree, points[i], max_radius).first;
+  }
+}
+
+void RayTracer::memory_report(MemoryReport& report) const
+{
+  report.add("ray_tracer/triangle_cache", triangle_cache_memory());
+  report.add("ray_tracer/element_cache", element_cache_memory());
+}
+
 const double RayTracer::bounding_box_bump(const std::shared_ptr<MeshManager> mesh_manager, MeshID volume_id)
 {
   auto volume_bounding_box = mesh_manager->volume_bounding_box(volume_id);
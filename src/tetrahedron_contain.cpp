@@ -1,4 +1,5 @@
 #include "xdg/constants.h"
+#include "xdg/query_stats.h"
 #include "xdg/ray_tracing_interface.h"
 #include "xdg/ray.h"
 #include "xdg/vec3da.h"
@@ -42,6 +43,15 @@ bool plucker_tet_containment_test(const Position& point,
     return true;
 }
 
+// Containment test of a point in an element primitive, using the precomputed
+// transform if present
+inline bool tet_contains(const VolumeElementsUserData* user_data, unsigned int primID, const Position& point)
+{
+  if (!user_data->transform_cache.empty()) return user_data->transform_cache.contains(primID, point);
+  auto vertices = user_data->mesh_manager->tet_vertices(user_data->prim_ref_buffer[primID].primitive_id);
+  return plucker_tet_containment_test(point, vertices[0], vertices[1], vertices[2], vertices[3]);
+}
+
 // Embree callbacks
 
 void VolumeElementBoundsFunc(RTCBoundsFunctionArguments* args)
@@ -64,20 +74,14 @@ void VolumeElementBoundsFunc(RTCBoundsFunctionArguments* args)
 
 void TetrahedronIntersectionFunc(RTCIntersectFunctionNArguments* args) {
   const VolumeElementsUserData* user_data = (const VolumeElementsUserData*)args->geometryUserPtr;
-  const MeshManager* mesh_manager = user_data->mesh_manager;
-
-  // TODO: Update this!
-  const PrimitiveRef primitive_ref = user_data->prim_ref_buffer[args->primID];
-  auto vertices = mesh_manager->element_vertices(primitive_ref.primitive_id);
 
   RTCDualRayHit* rayhit = (RTCDualRayHit*)args->rayhit;
   RTCSurfaceDualRay& ray = rayhit->ray;
-  RTCDualHit& hit = rayhit->hit;
 
   Position ray_origin = {ray.dorg[0], ray.dorg[1], ray.dorg[2]};
 
   // check the containment of the point
-  bool inside = plucker_tet_containment_test(ray_origin, vertices[0], vertices[1], vertices[2], vertices[3]);
+  bool inside = tet_contains(user_data, args->primID, ray_origin);
 
   if (!inside) return;
   // zero out the hit information
@@ -94,17 +98,15 @@ void TetrahedronIntersectionFunc(RTCIntersectFunctionNArguments* args) {
 void TetrahedronOcclusionFunc(RTCOccludedFunctionNArguments* args)
 {
   const VolumeElementsUserData* user_data = (const VolumeElementsUserData*)args->geometryUserPtr;
-  const MeshManager* mesh_manager = user_data->mesh_manager;
 
   const PrimitiveRef primitive_ref = user_data->prim_ref_buffer[args->primID];
 
-  auto vertices = mesh_manager->element_vertices(primitive_ref.primitive_id);
-
   RTCElementDualRay* ray = (RTCElementDualRay*)args->ray;
   Position ray_origin = {ray->dorg[0], ray->dorg[1], ray->dorg[2]};
 
   // check the containment of the point
-  bool inside = plucker_tet_containment_test(ray_origin, vertices[0], vertices[1], vertices[2], vertices[3]);
+  XDG_COUNT_QUERY(ELEMENT_TESTS);
+  bool inside = tet_contains(user_data, args->primID, ray_origin);
 
   if (!inside) return;
 
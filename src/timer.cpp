@@ -1,3 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+
+#include "fmt/format.h"
+
+#include "xdg/error.h"
 #include "xdg/timer.h"
 
 namespace xdg {
@@ -34,4 +42,193 @@ double Timer::elapsed()
   }
 }
 
+//==============================================================================
+// TimingRegistry implementation
+//==============================================================================
+
+namespace {
+
+// Index of the calling thread, assigned in order of first use
+int timing_thread_index()
+{
+  static std::atomic<int> n_threads {0};
+  thread_local int index = n_threads++;
+  return index;
+}
+
+// Names of the scopes open on the calling thread, outermost first
+std::vector<std::string>& open_scopes()
+{
+  thread_local std::vector<std::string> scopes;
+  return scopes;
+}
+
+// Escape a string for use in a JSON string literal
+std::string json_escape(const std::string& str)
+{
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') escaped += '\\';
+    if (static_cast<unsigned char>(c) < 0x20) {
+      escaped += fmt::format("\\u{:04x}", static_cast<int>(c));
+      continue;
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+} // namespace
+
+TimingRegistry::TimingRegistry() : epoch_(clock::now()) {}
+
+TimingRegistry& TimingRegistry::instance()
+{
+  static TimingRegistry registry;
+  return registry;
+}
+
+void TimingRegistry::record(TimedScope scope)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  scopes_.push_back(std::move(scope));
+}
+
+std::vector<TimedScope> TimingRegistry::scopes() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return scopes_;
+}
+
+void TimingRegistry::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  scopes_.clear();
+}
+
+double TimingRegistry::now() const
+{
+  std::chrono::duration<double> diff = clock::now() - epoch_;
+  return diff.count();
+}
+
+void TimingRegistry::write_chrome_trace(const std::string& filename) const
+{
+  std::ofstream out(filename);
+  if (!out) fatal_error("Failed to open timing trace file '{}'", filename);
+
+  auto recorded = scopes();
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  for (size_t i = 0; i < recorded.size(); i++) {
+    const auto& scope = recorded[i];
+    // trace event times are in microseconds
+    out << fmt::format("{}\n  {{\"name\": \"{}\", \"cat\": \"xdg\", \"ph\": \"X\", "
+                       "\"ts\": {:.3f}, \"dur\": {:.3f}, \"pid\": 0, \"tid\": {}, "
+                       "\"args\": {{\"path\": \"{}\"}}}}",
+                       i == 0 ? "" : ",", json_escape(scope.name), scope.start * 1e6,
+                       scope.duration * 1e6, scope.thread, json_escape(scope.path));
+  }
+  out << "\n]}\n";
+}
+
+std::string TimingRegistry::summary() const
+{
+  struct Entry {
+    std::string name;
+    int depth {0};
+    double first_start {0.0};
+    int calls {0};
+    double total {0.0};
+  };
+
+  // combine scopes with the same path
+  std::map<std::string, Entry> entries;
+  for (const auto& scope : scopes()) {
+    auto [it, inserted] = entries.try_emplace(scope.path);
+    Entry& entry = it->second;
+    if (inserted) {
+      entry.name = scope.name;
+      entry.depth = scope.depth;
+      entry.first_start = scope.start;
+    }
+    entry.first_start = std::min(entry.first_start, scope.start);
+    entry.calls++;
+    entry.total += scope.duration;
+  }
+
+  // list children beneath their parents, in order of their first call
+  std::map<std::string, std::vector<std::string>> children;
+  for (const auto& [path, entry] : entries) {
+    auto pos = path.rfind('/');
+    std::string parent = pos == std::string::npos ? "" : path.substr(0, pos);
+    // scopes whose parent ran on another thread are listed at the top level
+    if (!entries.count(parent)) parent = "";
+    children[parent].push_back(path);
+  }
+  for (auto& [parent, paths] : children) {
+    std::sort(paths.begin(), paths.end(), [&](const std::string& a, const std::string& b) {
+      return entries.at(a).first_start < entries.at(b).first_start;
+    });
+  }
+
+  std::string out = fmt::format("{:<48} {:>8} {:>14} {:>9}\n", "Scope", "Calls", "Total [s]", "Parent");
+  std::vector<std::pair<std::string, int>> stack;
+  auto roots = children[""];
+  for (auto it = roots.rbegin(); it != roots.rend(); ++it) stack.push_back({*it, 0});
+  while (!stack.empty()) {
+    auto [path, indent] = stack.back();
+    stack.pop_back();
+    const Entry& entry = entries.at(path);
+
+    std::string fraction = "";
+    auto pos = path.rfind('/');
+    if (indent > 0 && pos != std::string::npos) {
+      double parent_total = entries.at(path.substr(0, pos)).total;
+      if (parent_total > 0.0) fraction = fmt::format("{:.1f}%", 100.0 * entry.total / parent_total);
+    }
+    out += fmt::format("{:<48} {:>8} {:>14.6f} {:>9}\n",
+                       std::string(2 * indent, ' ') + entry.name, entry.calls, entry.total, fraction);
+
+    auto child_it = children.find(path);
+    if (child_it == children.end()) continue;
+    const auto& paths = child_it->second;
+    for (auto it = paths.rbegin(); it != paths.rend(); ++it) stack.push_back({*it, indent + 1});
+  }
+  return out;
+}
+
+//==============================================================================
+// ScopedTimer implementation
+//==============================================================================
+
+ScopedTimer::ScopedTimer(const std::string& name)
+{
+  auto& registry = TimingRegistry::instance();
+  if (!registry.enabled()) return;
+  active_ = true;
+  name_ = name;
+  open_scopes().push_back(name);
+  start_ = registry.now();
+}
+
+void ScopedTimer::stop()
+{
+  if (!active_) return;
+  active_ = false;
+  auto& registry = TimingRegistry::instance();
+  double end = registry.now();
+
+  auto& scopes = open_scopes();
+  TimedScope scope;
+  scope.name = name_;
+  scope.depth = static_cast<int>(scopes.size()) - 1;
+  for (const auto& name : scopes) scope.path += scope.path.empty() ? name : "/" + name;
+  scope.thread = timing_thread_index();
+  scope.start = start_;
+  scope.duration = end - start_;
+  scopes.pop_back();
+
+  registry.record(std::move(scope));
+}
+
 } // namespace xdg
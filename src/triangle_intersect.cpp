@@ -4,6 +4,7 @@
 #include "xdg/primitive_ref.h"
 #include "xdg/geometry_data.h"
 #include "xdg/geometry/plucker.h"
+#include "xdg/query_stats.h"
 #include "xdg/ray.h"
 
 namespace xdg
@@ -23,14 +24,35 @@ bool orientation_cull(const Direction& ray_dir, const Direction& normal, HitOrie
   return false;
 }
 
+bool primitive_mask_cull(const PrimitiveExclusionSet* exclude_primitives, int primID) {
+  if (!exclude_primitives) return false;
+
+  // if the primitive mask is set, cull if the primitive is in the mask
+  return exclude_primitives->contains(primID);
+}
+
 bool primitive_mask_cull(RTCDualRayHit* rayhit, int primID) {
-  if (!rayhit->ray.exclude_primitives) return false;
+  return primitive_mask_cull(rayhit->ray.exclude_primitives, primID);
+}
 
-  RTCSurfaceDualRay& ray = rayhit->ray;
-  RTCDualHit& hit = rayhit->hit;
+// Vertices of a surface primitive, read from the packed triangle cache if present
+inline std::array<Vertex, 3> surface_triangle_vertices(const SurfaceUserData* user_data, unsigned int primID)
+{
+  if (!user_data->triangle_cache.empty()) return user_data->triangle_cache.vertices(primID);
+  return user_data->mesh_manager->face_vertices(user_data->prim_ref_buffer[primID].primitive_id);
+}
 
-  // if the primitive mask is set, cull if the primitive is not in the mask
-  return std::find(ray.exclude_primitives->begin(), ray.exclude_primitives->end(), primID) != ray.exclude_primitives->end();
+// Normal of a surface primitive, read from the packed triangle cache if present
+inline Direction surface_triangle_normal(const SurfaceUserData* user_data, unsigned int primID)
+{
+  if (!user_data->triangle_cache.empty()) return user_data->triangle_cache.normal(primID);
+  return user_data->mesh_manager->face_normal(user_data->prim_ref_buffer[primID].primitive_id);
+}
+
+// Volume across a surface from the volume of the given surface tree
+inline MeshID next_volume(const SurfaceUserData* user_data, TreeID volume_tree)
+{
+  return volume_tree == user_data->reverse_vol ? user_data->forward_parent : user_data->reverse_parent;
 }
 
 void TriangleBoundsFunc(RTCBoundsFunctionArguments* args)
@@ -49,48 +71,173 @@ void TriangleBoundsFunc(RTCBoundsFunctionArguments* args)
   args->bounds_o->upper_z = bounds.max_z + user_data->box_bump;
 }
 
-void TriangleIntersectionFunc(RTCIntersectFunctionNArguments* args) {
-  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
-  const MeshManager* mesh_manager = user_data->mesh_manager;
-
-  const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
-
-  auto vertices = mesh_manager->face_vertices(primitive_ref.primitive_id);
-
-  RTCDualRayHit* rayhit = (RTCDualRayHit*)args->rayhit;
-  RTCSurfaceDualRay& ray = rayhit->ray;
-  RTCDualHit& hit = rayhit->hit;
-
-  Position ray_origin = {ray.dorg[0], ray.dorg[1], ray.dorg[2]};
-  Direction ray_direction = {ray.ddir[0], ray.ddir[1], ray.ddir[2]};
+// Double precision intersection of a single ray with a triangle primitive,
+// applying the orientation and primitive culls. Returns true and sets the
+// distance and (volume-oriented) normal if the hit is accepted. If the
+// primitive is a candidate already reported by Embree's watertight native
+// triangle test, a double precision miss (possible along shared edges) falls
+// back to the distance to the triangle plane rather than dropping the hit
+bool triangle_intersect(const SurfaceUserData* user_data,
+                        unsigned int primID,
+                        const Position& ray_origin,
+                        const Direction& ray_direction,
+                        double dtfar,
+                        RayFireType rf_type,
+                        HitOrientation orientation,
+                        const PrimitiveExclusionSet* exclude_primitives,
+                        TreeID volume_tree,
+                        double& plucker_dist,
+                        Direction& normal,
+                        bool native_candidate = false)
+{
+  XDG_COUNT_QUERY(PRIMITIVE_TESTS);
+  auto vertices = surface_triangle_vertices(user_data, primID);
 
   // local variable for distance to the triangle intersection
-  auto result = plucker_ray_tri_intersect(vertices.data(), 
-                                          ray_origin, 
+  auto result = plucker_ray_tri_intersect(vertices.data(),
+                                          ray_origin,
                                           ray_direction,
-                                          rayhit->ray.dtfar,
+                                          dtfar,
                                           0.0,
                                           false,
                                           0);
-  if (!result.hit) return;
-  double plucker_dist = result.t;
+  if (!result.hit && !native_candidate) {
+    XDG_COUNT_QUERY(FALSE_CANDIDATES);
+    return false;
+  }
 
-  if (plucker_dist > rayhit->ray.dtfar) return;
+  normal = surface_triangle_normal(user_data, primID);
 
-  Direction normal = mesh_manager->face_normal(primitive_ref.primitive_id);
+  if (result.hit) {
+    plucker_dist = result.t;
+  } else {
+    double denom = ray_direction.dot(normal);
+    plucker_dist = denom == 0.0 ? -1.0 : (vertices[0] - ray_origin).dot(normal) / denom;
+  }
+
+  if (plucker_dist < 0.0 || plucker_dist > dtfar) {
+    XDG_COUNT_QUERY(FALSE_CANDIDATES);
+    return false;
+  }
 
   // Check if ray is entering or exiting the volume it was fired against
   // if this is a normal ray fire, flip the normal as needed
-  if (ray.volume_tree == user_data->reverse_vol && rayhit->ray.rf_type != RayFireType::FIND_VOLUME)
-  {  
+  if (volume_tree == user_data->reverse_vol &&
+      rf_type != RayFireType::FIND_VOLUME &&
+      rf_type != RayFireType::ACCUMULATE_HITS)
+  {
     normal = -normal;
   }
 
-  if (rayhit->ray.rf_type == RayFireType::VOLUME) {
-   if (orientation_cull(rayhit->ray.ddir, normal, rayhit->ray.orientation)) return;
-   if (primitive_mask_cull(rayhit, primitive_ref.primitive_id)) return;
+  if (rf_type == RayFireType::VOLUME) {
+    if (orientation_cull(ray_direction, normal, orientation)) {
+      XDG_COUNT_QUERY(ORIENTATION_CULLS);
+      return false;
+    }
+    if (primitive_mask_cull(exclude_primitives, user_data->prim_ref_buffer[primID].primitive_id)) {
+      XDG_COUNT_QUERY(EXCLUSION_CULLS);
+      return false;
+    }
   }
 
+  XDG_COUNT_QUERY(HITS);
+  return true;
+}
+
+// Record a crossing of an ACCUMULATE_HITS ray. The hit is not committed so
+// that traversal continues past it. Returns the distance beyond which
+// primitives no longer need to be considered (see add_crossing)
+inline double accumulate_crossing(RTCSurfaceDualRay& ray,
+                                const SurfaceUserData* user_data,
+                                unsigned int primID,
+                                double distance,
+                                const Direction& normal)
+{
+  RayCrossing crossing {distance,
+                        user_data->surface_id,
+                        user_data->prim_ref_buffer[primID].primitive_id,
+                        ray.ddir.dot(normal) > 0.0 ? Sense::FORWARD : Sense::REVERSE};
+  return add_crossing(*ray.crossings, ray.max_crossings, crossing);
+}
+
+// Intersection of a packet of rays traced by rtcIntersect4/8/16 with a
+// triangle primitive. Only active lanes (valid[i] == -1) are considered.
+template<int N>
+void TriangleIntersectionFuncN(RTCIntersectFunctionNArguments* args) {
+  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
+  const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
+
+  RTCDualRayHitN<N>* rayhit = (RTCDualRayHitN<N>*)args->rayhit;
+
+  for (int i = 0; i < N; i++) {
+    if (args->valid[i] != -1) continue;
+
+    double plucker_dist;
+    Direction normal;
+    if (!triangle_intersect(user_data,
+                            args->primID,
+                            rayhit->org(i),
+                            rayhit->dir(i),
+                            rayhit->dtfar[i],
+                            rayhit->rf_type[i],
+                            rayhit->orientation[i],
+                            rayhit->exclude_primitives[i],
+                            rayhit->volume_tree[i],
+                            plucker_dist,
+                            normal)) continue;
+
+    // if we've gotten through all of the filters, set the ray information
+    rayhit->set_tfar(i, plucker_dist);
+    // zero-out barycentric coords
+    rayhit->hit.u[i] = 0.0;
+    rayhit->hit.v[i] = 0.0;
+    rayhit->hit.Ng_x[i] = 0.0;
+    rayhit->hit.Ng_y[i] = 0.0;
+    rayhit->hit.Ng_z[i] = 0.0;
+    // set the hit information
+    rayhit->hit.geomID[i] = args->geomID;
+    rayhit->hit.primID[i] = args->primID;
+    rayhit->primitive_ref[i] = &primitive_ref;
+    rayhit->surface[i] = user_data->surface_id;
+    rayhit->dNg[i] = normal;
+  }
+}
+
+void TriangleIntersectionFunc(RTCIntersectFunctionNArguments* args) {
+  // packets are only ever traced with the native packet widths (see EmbreeRayTracer::ray_fire_batch)
+  switch (args->N) {
+    case 4: return TriangleIntersectionFuncN<4>(args);
+    case 8: return TriangleIntersectionFuncN<8>(args);
+    case 16: return TriangleIntersectionFuncN<16>(args);
+    default: break;
+  }
+
+  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
+  const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
+
+  RTCDualRayHit* rayhit = (RTCDualRayHit*)args->rayhit;
+  RTCSurfaceDualRay& ray = rayhit->ray;
+
+  double plucker_dist;
+  Direction normal;
+  if (!triangle_intersect(user_data,
+                          args->primID,
+                          ray.dorg,
+                          ray.ddir,
+                          ray.dtfar,
+                          ray.rf_type,
+                          ray.orientation,
+                          ray.exclude_primitives,
+                          ray.volume_tree,
+                          plucker_dist,
+                          normal)) return;
+
+  if (ray.rf_type == RayFireType::ACCUMULATE_HITS) {
+    double cutoff = accumulate_crossing(ray, user_data, args->primID, plucker_dist, normal);
+    // once the number of crossings is capped, farther primitives can be skipped
+    if (cutoff < ray.dtfar) ray.set_tfar(cutoff);
+    return;
+  }
 
   // if we've gotten through all of the filters, set the ray information
   rayhit->ray.set_tfar(plucker_dist);
@@ -105,28 +252,161 @@ void TriangleIntersectionFunc(RTCIntersectFunctionNArguments* args) {
   rayhit->hit.primID = args->primID;
   rayhit->hit.primitive_ref = &primitive_ref;
   rayhit->hit.surface = user_data->surface_id;
+  rayhit->hit.next_volume = next_volume(user_data, ray.volume_tree);
   rayhit->hit.dNg = normal;
 }
 
+// Double precision refinement of the candidate hits of a packet of rays on a
+// native Embree triangle geometry. Rejected lanes are masked out of valid
+template<int N>
+void TriangleIntersectionFilterFuncN(RTCFilterFunctionNArguments* args) {
+  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
+
+  RTCDualRayHitN<N>* rayhit = (RTCDualRayHitN<N>*)args->ray;
+
+  for (int i = 0; i < N; i++) {
+    if (args->valid[i] != -1) continue;
+
+    unsigned int primID = RTCHitN_primID(args->hit, N, i);
+    double plucker_dist;
+    Direction normal;
+    if (!triangle_intersect(user_data,
+                            primID,
+                            rayhit->org(i),
+                            rayhit->dir(i),
+                            rayhit->dtfar[i],
+                            rayhit->rf_type[i],
+                            rayhit->orientation[i],
+                            rayhit->exclude_primitives[i],
+                            rayhit->volume_tree[i],
+                            plucker_dist,
+                            normal,
+                            true)) {
+      args->valid[i] = 0;
+      continue;
+    }
+
+    // Embree updates the single precision ray and hit, set the double precision values here
+    rayhit->dtfar[i] = plucker_dist;
+    rayhit->primitive_ref[i] = &user_data->prim_ref_buffer[primID];
+    rayhit->surface[i] = user_data->surface_id;
+    rayhit->dNg[i] = normal;
+  }
+}
+
+void TriangleIntersectionFilterFunc(RTCFilterFunctionNArguments* args) {
+  switch (args->N) {
+    case 4: return TriangleIntersectionFilterFuncN<4>(args);
+    case 8: return TriangleIntersectionFilterFuncN<8>(args);
+    case 16: return TriangleIntersectionFilterFuncN<16>(args);
+    default: break;
+  }
+
+  if (args->valid[0] != -1) return;
+
+  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
+  // for single rays Embree passes the ray of the RTCDualRayHit the query was fired with
+  RTCDualRayHit* rayhit = (RTCDualRayHit*)args->ray;
+  RTCSurfaceDualRay& ray = rayhit->ray;
+
+  unsigned int primID = RTCHitN_primID(args->hit, 1, 0);
+  double plucker_dist;
+  Direction normal;
+  if (!triangle_intersect(user_data,
+                          primID,
+                          ray.dorg,
+                          ray.ddir,
+                          ray.dtfar,
+                          ray.rf_type,
+                          ray.orientation,
+                          ray.exclude_primitives,
+                          ray.volume_tree,
+                          plucker_dist,
+                          normal,
+                          true)) {
+    args->valid[0] = 0;
+    return;
+  }
+
+  if (ray.rf_type == RayFireType::ACCUMULATE_HITS) {
+    // rejecting the candidate lets traversal continue, Embree owns the ray
+    // extent for native geometry so it isn't shortened here
+    accumulate_crossing(ray, user_data, primID, plucker_dist, normal);
+    args->valid[0] = 0;
+    return;
+  }
+
+  // Embree updates the single precision ray and hit, set the double precision values here
+  ray.dtfar = plucker_dist;
+  rayhit->hit.primitive_ref = &user_data->prim_ref_buffer[primID];
+  rayhit->hit.surface = user_data->surface_id;
+  rayhit->hit.next_volume = next_volume(user_data, ray.volume_tree);
+  rayhit->hit.dNg = normal;
+}
+
+void TriangleOcclusionFilterFunc(RTCFilterFunctionNArguments* args) {
+  // occlusion queries are only fired one ray at a time
+  if (args->N != 1 || args->valid[0] != -1) return;
+
+  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
+  RTCSurfaceDualRay* ray = (RTCSurfaceDualRay*)args->ray;
+
+  unsigned int primID = RTCHitN_primID(args->hit, 1, 0);
+  double plucker_dist;
+  Direction normal;
+  if (!triangle_intersect(user_data,
+                          primID,
+                          ray->dorg,
+                          ray->ddir,
+                          ray->dtfar,
+                          RayFireType::FIND_VOLUME,
+                          HitOrientation::ANY,
+                          nullptr,
+                          ray->volume_tree,
+                          plucker_dist,
+                          normal,
+                          true)) {
+    args->valid[0] = 0;
+    return;
+  }
+
+  ray->dtfar = -INFTY;
+}
+
+// Squared distance from a point to the axis-aligned bounding box of a triangle
+inline double triangle_box_distance_squared(const std::array<Vertex, 3>& vertices, const Position& point)
+{
+  double dist_sq = 0.0;
+  for (int i = 0; i < 3; i++) {
+    double lower = std::min({vertices[0][i], vertices[1][i], vertices[2][i]});
+    double upper = std::max({vertices[0][i], vertices[1][i], vertices[2][i]});
+    double d = std::max({lower - point[i], 0.0, point[i] - upper});
+    dist_sq += d * d;
+  }
+  return dist_sq;
+}
+
 bool TriangleClosestFunc(RTCPointQueryFunctionArguments* args) {
   RTCGeometry g = rtcGetGeometry(*(RTCScene*)args->userPtr, args->geomID);
   // get the array of DblTri's stored on the geometry
   const SurfaceUserData* user_data = (const SurfaceUserData*) rtcGetGeometryUserData(g);
 
-  const MeshManager* mesh_manager = user_data->mesh_manager;
-
   const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
-  auto vertices = mesh_manager->face_vertices(primitive_ref.primitive_id);
+  auto vertices = surface_triangle_vertices(user_data, args->primID);
 
   RTCDPointQuery* query = (RTCDPointQuery*) args->query;
   Position p {query->dblx, query->dbly, query->dblz};
+  XDG_COUNT_QUERY(CLOSEST_TESTS);
+
+  // the distance to the triangle's bounding box is a lower bound on the
+  // distance to the triangle, skip triangles that can't be within the radius
+  if (triangle_box_distance_squared(vertices, p) >= query->dradius * query->dradius) return false;
 
   Position result = closest_location_on_triangle(vertices, p);
 
   double dist = (result - p).length();
   if ( dist < query->dradius) {
-    query->radius = dist;
-    query->dradius = dist;
+    query->set_radius(dist);
     query->primitive_ref = &primitive_ref;
     query->primID = args->primID;
     query->geomID = args->geomID;
@@ -138,10 +418,8 @@ bool TriangleClosestFunc(RTCPointQueryFunctionArguments* args) {
 
 void TriangleOcclusionFunc(RTCOccludedFunctionNArguments* args) {
   const SurfaceUserData* user_data = (const SurfaceUserData*) args->geometryUserPtr;
-  const MeshManager* mesh_manager = user_data->mesh_manager;
-  const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
 
-  auto vertices = mesh_manager->face_vertices(primitive_ref.primitive_id);
+  auto vertices = surface_triangle_vertices(user_data, args->primID);
 
   // get the double precision ray from the args
   RTCSurfaceDualRay* ray = (RTCSurfaceDualRay*) args->ray;
@@ -1,10 +1,15 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <mutex>
 #include <vector>
-#include <numeric>
 
 #include "xdg/xdg.h"
+#include "xdg/config.h"
 #include "xdg/error.h"
 #include "xdg/constants.h"
 #include "xdg/geometry/measure.h"
+#include "xdg/timer.h"
 
 #include "xdg/mesh_managers.h"
 
@@ -12,6 +17,8 @@
 
 namespace xdg {
 
+thread_local const XDG* XDG::segment_visitor_xdg_ {nullptr};
+
 XDG::XDG(std::shared_ptr<MeshManager> mesh_manager, RTLibrary ray_tracing_lib)
         : mesh_manager_(mesh_manager)
 {
@@ -36,20 +43,199 @@ XDG::XDG(std::shared_ptr<MeshManager> mesh_manager, RTLibrary ray_tracing_lib)
 
 void XDG::prepare_raytracer()
 {
+  check_not_in_segment_visitor("prepare_raytracer");
+  lazy_registration_ = XDGConfig::config().lazy_volume_registration();
+  ++handle_generation_;
+  if (lazy_registration_) {
+    // trees are registered as volumes are queried
+    std::unique_lock<std::shared_mutex> write_lock(registration_mutex_);
+    global_trees_built_ = false;
+    build_timings_ = {};
+    return;
+  }
+  build_all_trees();
+}
+
+void XDG::build_all_trees() const
+{
+  ScopedTimer timer("XDG::build_all_trees");
+  Timer total_timer, registration_timer, build_timer, init_timer;
+  total_timer.start();
+
+  // register all volumes first, deferring the tree builds so that they can be
+  // performed concurrently. Registration queries the mesh and sets up the
+  // surface geometries shared between volumes, so it remains serial
+  registration_timer.start();
+  ray_tracing_interface()->defer_tree_builds(true);
   for (auto volume : mesh_manager()->volumes()) {
-    this->prepare_volume_for_raytracing(volume);
+    // volumes already registered on first use are kept
+    if (lazy_registration_ && volume_to_surface_tree_map_.count(volume)) continue;
+    register_volume_trees(volume);
   }
 
   ray_tracing_interface()->create_global_element_tree();
   ray_tracing_interface()->create_global_surface_tree();
+  registration_timer.stop();
+
+  build_timer.start();
+  ray_tracing_interface()->build_pending_trees();
+  ray_tracing_interface()->defer_tree_builds(false);
+  build_timer.stop();
 
+  init_timer.start();
   ray_tracing_interface()->init(); // Initialize the ray tracer (e.g. build SBT for GPRT)
+  init_timer.stop();
+  total_timer.stop();
+
+  build_timings_.registration = registration_timer.elapsed();
+  build_timings_.tree_build = build_timer.elapsed();
+  build_timings_.init = init_timer.elapsed();
+  build_timings_.total = total_timer.elapsed();
+  global_trees_built_ = true;
 }
 
 void XDG::prepare_volume_for_raytracing(MeshID volume) {
-    auto [surface_tree, volume_tree] = ray_tracing_interface_->register_volume(mesh_manager_, volume);
-    volume_to_surface_tree_map_[volume] = surface_tree;
-    volume_to_point_location_tree_map_[volume] = volume_tree;
+  check_not_in_segment_visitor("prepare_volume_for_raytracing");
+  if (lazy_registration_) {
+    std::unique_lock<std::shared_mutex> write_lock(registration_mutex_);
+    register_volume_trees(volume);
+    ray_tracing_interface()->init();
+    return;
+  }
+  register_volume_trees(volume);
+}
+
+void XDG::register_volume_trees(MeshID volume) const
+{
+  ScopedTimer timer("XDG::register_volume_trees");
+  auto [surface_tree, volume_tree] = ray_tracing_interface_->register_volume(mesh_manager_, volume);
+  volume_to_surface_tree_map_[volume] = surface_tree;
+  volume_to_point_location_tree_map_[volume] = volume_tree;
+}
+
+XDG::QueryLock XDG::volume_trees(MeshID volume) const
+{
+  if (!lazy_registration_) return {};
+  if (in_segment_visitor()) {
+    if (!volume_to_surface_tree_map_.count(volume))
+      fatal_error("Volume {} does not exist in the mesh", volume);
+    return {};
+  }
+
+  QueryLock lock(registration_mutex_);
+  while (!volume_to_surface_tree_map_.count(volume)) {
+    // upgrade to exclusive access to register the volume. Another thread may
+    // get there first, in which case the volume is only registered once
+    lock.unlock();
+    {
+      std::unique_lock<std::shared_mutex> write_lock(registration_mutex_);
+      if (!volume_to_surface_tree_map_.count(volume)) {
+        const auto& volumes = mesh_manager()->volumes();
+        if (std::find(volumes.begin(), volumes.end(), volume) == volumes.end())
+          fatal_error("Volume {} does not exist in the mesh", volume);
+        register_volume_trees(volume);
+        ray_tracing_interface()->init();
+      }
+    }
+    lock.lock();
+  }
+  return lock;
+}
+
+XDG::QueryLock XDG::global_trees() const
+{
+  if (!lazy_registration_ || in_segment_visitor()) return {};
+
+  QueryLock lock(registration_mutex_);
+  while (!global_trees_built_) {
+    lock.unlock();
+    {
+      std::unique_lock<std::shared_mutex> write_lock(registration_mutex_);
+      if (!global_trees_built_) build_all_trees();
+    }
+    lock.lock();
+  }
+  return lock;
+}
+
+bool XDG::volume_registered(MeshID volume) const
+{
+  QueryLock lock;
+  if (lazy_registration_ && !in_segment_visitor()) lock = QueryLock(registration_mutex_);
+  return volume_to_surface_tree_map_.count(volume) > 0;
+}
+
+std::vector<MeshID> XDG::registered_volumes() const
+{
+  QueryLock lock;
+  if (lazy_registration_ && !in_segment_visitor()) lock = QueryLock(registration_mutex_);
+  std::vector<MeshID> volumes;
+  volumes.reserve(volume_to_surface_tree_map_.size());
+  for (const auto& [volume, tree] : volume_to_surface_tree_map_) volumes.push_back(volume);
+  std::sort(volumes.begin(), volumes.end());
+  return volumes;
+}
+
+void XDG::evict_volume(MeshID volume)
+{
+  if (!lazy_registration_)
+    fatal_error("Volumes can only be evicted with lazy volume registration enabled");
+  check_not_in_segment_visitor("evict_volume");
+
+  std::unique_lock<std::shared_mutex> write_lock(registration_mutex_);
+  auto surface_tree = volume_to_surface_tree_map_.find(volume);
+  if (surface_tree == volume_to_surface_tree_map_.end()) return;
+
+  ray_tracing_interface()->unregister_volume(surface_tree->second,
+                                             volume_to_point_location_tree_map_.at(volume));
+  volume_to_surface_tree_map_.erase(surface_tree);
+  volume_to_point_location_tree_map_.erase(volume);
+  // the ray tracer releases the global trees along with the volume
+  global_trees_built_ = false;
+  ++handle_generation_;
+}
+
+VolumeHandle XDG::volume_handle(MeshID volume) const
+{
+  QueryLock lock = volume_trees(volume);
+  return {volume,
+          volume_to_surface_tree_map_.at(volume),
+          volume_to_point_location_tree_map_.at(volume),
+          handle_generation_.load()};
+}
+
+XDG::QueryLock XDG::handle_trees(const VolumeHandle& handle, VolumeHandle& current) const
+{
+  current = {};
+  if (!handle.valid()) return {};
+
+  // lazy registration modifies the ray tracer's tree tables until the global
+  // trees are built, after which trees only change when a volume is evicted
+  // or the ray tracer is prepared again
+  QueryLock lock;
+  if (lazy_registration_ && !in_segment_visitor() && !global_trees_built_)
+    lock = QueryLock(registration_mutex_);
+  if (handle.generation == handle_generation_.load()) {
+    current = handle;
+    return lock;
+  }
+
+  // the handle's trees may have been released since it was resolved
+  if (lock.owns_lock()) lock.unlock();
+  lock = volume_trees(handle.volume);
+  auto surface_tree = volume_to_surface_tree_map_.find(handle.volume);
+  if (surface_tree == volume_to_surface_tree_map_.end()) return lock;
+  current = {handle.volume,
+             surface_tree->second,
+             volume_to_point_location_tree_map_.at(handle.volume),
+             handle_generation_.load()};
+  return lock;
+}
+
+void XDG::check_not_in_segment_visitor(const std::string& method) const
+{
+  if (in_segment_visitor())
+    fatal_error("XDG::{} can't be called from a segment visitor", method);
 }
 
 std::shared_ptr<XDG> XDG::create(MeshLibrary mesh_lib, RTLibrary ray_tracing_lib)
@@ -101,23 +287,78 @@ std::shared_ptr<XDG> XDG::create(MeshLibrary mesh_lib, RTLibrary ray_tracing_lib
   return xdg;
 }
 
+bool XDG::point_in_volume(MeshID volume,
+                          const Position point,
+                          const Direction* direction,
+                          const PrimitiveExclusionSet* exclude_primitives) const
+{
+  QueryLock lock = volume_trees(volume);
+  TreeID tree = volume_to_surface_tree_map_.at(volume);
+  return ray_tracing_interface()->point_in_volume(tree, point, direction, exclude_primitives);
+}
+
 bool XDG::point_in_volume(MeshID volume,
                           const Position point,
                           const Direction* direction,
                           const std::vector<MeshID>* exclude_primitives) const
 {
+  QueryLock lock = volume_trees(volume);
   TreeID tree = volume_to_surface_tree_map_.at(volume);
   return ray_tracing_interface()->point_in_volume(tree, point, direction, exclude_primitives);
 }
 
+void XDG::point_in_volume_batch(MeshID volume,
+                                const std::vector<Position>& points,
+                                std::vector<uint8_t>& results,
+                                const std::vector<Direction>& directions) const
+{
+  QueryLock lock = volume_trees(volume);
+  TreeID tree = volume_to_surface_tree_map_.at(volume);
+  ray_tracing_interface()->point_in_volume_batch(tree, points, results, directions);
+}
+
 MeshID XDG::find_volume(const Position& point,
-                                                   const Direction& direction) const
+                        const Direction& direction) const
 {
+  QueryLock lock = global_trees();
   MeshID ipc = mesh_manager()->implicit_complement();
-  for (auto volume_scene_pair : volume_to_surface_tree_map_) {
-    MeshID volume = volume_scene_pair.first;
+
+  TreeID global_tree = ray_tracing_interface()->global_surface_tree();
+  if (global_tree != TREE_NONE) {
+    // the first surface hit by a ray from the point bounds the volume
+    // containing it. Which of the surface's parent volumes that is follows
+    // from the side of the surface the ray arrives from. Grazing hits are
+    // retried along other directions
+    std::array<Direction, FIND_VOLUME_RETRY_DIRECTIONS.size() + 1> directions {direction};
+    for (size_t i = 0; i < FIND_VOLUME_RETRY_DIRECTIONS.size(); i++) {
+      const auto& u = FIND_VOLUME_RETRY_DIRECTIONS[i];
+      directions[i + 1] = Direction(u[0], u[1], u[2]);
+    }
+    PrimitiveExclusionSet hit_primitives;
+    for (Direction u : directions) {
+      u.normalize();
+      hit_primitives.clear();
+      auto [dist, surface] = ray_tracing_interface()->ray_fire(global_tree, point, u, INFTY,
+                                                               HitOrientation::ANY, &hit_primitives);
+      // no surfaces in this direction, the point is outside of all volumes
+      if (surface == ID_NONE) return ipc;
+      // backends that don't report the hit primitive use the fallback below
+      if (hit_primitives.empty()) break;
+
+      // face normals point out of the surface's forward volume
+      double cosine = u.dot(mesh_manager()->face_normal(hit_primitives.back()));
+      if (std::abs(cosine) < FIND_VOLUME_GRAZING_COSINE) continue;
+
+      auto [forward_volume, reverse_volume] = mesh_manager()->surface_senses(surface);
+      MeshID volume = cosine > 0.0 ? forward_volume : reverse_volume;
+      return volume == ID_NONE ? ipc : volume;
+    }
+  }
+
+  // fall back to a point containment test for each volume
+  for (auto volume : mesh_manager()->volumes()) {
     if (volume == ipc) continue;
-    TreeID scene = volume_scene_pair.second;
+    TreeID scene = volume_to_surface_tree_map_.at(volume);
     if (ray_tracing_interface()->point_in_volume(scene, point, &direction)) {
       return volume;
     }
@@ -129,72 +370,79 @@ MeshID XDG::find_volume(const Position& point,
 
 MeshID XDG::find_element(const Position& point) const
 {
+  QueryLock lock = global_trees();
   return ray_tracing_interface()->find_element(point);
 }
 
+void XDG::find_element_batch(const std::vector<Position>& points,
+                             std::vector<MeshID>& elements) const
+{
+  QueryLock lock = global_trees();
+  ray_tracing_interface()->find_element_batch(points, elements);
+}
+
+void XDG::find_element_batch(MeshID volume,
+                             const std::vector<Position>& points,
+                             std::vector<MeshID>& elements) const
+{
+  QueryLock lock = volume_trees(volume);
+  TreeID tree = volume_to_point_location_tree_map_.at(volume);
+  ray_tracing_interface()->find_element_batch(tree, points, elements);
+}
+
+MeshID XDG::find_element(const Position& point,
+                         MeshID hint_element,
+                         int max_steps) const
+{
+  if (hint_element != ID_NONE) {
+    MeshID element = mesh_manager()->locate_element(hint_element, point, max_steps);
+    if (element != ID_NONE) return element;
+  }
+  return find_element(point);
+}
+
 MeshID XDG::find_element(MeshID volume,
                          const Position& point) const
 {
+  QueryLock lock = volume_trees(volume);
   TreeID scene = volume_to_point_location_tree_map_.at(volume);
   return ray_tracing_interface()->find_element(scene, point);
 }
 
+std::vector<RayCrossing>
+XDG::surface_crossings(const Position& origin,
+                       const Direction& direction,
+                       double dist_limit,
+                       int max_crossings) const
+{
+  QueryLock lock = global_trees();
+  std::vector<RayCrossing> crossings;
+  ray_tracing_interface()->surface_crossings(origin, direction, crossings, dist_limit, max_crossings);
+  return crossings;
+}
+
 std::vector<std::pair<MeshID, double>>
 XDG::segments(const Position& start,
               const Position& end) const
 {
-  MeshID ipc = mesh_manager()->implicit_complement();
+  std::vector<std::pair<MeshID, double>> result;
+  segments(start, end,
+           [&result](MeshID element, double length) { result.push_back({element, length}); });
+  return result;
+}
 
-  std::vector<MeshID> prev_elements;
-
-  Position r = start;
-  Direction u = end - start;
-  double distance = u.length();
-  u /= distance;
-
-  std::vector<xdg::MeshID> hit_primitives;
-
-  std::vector<std::pair<MeshID, double>> segments;
-  while (distance > 0) {
-    // attempt to find an element at the start location
-    MeshID current_element = ray_tracing_interface()->find_element(r);
-    // at this point we may be on the face of an element, if we're declared inside that element, ignore it
-    if (segments.size() > 0 && current_element == segments.back().first) current_element = ID_NONE;
-    MeshID volume = ID_NONE;
-    if (current_element == ID_NONE) {
-      // fire a ray against the implicit complement
-      auto hit = ray_fire(ipc, r + u * TINY_BIT, u, INFTY, HitOrientation::EXITING, &hit_primitives);
-      // if there is no entry point or the distance to the surface
-      // is past the end point, return
-      if (hit.second == ID_NONE || hit.first > distance) return segments;
-
-      double hit_dist = hit.first + TINY_BIT;
-      // move up to the surface
-      r += u * hit_dist;
-      distance -= hit_dist;
-      // determine the volume we're moving into
-      mesh_manager()->next_volume(ipc, hit.second);
-
-      // Get the element on the other side of the hit face using adjacencies
-      auto adjacent_element = mesh_manager()->get_boundary_face_element(hit_primitives.back());
-      if (adjacent_element == ID_NONE) {
-        warning("Ray fire hit surface {}, but no adjacent elements were found on the other side of the surface.", hit.second);
-        return segments;
-      }
-      current_element = adjacent_element;
-      hit_primitives.clear();
-    }
-    auto vol_segments = mesh_manager()->walk_elements(current_element, r, u, distance);
-    // add to current set of segments
-    segments.insert(segments.end(), vol_segments.begin(), vol_segments.end());
-    double segment_sum = std::accumulate(vol_segments.begin(), vol_segments.end(), 0.0,
-                                         [](double total, const auto& segment) { return total + segment.second; });
-    // upate location of the track start
-    r += u * segment_sum;
-    // decrement distance by total distance traveled in the volume
-    distance -= segment_sum;
-  }
-  return segments;
+size_t
+XDG::segments(TrackState& track,
+              std::pair<MeshID, double>* buffer,
+              size_t capacity) const
+{
+  size_t n = 0;
+  if (capacity == 0) return n;
+  segments(track, [&](MeshID element, double length) {
+    buffer[n++] = {element, length};
+    return n < capacity;
+  });
+  return n;
 }
 
 std::vector<std::pair<MeshID, double>>
@@ -202,6 +450,7 @@ XDG::segments(MeshID volume,
               const Position& start,
               const Position& end) const
 {
+  QueryLock lock = volume_trees(volume);
   Position start_copy = start;
   Direction u = (end - start).normalize();
   TreeID volume_tree = volume_to_point_location_tree_map_.at(volume);
@@ -210,7 +459,8 @@ XDG::segments(MeshID volume,
   // if we're outside of the region of interest, determine the distance to an entering intersection
   // with the model
   if (starting_element == ID_NONE) {
-    auto hit = ray_fire(volume, start, u, INFTY, HitOrientation::ENTERING);
+    TreeID surface_tree = volume_to_surface_tree_map_.at(volume);
+    auto hit = ray_tracing_interface()->ray_fire(surface_tree, start, u, INFTY, HitOrientation::ENTERING);
     if (hit.second == ID_NONE) return {};
     // TODO: use mesh adjaccies to find the element on the other side of the hit face
     starting_element = ray_tracing_interface()->find_element(volume_tree, start + u * (hit.first + TINY_BIT));
@@ -234,6 +484,19 @@ XDG::next_element(MeshID current_element,
   return mesh_manager()->next_element(current_element, r, u);
 }
 
+std::pair<double, MeshID>
+XDG::ray_fire(MeshID volume,
+              const Position& origin,
+              const Direction& direction,
+              const double dist_limit,
+              HitOrientation orientation,
+              PrimitiveExclusionSet* const exclude_primitives) const
+{
+  QueryLock lock = volume_trees(volume);
+  TreeID scene = volume_to_surface_tree_map_.at(volume);
+  return ray_tracing_interface()->ray_fire(scene, origin, direction, dist_limit, orientation, exclude_primitives);
+}
+
 std::pair<double, MeshID>
 XDG::ray_fire(MeshID volume,
               const Position& origin,
@@ -242,22 +505,78 @@ XDG::ray_fire(MeshID volume,
               HitOrientation orientation,
               std::vector<MeshID>* const exclude_primitives) const
 {
+  QueryLock lock = volume_trees(volume);
   TreeID scene = volume_to_surface_tree_map_.at(volume);
   return ray_tracing_interface()->ray_fire(scene, origin, direction, dist_limit, orientation, exclude_primitives);
 }
 
+HitRecord
+XDG::ray_fire_record(MeshID volume,
+                     const Position& origin,
+                     const Direction& direction,
+                     const double dist_limit,
+                     HitOrientation orientation,
+                     PrimitiveExclusionSet* const exclude_primitives) const
+{
+  QueryLock lock = volume_trees(volume);
+  TreeID scene = volume_to_surface_tree_map_.at(volume);
+  return ray_tracing_interface()->ray_fire_record(scene, origin, direction, dist_limit, orientation, exclude_primitives);
+}
+
+void
+XDG::ray_fire_batch(MeshID volume,
+                    const std::vector<Position>& origins,
+                    const std::vector<Direction>& directions,
+                    std::vector<std::pair<double, MeshID>>& hits,
+                    const std::vector<double>& dist_limits,
+                    HitOrientation orientation,
+                    const std::vector<PrimitiveExclusionSet*>& exclude_primitives) const
+{
+  QueryLock lock = volume_trees(volume);
+  TreeID scene = volume_to_surface_tree_map_.at(volume);
+  ray_tracing_interface()->ray_fire_batch(scene, origins, directions, dist_limits, hits, orientation, exclude_primitives);
+}
+
+void
+XDG::ray_fire_batch(MeshID volume,
+                    const std::vector<Position>& origins,
+                    const std::vector<Direction>& directions,
+                    std::vector<std::pair<double, MeshID>>& hits,
+                    const std::vector<double>& dist_limits,
+                    HitOrientation orientation,
+                    const std::vector<std::vector<MeshID>*>& exclude_primitives) const
+{
+  QueryLock lock = volume_trees(volume);
+  TreeID scene = volume_to_surface_tree_map_.at(volume);
+  ray_tracing_interface()->ray_fire_batch(scene, origins, directions, dist_limits, hits, orientation, exclude_primitives);
+}
+
 std::pair<double, MeshID> XDG::closest(MeshID volume,
-                                       const Position& origin) const
+                                       const Position& origin,
+                                       double max_radius) const
 {
+  QueryLock lock = volume_trees(volume);
   TreeID scene = volume_to_surface_tree_map_.at(volume);
-  return ray_tracing_interface()->closest(scene, origin);
+  return ray_tracing_interface()->closest(scene, origin, max_radius);
 }
 
 double XDG::closest_distance(MeshID volume,
-                             const Position& origin) const
+                             const Position& origin,
+                             double max_radius) const
+{
+  QueryLock lock = volume_trees(volume);
+  TreeID scene = volume_to_surface_tree_map_.at(volume);
+  return ray_tracing_interface()->closest(scene, origin, max_radius).first;
+}
+
+void XDG::closest_distance_batch(MeshID volume,
+                                 const std::vector<Position>& points,
+                                 std::vector<double>& distances,
+                                 double max_radius) const
 {
+  QueryLock lock = volume_trees(volume);
   TreeID scene = volume_to_surface_tree_map_.at(volume);
-  return ray_tracing_interface()->closest(scene, origin).first;
+  ray_tracing_interface()->closest_distance_batch(scene, points, distances, max_radius);
 }
 
 bool XDG::occluded(MeshID volume,
@@ -265,19 +584,137 @@ bool XDG::occluded(MeshID volume,
               const Direction& direction,
               double& dist) const
 {
+  QueryLock lock = volume_trees(volume);
   TreeID scene = volume_to_surface_tree_map_.at(volume);
   return ray_tracing_interface()->occluded(scene, origin, direction, dist);
 }
 
+bool XDG::point_in_volume(const VolumeHandle& handle,
+                          const Position& point,
+                          const Direction* direction,
+                          const PrimitiveExclusionSet* exclude_primitives) const
+{
+  VolumeHandle current;
+  QueryLock lock = handle_trees(handle, current);
+  if (!current.valid()) return false;
+  return ray_tracing_interface()->point_in_volume(current.surface_tree, point, direction, exclude_primitives);
+}
+
+bool XDG::point_in_volume(const VolumeHandle& handle,
+                          const Position& point,
+                          const Direction* direction,
+                          const std::vector<MeshID>* exclude_primitives) const
+{
+  VolumeHandle current;
+  QueryLock lock = handle_trees(handle, current);
+  if (!current.valid()) return false;
+  return ray_tracing_interface()->point_in_volume(current.surface_tree, point, direction, exclude_primitives);
+}
+
+std::pair<double, MeshID>
+XDG::ray_fire(const VolumeHandle& handle,
+              const Position& origin,
+              const Direction& direction,
+              const double dist_limit,
+              HitOrientation orientation,
+              PrimitiveExclusionSet* const exclude_primitives) const
+{
+  VolumeHandle current;
+  QueryLock lock = handle_trees(handle, current);
+  if (!current.valid()) return {INFTY, ID_NONE};
+  return ray_tracing_interface()->ray_fire(current.surface_tree, origin, direction, dist_limit, orientation, exclude_primitives);
+}
+
+std::pair<double, MeshID>
+XDG::ray_fire(const VolumeHandle& handle,
+              const Position& origin,
+              const Direction& direction,
+              const double dist_limit,
+              HitOrientation orientation,
+              std::vector<MeshID>* const exclude_primitives) const
+{
+  VolumeHandle current;
+  QueryLock lock = handle_trees(handle, current);
+  if (!current.valid()) return {INFTY, ID_NONE};
+  return ray_tracing_interface()->ray_fire(current.surface_tree, origin, direction, dist_limit, orientation, exclude_primitives);
+}
+
+HitRecord
+XDG::ray_fire_record(const VolumeHandle& handle,
+                     const Position& origin,
+                     const Direction& direction,
+                     const double dist_limit,
+                     HitOrientation orientation,
+                     PrimitiveExclusionSet* const exclude_primitives) const
+{
+  VolumeHandle current;
+  QueryLock lock = handle_trees(handle, current);
+  if (!current.valid()) return {};
+  return ray_tracing_interface()->ray_fire_record(current.surface_tree, origin, direction, dist_limit, orientation, exclude_primitives);
+}
+
+std::pair<double, MeshID> XDG::closest(const VolumeHandle& handle,
+                                       const Position& origin,
+                                       double max_radius) const
+{
+  VolumeHandle current;
+  QueryLock lock = handle_trees(handle, current);
+  if (!current.valid()) return {INFTY, ID_NONE};
+  return ray_tracing_interface()->closest(current.surface_tree, origin, max_radius);
+}
+
+double XDG::closest_distance(const VolumeHandle& handle,
+                             const Position& origin,
+                             double max_radius) const
+{
+  VolumeHandle current;
+  QueryLock lock = handle_trees(handle, current);
+  if (!current.valid()) return INFTY;
+  return ray_tracing_interface()->closest(current.surface_tree, origin, max_radius).first;
+}
+
+bool XDG::occluded(const VolumeHandle& handle,
+                   const Position& origin,
+                   const Direction& direction,
+                   double& dist) const
+{
+  VolumeHandle current;
+  QueryLock lock = handle_trees(handle, current);
+  if (!current.valid()) {
+    dist = INFTY;
+    return false;
+  }
+  return ray_tracing_interface()->occluded(current.surface_tree, origin, direction, dist);
+}
+
+MeshID XDG::find_element(const VolumeHandle& handle,
+                         const Position& point) const
+{
+  VolumeHandle current;
+  QueryLock lock = handle_trees(handle, current);
+  if (!current.valid()) return ID_NONE;
+  return ray_tracing_interface()->find_element(current.element_tree, point);
+}
+
 Direction XDG::surface_normal(MeshID surface,
                               Position point,
                               const std::vector<MeshID>* exclude_primitives) const
+{
+  if (exclude_primitives != nullptr && exclude_primitives->size() > 0)
+    return mesh_manager()->face_normal(exclude_primitives->back());
+  return surface_normal(surface, point);
+}
+
+Direction XDG::surface_normal(MeshID surface,
+                              Position point,
+                              const PrimitiveExclusionSet* exclude_primitives) const
 {
   MeshID element;
-  if (exclude_primitives != nullptr && exclude_primitives->size() > 0) {
+  if (exclude_primitives != nullptr && !exclude_primitives->empty()) {
     element = exclude_primitives->back();
   } else {
     auto surface_vols = mesh_manager()->get_parent_volumes(surface);
+    QueryLock lock = volume_trees(surface_vols.first);
     TreeID scene = volume_to_surface_tree_map_.at(surface_vols.first);
     element = ray_tracing_interface()->closest(scene, point).second;
 
@@ -332,4 +769,32 @@ double XDG::measure_volume_area(MeshID volume) const
   return area;
 }
 
+MemoryReport XDG::memory_report() const
+{
+  MemoryReport report;
+  QueryLock lock;
+  if (lazy_registration_ && !in_segment_visitor()) lock = QueryLock(registration_mutex_);
+
+  if (mesh_manager()) mesh_manager()->memory_report(report);
+  if (!ray_tracing_interface()) return report;
+
+  ray_tracing_interface()->memory_report(report);
+  report.add("xdg/tree_maps", unordered_map_memory(volume_to_surface_tree_map_) +
+                              unordered_map_memory(surface_to_tree_map_) +
+                              unordered_map_memory(volume_to_point_location_tree_map_));
+
+  for (const auto& [volume, surface_tree] : volume_to_surface_tree_map_) {
+    size_t bytes = ray_tracing_interface()->surface_tree_memory(surface_tree);
+    bool measured = ray_tracing_interface()->surface_tree_memory_measured(surface_tree);
+    auto element_tree = volume_to_point_location_tree_map_.find(volume);
+    if (element_tree != volume_to_point_location_tree_map_.end()) {
+      bytes += ray_tracing_interface()->element_tree_memory(element_tree->second);
+      measured &= ray_tracing_interface()->element_tree_memory_measured(element_tree->second);
+    }
+    report.volumes[volume] = bytes;
+    if (!measured) report.unmeasured_volumes.insert(volume);
+  }
+  return report;
+}
+
 } // namespace xdg
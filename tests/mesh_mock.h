@@ -7,7 +7,6 @@
 #include "xdg/error.h"
 #include "xdg/vec3da.h"
 #include "xdg/mesh_manager_interface.h"
-#include "xdg/element_face_accessor.h"
 
 #include "xdg/geometry/measure.h"
 #include "xdg/geometry/plucker.h"
@@ -96,6 +95,16 @@ public:
     return {vertices()[conn[0]], vertices()[conn[1]], vertices()[conn[2]]};
   }
 
+  virtual std::array<Vertex, 4> tet_vertices(MeshID element) const override {
+    const auto& conn = tetrahedron_connectivity()[element];
+    return {vertices()[conn[0]], vertices()[conn[1]], vertices()[conn[2]], vertices()[conn[3]]};
+  }
+
+  virtual const std::array<std::array<int, 3>, 4>& tet_face_ordering() const override {
+    static const std::array<std::array<int, 3>, 4> ordering {{{0, 1, 2}, {0, 2, 3}, {0, 3, 1}, {1, 3, 2}}};
+    return ordering;
+  }
+
   // Topology
   virtual std::pair<MeshID, MeshID> surface_senses(MeshID surface) const override {
     return surface_sense_map_.at(surface);
@@ -319,22 +328,3 @@ private:
   };
 
 };
-
-struct MockElementFaceAccessor : public ElementFaceAccessor {
-  MockElementFaceAccessor(const MeshMock* mesh_manager, MeshID element) :
-  ElementFaceAccessor(element) {
-    mesh_manager_ = mesh_manager;
-    const auto& conn = mesh_manager->tetrahedron_connectivity()[element];
-    tet_connectivity_ = mesh_manager->tet_faces(conn);
-  }
-
-  std::array<Vertex, 3> face_vertices(int i) const override {
-    return {mesh_manager_->vertices()[tet_connectivity_[i][0]],
-            mesh_manager_->vertices()[tet_connectivity_[i][1]],
-            mesh_manager_->vertices()[tet_connectivity_[i][2]]};
-  }
-
-  // data members
-  const MeshMock* mesh_manager_;
-  std::array<std::array<int, 3>, 4> tet_connectivity_;
-};
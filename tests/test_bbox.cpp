@@ -7,6 +7,7 @@
 
 // xdg includes
 #include "xdg/bbox.h"
+#include "xdg/util/rng.h"
 #include "xdg/vec3da.h"
 
 using namespace xdg;
@@ -141,4 +142,56 @@ TEST_CASE("Test BoundingBox")
   BoundingBox many_points_box = BoundingBox::from_points(many_points);
   REQUIRE(many_points_box.min_x == 0.0);
   REQUIRE(many_points_box.max_x == 999e5);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test RandomStream")
+{
+  // values are a function of the seed, stream and counter only
+  RandomStream a(7, 3);
+  RandomStream b(7, 3);
+  RandomStream other_stream(7, 4);
+  RandomStream other_seed(8, 3);
+  bool stream_differs = false;
+  bool seed_differs = false;
+  for (int i = 0; i < 100; i++) {
+    uint64_t value = a.next();
+    REQUIRE(value == b.next());
+    stream_differs |= value != other_stream.next();
+    seed_differs |= value != other_seed.next();
+  }
+  REQUIRE(stream_differs);
+  REQUIRE(seed_differs);
+  REQUIRE(a.counter() == 100);
+
+  // a stream can be positioned directly at any counter
+  RandomStream c(7, 3, 50);
+  RandomStream d(7, 3);
+  d.skip(50);
+  RandomStream e(7, 3);
+  for (int i = 0; i < 50; i++) e.next();
+  uint64_t value = c.next();
+  REQUIRE(value == d.next());
+  REQUIRE(value == e.next());
+
+  // uniform values are in [0, 1) with the expected mean
+  RandomStream rng(42);
+  double sum = 0.0;
+  int n_samples = 100000;
+  for (int i = 0; i < n_samples; i++) {
+    double x = rng.uniform();
+    REQUIRE(x >= 0.0);
+    REQUIRE(x < 1.0);
+    sum += x;
+  }
+  REQUIRE_THAT(sum / n_samples, Catch::Matchers::WithinAbs(0.5, 0.01));
+
+  // box samples are reproducible and within the box
+  BoundingBox bbox {-1.0, -2.0, -3.0, 1.0, 2.0, 3.0};
+  RandomStream rng1(42, 1);
+  RandomStream rng2(42, 1);
+  for (int i = 0; i < 1000; i++) {
+    Position p = bbox.sample_location(rng1);
+    REQUIRE(p == bbox.sample_location(rng2));
+    REQUIRE(bbox.contains(p));
+  }
+}
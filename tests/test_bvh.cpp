@@ -1,10 +1,15 @@
+#include <thread>
+#include <vector>
+
 // for testing
 #include <catch2/catch_test_macros.hpp>
 
 // xdg includes
+#include "xdg/config.h"
 #include "xdg/constants.h"
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/embree/ray_tracer.h"
+#include "xdg/xdg.h"
 
 #include "mesh_mock.h"
 
@@ -45,4 +50,340 @@ TEST_CASE("Test Mesh BVH")
     auto [volume_tree, element_tree] = rti->register_volume(mm, volume);
     volume_to_scene_map[volume] = volume_tree;
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test Surface Triangle Cache")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>(false);
+  mm->init();
+  MeshID volume = mm->volumes()[0];
+
+  std::shared_ptr<RayTracer> rti = std::make_shared<EmbreeRayTracer>();
+  TreeID tree = rti->register_volume(mm, volume).first;
+  REQUIRE(rti->triangle_cache_memory() == 0);
+
+  XDGConfig::config().set_cache_surface_triangles(true);
+  std::shared_ptr<RayTracer> cached_rti = std::make_shared<EmbreeRayTracer>();
+  TreeID cached_tree = cached_rti->register_volume(mm, volume).first;
+  XDGConfig::config().set_cache_surface_triangles(false);
+
+  // 12 triangles, each with 3 vertices and a normal
+  REQUIRE(cached_rti->triangle_cache_memory() == 12 * TriangleCache::N_COMPONENTS * sizeof(double));
+
+  // queries against the cached geometry should match the uncached geometry
+  Position origin {0.0, 0.0, 0.0};
+  std::vector<Direction> directions {{1.0, 0.0, 0.0}, {-1.0, 0.0, 0.0},
+                                     {0.0, 1.0, 0.0}, {0.0, -1.0, 0.0},
+                                     {0.0, 0.0, 1.0}, {0.0, 0.0, -1.0},
+                                     Direction(1.0, 1.0, 1.0).normalize()};
+  for (const auto& direction : directions) {
+    auto hit = rti->ray_fire(tree, origin, direction);
+    auto cached_hit = cached_rti->ray_fire(cached_tree, origin, direction);
+    REQUIRE(hit.first == cached_hit.first);
+    REQUIRE(hit.second == cached_hit.second);
+  }
+
+  Position point {1.0, 2.0, 3.0};
+  REQUIRE(rti->closest(tree, point) == cached_rti->closest(cached_tree, point));
+  REQUIRE(rti->point_in_volume(tree, point) == cached_rti->point_in_volume(cached_tree, point));
+}
+
+TEST_CASE("Test Native Triangle Geometry")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>(false);
+  mm->init();
+  MeshID volume = mm->volumes()[0];
+
+  std::shared_ptr<RayTracer> rti = std::make_shared<EmbreeRayTracer>();
+  TreeID tree = rti->register_volume(mm, volume).first;
+
+  XDGConfig::config().set_native_surface_triangles(true);
+  std::shared_ptr<RayTracer> native_rti = std::make_shared<EmbreeRayTracer>();
+  TreeID native_tree = native_rti->register_volume(mm, volume).first;
+  XDGConfig::config().set_native_surface_triangles(false);
+
+  // hits on the native triangle geometry are refined in double precision
+  // and should match the user geometry exactly
+  std::vector<Position> origins {{0.0, 0.0, 0.0}, {-10.0, 0.0, 0.0}, {1.0, 2.0, 3.0}};
+  std::vector<Direction> directions {{1.0, 0.0, 0.0}, {-1.0, 0.0, 0.0},
+                                     {0.0, 1.0, 0.0}, {0.0, -1.0, 0.0},
+                                     {0.0, 0.0, 1.0}, {0.0, 0.0, -1.0},
+                                     Direction(1.0, 1.0, 1.0).normalize()};
+  for (const auto& origin : origins) {
+    for (const auto& direction : directions) {
+      for (auto orientation : {HitOrientation::EXITING, HitOrientation::ENTERING}) {
+        auto hit = rti->ray_fire(tree, origin, direction, INFTY, orientation);
+        auto native_hit = native_rti->ray_fire(native_tree, origin, direction, INFTY, orientation);
+        REQUIRE(hit.first == native_hit.first);
+        REQUIRE(hit.second == native_hit.second);
+      }
+    }
+    REQUIRE(rti->point_in_volume(tree, origin) == native_rti->point_in_volume(native_tree, origin));
+  }
+
+  // excluded primitives are culled by the filter callback
+  std::vector<MeshID> exclude_primitives;
+  auto hit = native_rti->ray_fire(native_tree, {0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, INFTY, HitOrientation::EXITING, &exclude_primitives);
+  REQUIRE(hit.second != ID_NONE);
+  REQUIRE(exclude_primitives.size() == 1);
+  hit = native_rti->ray_fire(native_tree, {0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, INFTY, HitOrientation::EXITING, &exclude_primitives);
+  REQUIRE(hit.second == ID_NONE);
+}
+
+TEST_CASE("Test Deferred Tree Builds")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+  MeshID volume = mm->volumes()[0];
+
+  std::shared_ptr<RayTracer> rti = std::make_shared<EmbreeRayTracer>();
+  TreeID tree = rti->register_volume(mm, volume).first;
+
+  // trees registered with deferred builds are usable once the pending builds complete
+  std::shared_ptr<RayTracer> deferred_rti = std::make_shared<EmbreeRayTracer>();
+  deferred_rti->defer_tree_builds(true);
+  auto [deferred_tree, deferred_element_tree] = deferred_rti->register_volume(mm, volume);
+  deferred_rti->create_global_surface_tree();
+  deferred_rti->create_global_element_tree();
+  deferred_rti->build_pending_trees();
+  deferred_rti->defer_tree_builds(false);
+
+  REQUIRE(deferred_rti->num_registered_surface_trees() == 2);
+  REQUIRE(deferred_rti->num_registered_element_trees() == 2);
+
+  Position origin {0.0, 0.0, 0.0};
+  std::vector<Direction> directions {{1.0, 0.0, 0.0}, {0.0, -1.0, 0.0},
+                                     {0.0, 0.0, 1.0}, Direction(1.0, 1.0, 1.0).normalize()};
+  for (const auto& direction : directions) {
+    auto hit = rti->ray_fire(tree, origin, direction);
+    auto deferred_hit = deferred_rti->ray_fire(deferred_tree, origin, direction);
+    REQUIRE(hit.first == deferred_hit.first);
+    REQUIRE(hit.second == deferred_hit.second);
+  }
+  REQUIRE(deferred_rti->find_element(deferred_element_tree, origin) != ID_NONE);
+  REQUIRE(deferred_rti->find_element(origin) != ID_NONE);
+
+  // prepare_raytracer builds all trees after registration and records the phase timings
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+  const auto& timings = xdg->build_timings();
+  REQUIRE(timings.registration >= 0.0);
+  REQUIRE(timings.tree_build >= 0.0);
+  REQUIRE(timings.total >= timings.registration + timings.tree_build);
+  REQUIRE(xdg->ray_fire(volume, origin, {1.0, 0.0, 0.0}).second != ID_NONE);
+}
+
+TEST_CASE("Test Build Profiles")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+  MeshID volume = mm->volumes()[0];
+
+  std::shared_ptr<RayTracer> rti = std::make_shared<EmbreeRayTracer>();
+  TreeID tree = rti->register_volume(mm, volume).first;
+
+  // the build profile affects performance only, query results are unchanged
+  for (auto profile : {BuildProfile::FAST_BUILD, BuildProfile::BALANCED}) {
+    XDGConfig::config().set_build_profile(profile);
+    auto profile_rti = std::make_shared<EmbreeRayTracer>();
+    XDGConfig::config().set_build_profile(BuildProfile::MAX_TRACE);
+    REQUIRE(profile_rti->build_profile(TreeType::SURFACE) == profile);
+    REQUIRE(profile_rti->build_profile(TreeType::ELEMENT) == profile);
+    REQUIRE(profile_rti->build_profile(TreeType::GLOBAL) == profile);
+
+    auto [profile_tree, profile_element_tree] = profile_rti->register_volume(mm, volume);
+    Position origin {0.0, 0.0, 0.0};
+    std::vector<Direction> directions {{-1.0, 0.0, 0.0}, {0.0, 1.0, 0.0},
+                                       {0.0, 0.0, -1.0}, Direction(1.0, -1.0, 1.0).normalize()};
+    for (const auto& direction : directions) {
+      auto hit = rti->ray_fire(tree, origin, direction);
+      auto profile_hit = profile_rti->ray_fire(profile_tree, origin, direction);
+      REQUIRE(hit.first == profile_hit.first);
+      REQUIRE(hit.second == profile_hit.second);
+    }
+    REQUIRE(profile_rti->find_element(profile_element_tree, origin) != ID_NONE);
+  }
+}
+
+TEST_CASE("Test Lazy Volume Registration")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+  MeshID volume = mm->volumes()[0];
+
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  XDGConfig::config().set_lazy_volume_registration(true);
+  std::shared_ptr<XDG> lazy_xdg = std::make_shared<XDG>(mm);
+  lazy_xdg->prepare_raytracer();
+  XDGConfig::config().set_lazy_volume_registration(false);
+
+  // no trees are built until a volume is queried
+  REQUIRE(lazy_xdg->lazy_registration());
+  REQUIRE(lazy_xdg->ray_tracing_interface()->num_registered_trees() == 0);
+  REQUIRE_FALSE(lazy_xdg->volume_registered(volume));
+
+  // concurrent first queries register the volume once
+  Position origin {0.0, 0.0, 0.0};
+  std::vector<Direction> directions {{1.0, 0.0, 0.0}, {0.0, -1.0, 0.0},
+                                     {0.0, 0.0, 1.0}, Direction(1.0, 1.0, 1.0).normalize()};
+  std::vector<std::pair<double, MeshID>> hits(directions.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < directions.size(); ++i) {
+    threads.emplace_back([&, i]() { hits[i] = lazy_xdg->ray_fire(volume, origin, directions[i]); });
+  }
+  for (auto& thread : threads) thread.join();
+
+  REQUIRE(lazy_xdg->volume_registered(volume));
+  REQUIRE(lazy_xdg->ray_tracing_interface()->num_registered_surface_trees() == 1);
+  REQUIRE(lazy_xdg->ray_tracing_interface()->num_registered_element_trees() == 1);
+  for (size_t i = 0; i < directions.size(); ++i) {
+    auto hit = xdg->ray_fire(volume, origin, directions[i]);
+    REQUIRE(hit.first == hits[i].first);
+    REQUIRE(hit.second == hits[i].second);
+  }
+  REQUIRE(lazy_xdg->point_in_volume(volume, origin) == xdg->point_in_volume(volume, origin));
+  REQUIRE(lazy_xdg->find_element(volume, origin) == xdg->find_element(volume, origin));
+
+  // global queries build the global trees
+  REQUIRE(lazy_xdg->find_element(origin) == xdg->find_element(origin));
+  REQUIRE(lazy_xdg->ray_tracing_interface()->num_registered_trees() == 4);
+
+  // segment visitors may query the same XDG while its lock is held
+  size_t n_visited = 0;
+  lazy_xdg->segments(origin, {1.0, 0.0, 0.0}, [&](MeshID element, double) {
+    REQUIRE(lazy_xdg->find_element(volume, origin) == xdg->find_element(volume, origin));
+    REQUIRE(lazy_xdg->volume_registered(volume));
+    n_visited++;
+  });
+  REQUIRE(n_visited > 0);
+
+  // evicted volumes are registered again on the next query
+  lazy_xdg->evict_volume(volume);
+  REQUIRE_FALSE(lazy_xdg->volume_registered(volume));
+  REQUIRE(lazy_xdg->registered_volumes().empty());
+  REQUIRE(lazy_xdg->ray_tracing_interface()->num_registered_trees() == 0);
+
+  auto hit = lazy_xdg->ray_fire(volume, origin, directions[0]);
+  REQUIRE(hit.first == hits[0].first);
+  REQUIRE(hit.second == hits[0].second);
+  REQUIRE(lazy_xdg->registered_volumes() == std::vector<MeshID>{volume});
+  REQUIRE(lazy_xdg->find_element(origin) == xdg->find_element(origin));
+
+  // repeated eviction doesn't grow the memory held by the ray tracer
+  size_t ref_bytes = lazy_xdg->memory_report().subsystem("ray_tracer/primitive_refs");
+  for (int i = 0; i < 3; ++i) {
+    lazy_xdg->evict_volume(volume);
+    hit = lazy_xdg->ray_fire(volume, origin, directions[0]);
+    REQUIRE(hit.first == hits[0].first);
+    REQUIRE(lazy_xdg->find_element(origin) == xdg->find_element(origin));
+  }
+  REQUIRE(lazy_xdg->memory_report().subsystem("ray_tracer/primitive_refs") == ref_bytes);
+}
+
+TEST_CASE("Test Volume Handles")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+  MeshID volume = mm->volumes()[0];
+
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  VolumeHandle handle = xdg->volume_handle(volume);
+  REQUIRE(handle.valid());
+  REQUIRE(handle.volume == volume);
+  REQUIRE_FALSE(VolumeHandle().valid());
+
+  // handle-based queries match the volume ID queries
+  std::vector<Position> points {{0.0, 0.0, 0.0}, {4.0, 0.0, 0.0}, {-1.5, 5.5, -3.5}, {10.0, 0.0, 0.0}};
+  Direction direction = Direction(1.0, 1.0, 1.0).normalize();
+  for (const auto& p : points) {
+    REQUIRE(xdg->point_in_volume(handle, p) == xdg->point_in_volume(volume, p));
+    REQUIRE(xdg->ray_fire(handle, p, direction) == xdg->ray_fire(volume, p, direction));
+    REQUIRE(xdg->closest(handle, p) == xdg->closest(volume, p));
+    REQUIRE(xdg->closest_distance(handle, p, 1.0) == xdg->closest_distance(volume, p, 1.0));
+    REQUIRE(xdg->find_element(handle, p) == xdg->find_element(volume, p));
+    double handle_dist = 0.0, volume_dist = 0.0;
+    REQUIRE(xdg->occluded(handle, p, direction, handle_dist) == xdg->occluded(volume, p, direction, volume_dist));
+    REQUIRE(handle_dist == volume_dist);
+  }
+
+  // resolving a handle registers the volume with lazy registration
+  XDGConfig::config().set_lazy_volume_registration(true);
+  std::shared_ptr<XDG> lazy_xdg = std::make_shared<XDG>(mm);
+  lazy_xdg->prepare_raytracer();
+  XDGConfig::config().set_lazy_volume_registration(false);
+
+  REQUIRE_FALSE(lazy_xdg->volume_registered(volume));
+  VolumeHandle lazy_handle = lazy_xdg->volume_handle(volume);
+  REQUIRE(lazy_xdg->volume_registered(volume));
+  REQUIRE(lazy_xdg->ray_fire(lazy_handle, points[0], direction) == xdg->ray_fire(volume, points[0], direction));
+
+  // a handle to an evicted volume registers the volume again
+  lazy_xdg->evict_volume(volume);
+  REQUIRE_FALSE(lazy_xdg->volume_registered(volume));
+  REQUIRE(lazy_xdg->ray_fire(lazy_handle, points[0], direction) == xdg->ray_fire(volume, points[0], direction));
+  REQUIRE(lazy_xdg->volume_registered(volume));
+  REQUIRE(lazy_xdg->find_element(lazy_handle, points[0]) == xdg->find_element(volume, points[0]));
+
+  // queries with an invalid handle miss
+  VolumeHandle invalid;
+  double dist = 0.0;
+  REQUIRE_FALSE(xdg->point_in_volume(invalid, points[0]));
+  REQUIRE(xdg->ray_fire(invalid, points[0], direction).second == ID_NONE);
+  REQUIRE_FALSE(xdg->ray_fire_record(invalid, points[0], direction).hit());
+  REQUIRE(xdg->closest(invalid, points[0]).second == ID_NONE);
+  REQUIRE(xdg->closest_distance(invalid, points[0]) == INFTY);
+  REQUIRE_FALSE(xdg->occluded(invalid, points[0], direction, dist));
+  REQUIRE(xdg->find_element(invalid, points[0]) == ID_NONE);
+}
+
+TEST_CASE("Test Memory Report")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+  MeshID volume = mm->volumes()[0];
+
+  // a tree built on its own has its BVH memory measured by the device monitor
+  auto rti = std::make_shared<EmbreeRayTracer>();
+  auto [surface_tree, element_tree] = rti->register_volume(mm, volume);
+  size_t ref_bytes = mm->num_volume_faces(volume) * sizeof(PrimitiveRef);
+  REQUIRE(rti->surface_tree_memory(surface_tree) > ref_bytes);
+  REQUIRE(rti->element_tree_memory(element_tree) > 0);
+  REQUIRE(rti->surface_tree_memory_measured(surface_tree));
+  REQUIRE(rti->element_tree_memory_measured(element_tree));
+
+  MemoryReport rti_report;
+  rti->memory_report(rti_report);
+  REQUIRE(rti_report.subsystem("ray_tracer/embree_device") > 0);
+  REQUIRE(rti_report.subsystem("ray_tracer/primitive_refs") >= ref_bytes);
+
+  rti->unregister_volume(surface_tree, element_tree);
+  REQUIRE(rti->surface_tree_memory(surface_tree) == 0);
+  REQUIRE(rti->element_tree_memory(element_tree) == 0);
+  REQUIRE_FALSE(rti->surface_tree_memory_measured(surface_tree));
+
+  // the XDG report covers the mesh manager, the ray tracer and each registered volume
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+  MemoryReport report = xdg->memory_report();
+  REQUIRE(report.subsystem("ray_tracer/embree_device") > 0);
+  REQUIRE(report.subsystem("xdg/tree_maps") > 0);
+  REQUIRE(report.subsystem("not/a/subsystem") == 0);
+  REQUIRE(report.volumes.count(volume) == 1);
+  REQUIRE(report.volumes.at(volume) > 0);
+  REQUIRE(report.total() >= report.subsystem("ray_tracer/embree_device"));
+  REQUIRE(report.to_string().find("Total") != std::string::npos);
+
+  // volume trees built one at a time are all measured
+  XDGConfig::config().set_measure_tree_memory(true);
+  std::shared_ptr<XDG> measured_xdg = std::make_shared<XDG>(mm);
+  measured_xdg->prepare_raytracer();
+  XDGConfig::config().set_measure_tree_memory(false);
+  MemoryReport measured_report = measured_xdg->memory_report();
+  REQUIRE(measured_report.unmeasured_volumes.empty());
+  REQUIRE(measured_report.volumes.at(volume) > ref_bytes);
+  REQUIRE(measured_report.to_string().find("not measured") == std::string::npos);
+}
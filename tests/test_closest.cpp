@@ -1,5 +1,6 @@
 #include <memory>
 #include <iostream>
+#include <vector>
 
 // for testing
 #include <catch2/catch_test_macros.hpp>
@@ -58,6 +59,55 @@ TEST_CASE("Test Mesh Mock")
 
 }
 
+TEST_CASE("Test Bounded Closest Distance")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  MeshID volume = mm->volumes()[0];
+
+  // the nearest surface to the origin is 2.0 away
+  Position origin {0.0, 0.0, 0.0};
+
+  // no surface within the search radius
+  REQUIRE(xdg->closest_distance(volume, origin, 1.5) == INFTY);
+  auto [distance, element] = xdg->closest(volume, origin, 1.5);
+  REQUIRE(distance == INFTY);
+  REQUIRE(element == ID_NONE);
+
+  // a search radius beyond the nearest surface gives the unbounded result
+  REQUIRE_THAT(xdg->closest_distance(volume, origin, 2.5), Catch::Matchers::WithinAbs(2.0, 1e-6));
+  REQUIRE_THAT(xdg->closest_distance(volume, origin, 1e6), Catch::Matchers::WithinAbs(2.0, 1e-6));
+  REQUIRE(xdg->closest(volume, origin, 2.5).second == xdg->closest(volume, origin).second);
+
+  // batched queries match individual queries
+  std::vector<Position> points;
+  for (int i = 0; i < 100; ++i) {
+    points.push_back({rand_double(-10.0, 10.0), rand_double(-10.0, 10.0), rand_double(-10.0, 10.0)});
+  }
+
+  std::vector<double> distances;
+  xdg->closest_distance_batch(volume, points, distances);
+  REQUIRE(distances.size() == points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    REQUIRE(distances[i] == xdg->closest_distance(volume, points[i]));
+  }
+
+  double max_radius = 3.0;
+  xdg->closest_distance_batch(volume, points, distances, max_radius);
+  REQUIRE(distances.size() == points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    double expected = xdg->closest_distance(volume, points[i]);
+    if (expected < max_radius) {
+      REQUIRE(distances[i] == expected);
+    } else {
+      REQUIRE(distances[i] == INFTY);
+    }
+  }
+}
+
 TEST_CASE("Closest Point Unit Test")
 {
   std::array<Position, 3> triangle {
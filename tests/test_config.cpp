@@ -50,4 +50,21 @@ TEST_CASE("Config set threads")
   xdg::XDGConfig::config().reset();
   xdg::XDGConfig::config().set_n_threads(4);
   REQUIRE(xdg::XDGConfig::config().n_threads() == 4);
-}
\ No newline at end of file
+}
+TEST_CASE("Config build profiles")
+{
+  using namespace xdg;
+  XDGConfig::config().reset();
+  REQUIRE(XDGConfig::config().build_profile(TreeType::SURFACE) == BuildProfile::MAX_TRACE);
+  REQUIRE(XDGConfig::config().build_profile(TreeType::ELEMENT) == BuildProfile::MAX_TRACE);
+  REQUIRE(XDGConfig::config().build_profile(TreeType::GLOBAL) == BuildProfile::MAX_TRACE);
+
+  XDGConfig::config().set_build_profile(BuildProfile::BALANCED);
+  XDGConfig::config().set_build_profile(TreeType::ELEMENT, BuildProfile::FAST_BUILD);
+  REQUIRE(XDGConfig::config().build_profile(TreeType::SURFACE) == BuildProfile::BALANCED);
+  REQUIRE(XDGConfig::config().build_profile(TreeType::ELEMENT) == BuildProfile::FAST_BUILD);
+  REQUIRE(XDGConfig::config().build_profile(TreeType::GLOBAL) == BuildProfile::BALANCED);
+
+  XDGConfig::config().reset();
+  REQUIRE(XDGConfig::config().build_profile(TreeType::ELEMENT) == BuildProfile::MAX_TRACE);
+}
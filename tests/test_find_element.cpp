@@ -1,10 +1,15 @@
+#include <vector>
+
 // for testing
 #include <catch2/catch_test_macros.hpp>
 
 // xdg includes
+#include "xdg/config.h"
 #include "xdg/constants.h"
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/embree/ray_tracer.h"
+#include "xdg/tetrahedron_contain.h"
+#include "xdg/xdg.h"
 
 #include "mesh_mock.h"
 
@@ -42,4 +47,105 @@ TEST_CASE("Test Find Volumetric Element")
   REQUIRE(element_id == ID_NONE); // should not find an element since the point is outside the volume
 }
 
+TEST_CASE("Test Find Element Transform Cache")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+  MeshID volume = mm->volumes()[0];
+
+  std::shared_ptr<RayTracer> rti = std::make_shared<EmbreeRayTracer>();
+  TreeID tree = rti->register_volume(mm, volume).second;
+  REQUIRE(rti->element_cache_memory() == 0);
+
+  XDGConfig::config().set_cache_element_transforms(true);
+  std::shared_ptr<RayTracer> cached_rti = std::make_shared<EmbreeRayTracer>();
+  TreeID cached_tree = cached_rti->register_volume(mm, volume).second;
+  XDGConfig::config().set_cache_element_transforms(false);
+
+  // 12 tetrahedra, each with an inverse matrix and a vertex
+  REQUIRE(cached_rti->element_cache_memory() == 12 * TetTransformCache::N_COMPONENTS * sizeof(double));
+
+  // point location with the cached transforms should match the direct test
+  std::vector<Position> points {{0.0, 0.0, 0.0}, {1.0, 2.0, 3.0}, {-1.5, 5.5, -3.5},
+                                {4.9, -2.9, 6.9}, {10.0, 10.0, 10.0}, {-2.5, 0.0, 0.0}};
+  for (const auto& point : points) {
+    MeshID element = rti->find_element(tree, point);
+    MeshID cached_element = cached_rti->find_element(cached_tree, point);
+    REQUIRE((element == ID_NONE) == (cached_element == ID_NONE));
+    if (cached_element == ID_NONE) continue;
+    // points on shared faces may be located in either element
+    auto v = mm->tet_vertices(cached_element);
+    REQUIRE(plucker_tet_containment_test(point, v[0], v[1], v[2], v[3]));
+  }
+}
+
+TEST_CASE("Test Find Element With Hint")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  std::vector<Position> points {{0.0, 0.0, 0.0}, {1.0, 2.0, 3.0}, {-1.5, 5.5, -3.5},
+                                {4.9, -2.9, 6.9}, {10.0, 10.0, 10.0}, {3.0, -1.0, 2.0}};
+  int n_elements = mm->num_volume_elements(mm->volumes()[0]);
+
+  // walks from every element, with and without the flat topology, should
+  // locate the same element as the element tree
+  for (bool topology : {false, true}) {
+    if (topology) mm->build_tet_topology(mm->tet_face_ordering());
+    else mm->clear_tet_topology();
+
+    for (const auto& point : points) {
+      MeshID expected = xdg->find_element(point);
+      for (MeshID hint = 0; hint < n_elements; hint++) {
+        REQUIRE(xdg->find_element(point, hint) == expected);
+        MeshID walk_element = mm->locate_element(hint, point, 100);
+        if (walk_element != ID_NONE) REQUIRE(walk_element == expected);
+      }
+      REQUIRE(xdg->find_element(point, ID_NONE) == expected);
+    }
+  }
+
+  // a walk from the element containing the point ends immediately
+  Position point {1.2, 2.1, 3.0};
+  MeshID element = xdg->find_element(point);
+  REQUIRE(mm->locate_element(element, point, 1) == element);
+}
+
+TEST_CASE("Test Find Element Batch")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+  MeshID volume = mm->volumes()[0];
+
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
 
+  std::vector<Position> points;
+  for (int i = 0; i < 101; i++) {
+    points.push_back({-3.0 + 0.09 * i, 7.0 - 0.11 * i, -5.0 + 0.13 * i});
+  }
+
+  // batched results are in the order of the points and match single queries
+  std::vector<MeshID> elements;
+  xdg->find_element_batch(points, elements);
+  REQUIRE(elements.size() == points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    REQUIRE(elements[i] == xdg->find_element(points[i]));
+  }
+
+  xdg->find_element_batch(volume, points, elements);
+  REQUIRE(elements.size() == points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    REQUIRE(elements[i] == xdg->find_element(volume, points[i]));
+  }
+
+  // the point containment batch on the volume is consistent with the elements
+  std::vector<uint8_t> inside;
+  xdg->point_in_volume_batch(volume, points, inside);
+  for (size_t i = 0; i < points.size(); i++) {
+    REQUIRE(static_cast<bool>(inside[i]) == xdg->point_in_volume(volume, points[i]));
+  }
+}
@@ -1,5 +1,6 @@
 // stl includes
 #include <iostream>
+#include <map>
 #include <memory>
 
 // testing includes
@@ -29,31 +30,36 @@ public:
         xdg->mesh_manager()->parse_metadata();
         xdg->prepare_raytracer();
 
-        SimulationData sim_data;
+        for (auto mode : {TransportMode::HISTORY, TransportMode::EVENT}) {
+          SimulationData sim_data;
 
-        sim_data.xdg_ = xdg;
-        sim_data.verbose_particles_ = false;
-        sim_data.implicit_complement_is_graveyard_ = true;
+          sim_data.xdg_ = xdg;
+          sim_data.verbose_particles_ = false;
+          sim_data.implicit_complement_is_graveyard_ = true;
+          sim_data.mode_ = mode;
 
-        transport_particles(sim_data);
-        sim_data_.push_back(sim_data);
+          transport_particles(sim_data);
+          sim_data_[mode].push_back(sim_data);
+        }
       }
     }
 
     void check() {
-      auto ref_data_ = sim_data_[0];
-      for(int i = 1; i < sim_data_.size(); i++) {
-        auto data = sim_data_[i];
-        for (const auto& [volume, distance] : ref_data_.cell_tracks) {
-          REQUIRE_THAT(data.cell_tracks[volume], Catch::Matchers::WithinAbs(ref_data_.cell_tracks[volume], 1e-10));
+      // results are compared between mesh libraries for each transport mode
+      for (auto& [mode, mode_data] : sim_data_) {
+        auto ref_data_ = mode_data[0];
+        for(int i = 1; i < mode_data.size(); i++) {
+          auto data = mode_data[i];
+          for (const auto& [volume, distance] : ref_data_.cell_tracks) {
+            REQUIRE_THAT(data.cell_tracks[volume], Catch::Matchers::WithinAbs(ref_data_.cell_tracks[volume], 1e-10));
+          }
         }
       }
-
     }
 
 private:
   // Data members
-  std::vector<SimulationData> sim_data_;
+  std::map<TransportMode, std::vector<SimulationData>> sim_data_;
   //! A set of test cases (pairs of filenames and mesh libraries) to compare
   std::vector<std::pair<std::string, MeshLibrary>> test_cases_;
 };
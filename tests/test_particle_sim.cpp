@@ -0,0 +1,56 @@
+// stl includes
+#include <memory>
+#include <string>
+
+// testing includes
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+// xdg includes
+#include "xdg/xdg.h"
+
+#include "particle_sim.h"
+
+using namespace xdg;
+
+// Transport the same particles with a fixed seed in both transport modes
+void check_transport_modes(const std::string& filename)
+{
+  std::shared_ptr<XDG> xdg {XDG::create(MeshLibrary::MOAB)};
+  xdg->mesh_manager()->load_file(filename);
+  xdg->mesh_manager()->init();
+  xdg->mesh_manager()->parse_metadata();
+  xdg->prepare_raytracer();
+
+  auto transport = [&](TransportMode mode) {
+    SimulationData sim_data;
+    sim_data.xdg_ = xdg;
+    sim_data.implicit_complement_is_graveyard_ = true;
+    sim_data.seed_ = 7;
+    sim_data.mode_ = mode;
+    transport_particles(sim_data);
+    return sim_data;
+  };
+
+  SimulationData history = transport(TransportMode::HISTORY);
+  SimulationData event = transport(TransportMode::EVENT);
+
+  // each particle follows the same path and events in both modes
+  REQUIRE(history.n_events_ > 0);
+  REQUIRE(event.n_events_ == history.n_events_);
+  REQUIRE(event.cell_tracks.size() == history.cell_tracks.size());
+  for (const auto& [cell, distance] : history.cell_tracks) {
+    REQUIRE(event.cell_tracks.count(cell) == 1);
+    REQUIRE_THAT(event.cell_tracks.at(cell), Catch::Matchers::WithinAbs(distance, 1e-10));
+  }
+}
+
+TEST_CASE("Test Particle Sim Transport Modes 1 Vol")
+{
+  check_transport_modes("jezebel.h5m");
+}
+
+TEST_CASE("Test Particle Sim Transport Modes 2 Vol")
+{
+  check_transport_modes("cyl-brick.h5m");
+}
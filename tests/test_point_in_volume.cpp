@@ -1,3 +1,6 @@
+#include <cmath>
+#include <vector>
+
 // for testing
 #include <catch2/catch_template_test_macros.hpp>
 #include <catch2/catch_test_macros.hpp>
@@ -6,6 +9,7 @@
 // xdg includes
 #include "xdg/constants.h"
 #include "xdg/mesh_manager_interface.h"
+#include "xdg/xdg.h"
 #include "util.h"
 #include "mesh_mock.h"
 
@@ -78,3 +82,71 @@ TEMPLATE_TEST_CASE("Point-in-volume on MeshMock", "[piv][mock]",
     REQUIRE(result == false);
   }
 }
+
+TEMPLATE_TEST_CASE("Find volume on MeshMock", "[piv][mock]",
+                   Embree_Raytracer)
+{
+  constexpr auto rt_backend = TestType::value;
+
+  DYNAMIC_SECTION(fmt::format("Backend = {}", rt_backend)) {
+    check_ray_tracer_supported(rt_backend); // skip if backend not enabled at configuration time
+
+    auto mm = std::make_shared<MeshMock>(false);
+    mm->init();
+    MeshID volume = mm->volumes()[0];
+
+    auto xdg = std::make_shared<XDG>(mm, rt_backend);
+    xdg->prepare_raytracer();
+    REQUIRE(xdg->ray_tracing_interface()->global_surface_tree() != TREE_NONE);
+
+    // find_volume should agree with the point containment test of the volume
+    std::vector<Position> points {{0.0, 0.0, 0.0}, {4.0 - 1e-6, 0.0, 0.0}, {-1.0, 2.0, 3.0},
+                                  {0.0, 0.0, 1000.0}, {5.1, 0.0, 0.0}, {-20.0, -20.0, -20.0}};
+    std::vector<Direction> directions {{1.0, 0.0, 0.0}, {-1.0, 0.0, 0.0}, {0.0, 0.0, 1.0},
+                                       Direction(1.0, 1.0, 1.0).normalize()};
+    for (const auto& point : points) {
+      for (const auto& direction : directions) {
+        MeshID expected = xdg->point_in_volume(volume, point, &direction) ? volume : mm->implicit_complement();
+        REQUIRE(xdg->find_volume(point, direction) == expected);
+      }
+    }
+  }
+}
+
+TEMPLATE_TEST_CASE("Point-in-volume batch on MeshMock", "[piv][mock]",
+                   Embree_Raytracer,
+                   GPRT_Raytracer)
+{
+  constexpr auto rt_backend = TestType::value;
+
+  DYNAMIC_SECTION(fmt::format("Backend = {}", rt_backend)) {
+    check_ray_tracer_supported(rt_backend); // skip if backend not enabled at configuration time
+    auto rti = create_raytracer(rt_backend);
+    REQUIRE(rti);
+
+    auto mm = std::make_shared<MeshMock>(false);
+    mm->init();
+    auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+    rti->init();
+
+    // enough points to fill several packets of any width, plus a partial packet
+    std::vector<Position> points;
+    std::vector<Direction> directions;
+    for (int i = 0; i < 53; i++) {
+      points.push_back({-4.0 + 0.2 * i, 1.0 - 0.1 * i, -6.0 + 0.3 * i});
+      directions.push_back(Direction(std::cos(i), std::sin(i), 0.5).normalize());
+    }
+
+    std::vector<uint8_t> results;
+    rti->point_in_volume_batch(volume_tree, points, results);
+    REQUIRE(results.size() == points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+      REQUIRE(static_cast<bool>(results[i]) == rti->point_in_volume(volume_tree, points[i]));
+    }
+
+    rti->point_in_volume_batch(volume_tree, points, results, directions);
+    for (size_t i = 0; i < points.size(); i++) {
+      REQUIRE(static_cast<bool>(results[i]) == rti->point_in_volume(volume_tree, points[i], &directions[i]));
+    }
+  }
+}
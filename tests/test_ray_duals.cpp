@@ -244,4 +244,61 @@ TEST_CASE("Test RTCDPointQuery properties")
     REQUIRE(query.dbly == 2.0);
     REQUIRE(query.dblz == 3.0);
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test PrimitiveExclusionSet")
+{
+  PrimitiveExclusionSet exclusions;
+  REQUIRE(exclusions.empty());
+  REQUIRE(exclusions.size() == 0);
+  REQUIRE_FALSE(exclusions.contains(0));
+
+  // fill past the inline capacity so that the hashed overflow is used
+  const MeshID n_primitives = 3 * PrimitiveExclusionSet::INLINE_CAPACITY;
+  for (MeshID i = 0; i < n_primitives; i++) {
+    exclusions.push_back(10 * i);
+    REQUIRE(exclusions.back() == 10 * i);
+  }
+  REQUIRE(exclusions.size() == n_primitives);
+
+  for (MeshID i = 0; i < n_primitives; i++) {
+    REQUIRE(exclusions.contains(10 * i));
+    REQUIRE_FALSE(exclusions.contains(10 * i + 1));
+    REQUIRE(exclusions[i] == 10 * i);
+  }
+
+  // primitives are kept in insertion order
+  std::vector<MeshID> primitives = exclusions.to_vector();
+  REQUIRE(primitives.size() == n_primitives);
+  REQUIRE(PrimitiveExclusionSet(primitives).to_vector() == primitives);
+
+  exclusions.clear();
+  REQUIRE(exclusions.empty());
+  REQUIRE_FALSE(exclusions.contains(0));
+  REQUIRE_FALSE(exclusions.contains(10 * (n_primitives - 1)));
+
+  exclusions = {4};
+  REQUIRE(exclusions.size() == 1);
+  REQUIRE(exclusions.back() == 4);
+}
+
+TEST_CASE("Test Duplicate Crossing Removal")
+{
+  // crossings of a ray through an edge shared by surfaces 1 and 2, with
+  // duplicates that aren't adjacent once sorted by distance
+  std::vector<RayCrossing> crossings {
+    {1.0, 1, 10, Sense::FORWARD},
+    {1.0 + 0.1 * TINY_BIT, 2, 20, Sense::FORWARD},
+    {1.0 + 0.2 * TINY_BIT, 1, 11, Sense::FORWARD},
+    {1.0 + 0.3 * TINY_BIT, 2, 21, Sense::FORWARD},
+    {1.0 + 0.4 * TINY_BIT, 1, 12, Sense::REVERSE},
+    {2.0, 1, 13, Sense::FORWARD}
+  };
+  remove_duplicate_crossings(crossings);
+
+  REQUIRE(crossings.size() == 4);
+  REQUIRE(crossings[0].primitive == 10);
+  REQUIRE(crossings[1].primitive == 20);
+  REQUIRE(crossings[2].primitive == 12);
+  REQUIRE(crossings[3].primitive == 13);
+}
@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
 // for testing
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_template_test_macros.hpp>
@@ -6,8 +11,11 @@
 
 
 // xdg includes
+#include "xdg/config.h"
 #include "xdg/constants.h"
 #include "xdg/mesh_manager_interface.h"
+#include "xdg/query_stats.h"
+#include "xdg/xdg.h"
 #include "mesh_mock.h"
 #include "util.h"
 
@@ -108,5 +116,272 @@ TEMPLATE_TEST_CASE("Ray Fire on MeshMock (per-backend sections)", "[rayfire][moc
 
     intersection = rti->ray_fire(volume_tree, origin, direction, INFTY, HitOrientation::EXITING, &exclude_primitives);
     REQUIRE(intersection.second == ID_NONE);
+
+    // the same using an exclusion set
+    PrimitiveExclusionSet exclusion_set;
+    intersection = rti->ray_fire(volume_tree, origin, direction, INFTY, HitOrientation::EXITING, &exclusion_set);
+    REQUIRE_THAT(intersection.first, Catch::Matchers::WithinAbs(5.0, 1e-6));
+    REQUIRE(exclusion_set.size() == 1);
+    REQUIRE(exclusion_set.back() == exclude_primitives.back());
+
+    intersection = rti->ray_fire(volume_tree, origin, direction, INFTY, HitOrientation::EXITING, &exclusion_set);
+    REQUIRE(intersection.second == ID_NONE);
+
+    // a literal null pointer excludes nothing
+    intersection = rti->ray_fire(volume_tree, origin, direction, INFTY, HitOrientation::EXITING, nullptr);
+    REQUIRE_THAT(intersection.first, Catch::Matchers::WithinAbs(5.0, 1e-6));
+  }
+}
+TEMPLATE_TEST_CASE("Batched Ray Fire on MeshMock", "[rayfire][mock][batch]",
+                   Embree_Raytracer,
+                   GPRT_Raytracer)
+{
+  constexpr auto rt_backend = TestType::value;
+  check_ray_tracer_supported(rt_backend); // skip if backend not enabled at configuration time
+
+  DYNAMIC_SECTION(fmt::format("Backend = {}", rt_backend))
+  {
+    auto rti = create_raytracer(rt_backend);
+    REQUIRE(rti);
+
+    auto mm = std::make_shared<MeshMock>(false);
+    mm->init();
+
+    auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+    REQUIRE(volume_tree != ID_NONE);
+
+    rti->init();
+
+    // use a number of rays that isn't a multiple of any packet width
+    std::vector<Position> origins;
+    std::vector<Direction> directions;
+    std::vector<double> expected;
+    const std::vector<Direction> axis_directions {{1.0, 0.0, 0.0}, {-1.0, 0.0, 0.0},
+                                                  {0.0, 1.0, 0.0}, {0.0, -1.0, 0.0},
+                                                  {0.0, 0.0, 1.0}, {0.0, 0.0, -1.0}};
+    const std::vector<double> axis_distances {5.0, 2.0, 6.0, 3.0, 7.0, 4.0};
+    for (int i = 0; i < 21; i++) {
+      origins.push_back({0.0, 0.0, 0.0});
+      directions.push_back(axis_directions[i % 6]);
+      expected.push_back(axis_distances[i % 6]);
+    }
+
+    std::vector<std::pair<double, MeshID>> hits;
+    rti->ray_fire_batch(volume_tree, origins, directions, {}, hits);
+    REQUIRE(hits.size() == origins.size());
+    for (size_t i = 0; i < hits.size(); i++) {
+      REQUIRE(hits[i].second != ID_NONE);
+      REQUIRE_THAT(hits[i].first, Catch::Matchers::WithinAbs(expected[i], 1e-6));
+      auto scalar_hit = rti->ray_fire(volume_tree, origins[i], directions[i]);
+      REQUIRE(hits[i].second == scalar_hit.second);
+    }
+
+    // per-ray distance limits: only rays with a limit beyond the surface should hit
+    std::vector<double> dist_limits(origins.size());
+    for (size_t i = 0; i < origins.size(); i++) {
+      dist_limits[i] = i % 2 == 0 ? expected[i] - 0.5 : expected[i] + 0.1;
+    }
+    rti->ray_fire_batch(volume_tree, origins, directions, dist_limits, hits);
+    for (size_t i = 0; i < hits.size(); i++) {
+      if (i % 2 == 0) REQUIRE(hits[i].second == ID_NONE);
+      else REQUIRE_THAT(hits[i].first, Catch::Matchers::WithinAbs(expected[i], 1e-6));
+    }
+
+    // per-ray exclusion lists are appended to and honoured as with ray_fire
+    std::vector<std::vector<MeshID>> exclusions(origins.size());
+    std::vector<std::vector<MeshID>*> exclude_primitives;
+    for (auto& e : exclusions) exclude_primitives.push_back(&e);
+
+    rti->ray_fire_batch(volume_tree, origins, directions, {}, hits, HitOrientation::EXITING, exclude_primitives);
+    for (const auto& e : exclusions) REQUIRE(e.size() == 1);
+
+    rti->ray_fire_batch(volume_tree, origins, directions, {}, hits, HitOrientation::EXITING, exclude_primitives);
+    for (const auto& hit : hits) REQUIRE(hit.second == ID_NONE);
+
+    // the same using exclusion sets
+    std::vector<PrimitiveExclusionSet> exclusion_sets(origins.size());
+    std::vector<PrimitiveExclusionSet*> exclude_sets;
+    for (auto& e : exclusion_sets) exclude_sets.push_back(&e);
+
+    rti->ray_fire_batch(volume_tree, origins, directions, {}, hits, HitOrientation::EXITING, exclude_sets);
+    for (size_t i = 0; i < exclusion_sets.size(); i++) {
+      REQUIRE(exclusion_sets[i].size() == 1);
+      REQUIRE(exclusion_sets[i].back() == exclusions[i].back());
+    }
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Threaded Batched Ray Fire on MeshMock", "[rayfire][mock][batch]")
+{
+  check_ray_tracer_supported(RTLibrary::EMBREE);
+
+  auto rti = create_raytracer(RTLibrary::EMBREE);
+  auto mm = std::make_shared<MeshMock>(false);
+  mm->init();
+  auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+  rti->init();
+
+  // enough rays for many packets on each thread
+  RandomStream rng(12345);
+  std::vector<Position> origins(1001, {0.0, 0.0, 0.0});
+  std::vector<Direction> directions(origins.size());
+  for (auto& direction : directions) direction = rand_dir(rng);
+
+  auto fire = [&](int n_threads, std::vector<PrimitiveExclusionSet>& exclusions) {
+    XDGConfig::config().set_n_threads(n_threads);
+    std::vector<PrimitiveExclusionSet*> exclude_primitives;
+    for (auto& e : exclusions) exclude_primitives.push_back(&e);
+    std::vector<std::pair<double, MeshID>> hits;
+    rti->ray_fire_batch(volume_tree, origins, directions, {}, hits, HitOrientation::EXITING, exclude_primitives);
+    return hits;
+  };
+
+  // results and exclusion sets are independent of the number of threads
+  std::vector<PrimitiveExclusionSet> serial_exclusions(origins.size());
+  std::vector<PrimitiveExclusionSet> threaded_exclusions(origins.size());
+  auto serial_hits = fire(1, serial_exclusions);
+  auto threaded_hits = fire(4, threaded_exclusions);
+  XDGConfig::config().reset();
+
+  for (size_t i = 0; i < origins.size(); i++) {
+    REQUIRE(threaded_hits[i] == serial_hits[i]);
+    REQUIRE(threaded_hits[i] == rti->ray_fire(volume_tree, origins[i], directions[i]));
+    REQUIRE(threaded_exclusions[i].size() == 1);
+    REQUIRE(threaded_exclusions[i].back() == serial_exclusions[i].back());
+  }
+}
+
+TEST_CASE("Ray Fire Hit Record on MeshMock", "[rayfire][mock]")
+{
+  check_ray_tracer_supported(RTLibrary::EMBREE);
+
+  auto mm = std::make_shared<MeshMock>();
+  mm->init();
+  auto xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+  MeshID volume = mm->volumes()[0];
+
+  std::vector<Direction> directions {{1.0, 0.0, 0.0}, {0.0, -1.0, 0.0}, {0.0, 0.0, 1.0},
+                                     Direction(1.0, 2.0, 3.0).normalize()};
+  Position origin {0.0, 0.0, 0.0};
+  for (const auto& direction : directions) {
+    PrimitiveExclusionSet exclusions;
+    HitRecord record = xdg->ray_fire_record(volume, origin, direction, INFTY, HitOrientation::EXITING, &exclusions);
+    auto hit = xdg->ray_fire(volume, origin, direction);
+
+    REQUIRE(record.hit());
+    REQUIRE(record.distance == hit.first);
+    REQUIRE(record.surface == hit.second);
+    REQUIRE(exclusions.size() == 1);
+    REQUIRE(exclusions.back() == record.primitive);
+
+    // the normal points out of the volume and matches the element normal
+    REQUIRE(record.normal.dot(direction) > 0.0);
+    Direction element_normal = mm->face_normal(record.primitive);
+    REQUIRE_THAT(std::abs(record.normal.dot(element_normal)), Catch::Matchers::WithinAbs(1.0, 1e-12));
+    REQUIRE(record.next_volume == mm->next_volume(volume, record.surface));
+
+    // handle-based queries give the same record
+    HitRecord handle_record = xdg->ray_fire_record(xdg->volume_handle(volume), origin, direction);
+    REQUIRE(handle_record.distance == record.distance);
+    REQUIRE(handle_record.primitive == record.primitive);
+  }
+
+  // misses produce an empty record
+  HitRecord miss = xdg->ray_fire_record(volume, origin, directions[0], 1.0);
+  REQUIRE_FALSE(miss.hit());
+  REQUIRE(miss.distance == INFTY);
+  REQUIRE(miss.primitive == ID_NONE);
+}
+
+TEST_CASE("Surface Crossings on MeshMock", "[rayfire][mock]")
+{
+  check_ray_tracer_supported(RTLibrary::EMBREE);
+
+  auto mm = std::make_shared<MeshMock>();
+  mm->init();
+  auto xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+  MeshID volume = mm->volumes()[0];
+
+  // the ray passes through the centers of the -x and +x faces of the box,
+  // which lie on the edge shared by the two triangles of each face
+  Position origin {-10.0, 1.5, 1.5};
+  Direction direction {1.0, 0.0, 0.0};
+  auto crossings = xdg->surface_crossings(origin, direction);
+  REQUIRE(crossings.size() == 2);
+
+  REQUIRE_THAT(crossings[0].distance, Catch::Matchers::WithinAbs(8.0, 1e-6));
+  REQUIRE(crossings[0].sense == Sense::REVERSE);
+  REQUIRE_THAT(crossings[1].distance, Catch::Matchers::WithinAbs(15.0, 1e-6));
+  REQUIRE(crossings[1].sense == Sense::FORWARD);
+
+  // the exiting crossing matches a ray fired from inside of the volume
+  PrimitiveExclusionSet exclusions;
+  auto hit = xdg->ray_fire(volume, {0.0, 1.5, 1.5}, direction, INFTY, HitOrientation::EXITING, &exclusions);
+  REQUIRE(crossings[1].surface == hit.second);
+  REQUIRE(exclusions.size() == 1);
+  auto surface_faces = mm->get_surface_faces(hit.second);
+  REQUIRE(std::find(surface_faces.begin(), surface_faces.end(), crossings[1].primitive) != surface_faces.end());
+
+  // crossings are limited by distance and count, keeping the nearest
+  REQUIRE(xdg->surface_crossings(origin, direction, 10.0).size() == 1);
+  REQUIRE(xdg->surface_crossings(origin, direction, 5.0).empty());
+  auto nearest = xdg->surface_crossings(origin, direction, INFTY, 1);
+  REQUIRE(nearest.size() == 1);
+  REQUIRE(nearest[0].distance == crossings[0].distance);
+  // duplicate hits on the shared edges don't count toward the cap
+  auto capped = xdg->surface_crossings(origin, direction, INFTY, 2);
+  REQUIRE(capped.size() == 2);
+  REQUIRE(capped[0].distance == crossings[0].distance);
+  REQUIRE(capped[1].distance == crossings[1].distance);
+  REQUIRE(xdg->surface_crossings(origin, direction, INFTY, 0).empty());
+
+  // a ray that misses the box
+  REQUIRE(xdg->surface_crossings({-10.0, 20.0, 0.0}, direction).empty());
+}
+
+TEST_CASE("Query Statistics", "[rayfire][mock]")
+{
+  check_ray_tracer_supported(RTLibrary::EMBREE);
+
+  auto rti = create_raytracer(RTLibrary::EMBREE);
+  auto mm = std::make_shared<MeshMock>(false);
+  mm->init();
+  auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+  rti->init();
+
+  reset_query_stats();
+  Position origin {0.0, 0.0, 0.0};
+  Direction direction {1.0, 0.0, 0.0};
+  REQUIRE_THAT(rti->ray_fire(volume_tree, origin, direction).first, Catch::Matchers::WithinAbs(5.0, 1e-6));
+  // every face is exiting from inside of the volume, so entering hits are culled
+  REQUIRE(rti->ray_fire(volume_tree, origin, direction, INFTY, HitOrientation::ENTERING).second == ID_NONE);
+  // counts of threads that have exited are kept
+  std::thread([&]() { rti->ray_fire(volume_tree, origin, -direction); }).join();
+
+  QueryStats stats = query_stats();
+  if (!QUERY_STATS_ENABLED) {
+    for (auto count : stats.counts) REQUIRE(count == 0);
+    return;
+  }
+
+  REQUIRE(stats[QueryCounter::RAYS] == 3);
+  REQUIRE(stats[QueryCounter::HITS] >= 2);
+  REQUIRE(stats[QueryCounter::ORIENTATION_CULLS] >= 1);
+  REQUIRE(stats[QueryCounter::EXCLUSION_CULLS] == 0);
+  REQUIRE(stats[QueryCounter::PRIMITIVE_TESTS] ==
+          stats[QueryCounter::HITS] + stats[QueryCounter::ORIENTATION_CULLS] + stats[QueryCounter::FALSE_CANDIDATES]);
+
+  // the hit surface element is excluded from a second ray fire
+  reset_query_stats();
+  PrimitiveExclusionSet exclusions;
+  rti->ray_fire(volume_tree, origin, direction, INFTY, HitOrientation::EXITING, &exclusions);
+  rti->ray_fire(volume_tree, origin, direction, INFTY, HitOrientation::EXITING, &exclusions);
+  stats = query_stats();
+  REQUIRE(stats[QueryCounter::RAYS] == 2);
+  REQUIRE(stats[QueryCounter::EXCLUSION_CULLS] >= 1);
+
+  reset_query_stats();
+  for (auto count : query_stats().counts) REQUIRE(count == 0);
+}
@@ -56,10 +56,10 @@ TEST_CASE("Test Pincell RT libraries Cross-Check ray_fire queries", "[moab][rayf
     SKIP("Fewer than two ray tracing backends are available; skipping cross-check.");
   }
 
-  srand48(12345); // set fixed seed for rng 
+  RandomStream rng(12345); // fixed seed for reproducible directions
   std::vector<Direction> directions(1000);
   for (auto &dir : directions) {
-    dir = rand_dir();
+    dir = rand_dir(rng);
   }
 
   const Position origin {0.0, 0.0, 0.0};
@@ -1,11 +1,16 @@
 // stl includes
 #include <memory>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
 
 // testing includes
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 
+#include "xdg/mesh_tally.h"
 #include "xdg/xdg.h"
 
 #include "mesh_mock.h"
@@ -70,3 +75,62 @@ TEST_CASE("Test Walk Elements") {
   REQUIRE(r.y == Catch::Approx(upper_right_corner.y).epsilon(1e-04));
   REQUIRE(r.z == Catch::Approx(upper_right_corner.z).epsilon(1e-04));
 }
+
+TEST_CASE("Test Mesh Tally") {
+  std::shared_ptr<MeshMock> mm = std::make_shared<MeshMock>();
+  mm->init();
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  // tracks between points inside of the (convex) mesh
+  auto bbox = mm->bounding_box();
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> x_dist(bbox.min_x, bbox.max_x);
+  std::uniform_real_distribution<double> y_dist(bbox.min_y, bbox.max_y);
+  std::uniform_real_distribution<double> z_dist(bbox.min_z, bbox.max_z);
+
+  std::vector<std::pair<Position, Position>> tracks;
+  double total_length = 0.0;
+  std::vector<double> reference(12, 0.0);
+  for (int i = 0; i < 500; ++i) {
+    Position start = {x_dist(gen), y_dist(gen), z_dist(gen)};
+    Position end = {x_dist(gen), y_dist(gen), z_dist(gen)};
+    tracks.push_back({start, end});
+    total_length += (end - start).length();
+    for (const auto& [element, length] : xdg->segments(start, end))
+      reference[mm->element_index(element)] += length;
+  }
+
+  for (auto accumulation : {TallyAccumulation::THREAD_PRIVATE,
+                            TallyAccumulation::ATOMIC,
+                            TallyAccumulation::STRIPED_LOCK}) {
+    MeshTally tally(mm, accumulation, 4);
+    REQUIRE(tally.accumulation() == accumulation);
+    REQUIRE(tally.n_threads() == 4);
+    REQUIRE(tally.n_elements() == 12);
+    REQUIRE(tally.memory() > 0);
+
+    tally.score_tracks(*xdg, tracks);
+    tally.finalize(false);
+    const auto& results = tally.results();
+    REQUIRE(results.size() == reference.size());
+    for (size_t i = 0; i < results.size(); ++i)
+      REQUIRE(results[i] == Catch::Approx(reference[i]).epsilon(1e-10));
+    double tally_length = std::accumulate(results.begin(), results.end(), 0.0);
+    REQUIRE(tally_length == Catch::Approx(total_length).epsilon(1e-08));
+
+    // normalized results are track length per unit volume
+    tally.finalize();
+    for (MeshID element = 0; element < 12; ++element)
+      REQUIRE(tally.result(element) * mm->element_volume(element) ==
+              Catch::Approx(reference[mm->element_index(element)]).epsilon(1e-10));
+
+    // scores from explicit thread slots combine, reset discards them
+    tally.reset();
+    tally.score(0, 1.0, 0);
+    tally.score(0, 2.0, 3);
+    tally.finalize(false);
+    REQUIRE(tally.result(0) == Catch::Approx(3.0));
+    REQUIRE(tally.result(1) == 0.0);
+  }
+}
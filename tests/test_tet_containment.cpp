@@ -5,6 +5,7 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 
+#include "xdg/geometry_data.h"
 #include "xdg/ray_tracing_interface.h"
 #include "xdg/tetrahedron_contain.h"
 #include "xdg/vec3da.h"
@@ -92,4 +93,42 @@ TEST_CASE("Tetrahedron Intersection Unit Test")
   // Test points that are in one tet but not the other
   CHECK(plucker_tet_containment_test(inside_point, v0_2, v1_2, v2_2, v3_2) == false);
   CHECK(plucker_tet_containment_test(inside_point_2, v0, v1, v2, v3) == false);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Tetrahedron Transform Cache")
+{
+  std::array<Vertex, 4> tet1 {Vertex(0.0, 0.0, 0.0), Vertex(1.0, 0.0, 0.0),
+                              Vertex(0.0, 1.0, 0.0), Vertex(0.0, 0.0, 1.0)};
+  std::array<Vertex, 4> tet2 {Vertex(1.0, 1.0, 1.0), Vertex(1.0, 2.0, 1.0),
+                              Vertex(2.0, 1.0, 1.0), Vertex(1.0, 1.0, 2.0)};
+  // all vertices in the z = 0 plane
+  std::array<Vertex, 4> flat {Vertex(0.0, 0.0, 0.0), Vertex(1.0, 0.0, 0.0),
+                              Vertex(0.0, 1.0, 0.0), Vertex(1.0, 1.0, 0.0)};
+
+  TetTransformCache cache;
+  REQUIRE(cache.empty());
+  cache.resize(3);
+  cache.set(0, tet1);
+  cache.set(1, tet2);
+  cache.set(2, flat);
+  REQUIRE(cache.memory() == 3 * TetTransformCache::N_COMPONENTS * sizeof(double));
+
+  // barycentric coordinates reproduce the point
+  Position point(0.1, 0.2, 0.3);
+  auto bary = cache.barycentric(0, point);
+  CHECK_THAT(bary[0], Catch::Matchers::WithinAbs(0.4, 1e-14));
+  CHECK_THAT(bary[1], Catch::Matchers::WithinAbs(0.1, 1e-14));
+  CHECK_THAT(bary[2], Catch::Matchers::WithinAbs(0.2, 1e-14));
+  CHECK_THAT(bary[3], Catch::Matchers::WithinAbs(0.3, 1e-14));
+
+  // containment matches the direct test
+  std::vector<Position> points {{0.1, 0.1, 0.1}, {2.0, 2.0, 2.0}, {0.0, 0.0, 0.5},
+                                {-0.5, -0.5, 0.0}, {0.3, 0.3, -0.1}, {0.4, 0.4, 0.4},
+                                {1.2, 1.2, 1.2}, {1.0, 1.0, 1.5}, {1.3, 1.3, 0.9}};
+  for (const auto& p : points) {
+    CHECK(cache.contains(0, p) == plucker_tet_containment_test(p, tet1[0], tet1[1], tet1[2], tet1[3]));
+    CHECK(cache.contains(1, p) == plucker_tet_containment_test(p, tet2[0], tet2[1], tet2[2], tet2[3]));
+    // degenerate elements contain nothing
+    CHECK_FALSE(cache.contains(2, p));
+  }
+}
@@ -0,0 +1,78 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// for testing
+#include <catch2/catch_test_macros.hpp>
+
+// xdg includes
+#include "xdg/timer.h"
+
+using namespace xdg;
+
+TEST_CASE("Test Timing Registry")
+{
+  auto& registry = TimingRegistry::instance();
+  // scopes aren't recorded unless the registry is enabled
+  REQUIRE_FALSE(registry.enabled());
+  {
+    ScopedTimer disabled("disabled");
+  }
+  REQUIRE(registry.scopes().empty());
+
+  registry.set_enabled(true);
+  registry.clear();
+
+  {
+    ScopedTimer outer("setup");
+    {
+      ScopedTimer inner("load");
+    }
+    ScopedTimer early("build");
+    early.stop();
+    // a scope on another thread isn't nested beneath the scopes of this one
+    std::thread([]() { ScopedTimer worker("commit"); }).join();
+  }
+
+  // scopes are recorded as they complete
+  auto scopes = registry.scopes();
+  REQUIRE(scopes.size() == 4);
+  REQUIRE(scopes[0].path == "setup/load");
+  REQUIRE(scopes[0].depth == 1);
+  REQUIRE(scopes[1].path == "setup/build");
+  REQUIRE(scopes[2].path == "commit");
+  REQUIRE(scopes[2].depth == 0);
+  REQUIRE(scopes[2].thread != scopes[0].thread);
+  REQUIRE(scopes[3].path == "setup");
+
+  // nested scopes lie within their parent
+  const auto& parent = scopes[3];
+  for (int i = 0; i < 2; i++) {
+    REQUIRE(scopes[i].start >= parent.start);
+    REQUIRE(scopes[i].start + scopes[i].duration <= parent.start + parent.duration);
+  }
+
+  std::string summary = registry.summary();
+  REQUIRE(summary.find("setup") != std::string::npos);
+  REQUIRE(summary.find("  load") != std::string::npos);
+  REQUIRE(summary.find("commit") != std::string::npos);
+
+  auto trace_file = std::filesystem::temp_directory_path() / "xdg_timing_trace.json";
+  registry.write_chrome_trace(trace_file.string());
+  std::ifstream trace(trace_file);
+  std::stringstream trace_contents;
+  trace_contents << trace.rdbuf();
+  REQUIRE(trace_contents.str().find("\"traceEvents\"") != std::string::npos);
+  REQUIRE(trace_contents.str().find("\"name\": \"load\"") != std::string::npos);
+  std::filesystem::remove(trace_file);
+
+  // nothing is recorded once the registry is disabled again
+  registry.clear();
+  registry.set_enabled(false);
+  {
+    ScopedTimer disabled("disabled");
+  }
+  REQUIRE(registry.scopes().empty());
+}
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <array>
 #include <numeric>
 #include <random>
 #include <string>
@@ -13,6 +14,7 @@
 // xdg includes
 #include "xdg/xdg.h"
 #include "xdg/constants.h"
+#include "xdg/element_face_accessor.h"
 #include "xdg/mesh_managers.h"
 
 #include "mesh_mock.h"
@@ -122,6 +124,163 @@ TEST_CASE("Test Random Internal Tracks")
   }
 }
 
+TEST_CASE("Test Element Face Accessor")
+{
+  std::shared_ptr<MeshMock> mm = std::make_shared<MeshMock>();
+  mm->init();
+
+  // faces formed by the stack-based accessor should match the mock's tet faces
+  for (MeshID element = 0; element < mm->tetrahedron_connectivity().size(); element++) {
+    ElementFaceAccessor accessor(mm.get(), element);
+    REQUIRE(accessor.element() == element);
+    auto faces = mm->tet_faces(mm->tetrahedron_connectivity()[element]);
+    for (int i = 0; i < 4; i++) {
+      auto face_vertices = accessor.face_vertices(i);
+      for (int j = 0; j < 3; j++)
+        REQUIRE(face_vertices[j] == mm->vertices()[faces[i][j]]);
+    }
+  }
+}
+
+TEST_CASE("Test Flat Topology Tracks")
+{
+  std::shared_ptr<MeshMock> mm = std::make_shared<MeshMock>();
+  mm->init();
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  std::shared_ptr<MeshMock> flat_mm = std::make_shared<MeshMock>();
+  flat_mm->init();
+  flat_mm->build_tet_topology(flat_mm->tet_face_ordering());
+  std::shared_ptr<XDG> flat_xdg = std::make_shared<XDG>(flat_mm);
+  flat_xdg->prepare_raytracer();
+
+  const auto& topology = flat_mm->tet_topology();
+  REQUIRE(topology.n_elements == 12);
+  REQUIRE(topology.memory() > 0);
+  for (MeshIndex i = 0; i < topology.n_elements; i++) {
+    MeshID element = topology.element_ids[i];
+    auto vertices = mm->element_vertices(element);
+    auto flat_vertices = topology.element_vertices(i);
+    for (int j = 0; j < 4; j++) REQUIRE(vertices[j] == flat_vertices[j]);
+  }
+
+  // tracks laid with the flat topology should match the MeshManager queries
+  auto bbox = mm->bounding_box();
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> x_dist(bbox.min_x, bbox.max_x);
+  std::uniform_real_distribution<double> y_dist(bbox.min_y, bbox.max_y);
+  std::uniform_real_distribution<double> z_dist(bbox.min_z, bbox.max_z);
+
+  MeshID volume_id = 0;
+  for (int i = 0; i < 1000; ++i) {
+    Position start = {x_dist(gen), y_dist(gen), z_dist(gen)};
+    Position end = {x_dist(gen), y_dist(gen), z_dist(gen)};
+
+    auto track_segments = xdg->segments(volume_id, start, end);
+    auto flat_track_segments = flat_xdg->segments(volume_id, start, end);
+    REQUIRE(track_segments.size() == flat_track_segments.size());
+    for (size_t j = 0; j < track_segments.size(); j++) {
+      REQUIRE(track_segments[j].first == flat_track_segments[j].first);
+      REQUIRE(track_segments[j].second == Catch::Approx(flat_track_segments[j].second).margin(1e-10));
+    }
+  }
+
+  // tracks passing through the central vertex of the mesh exercise the
+  // degenerate case of the incremental traversal
+  for (int i = 0; i < 1000; ++i) {
+    Position start = {x_dist(gen), y_dist(gen), z_dist(gen)};
+    Position end = -0.5 * start;
+
+    auto track_segments = xdg->segments(volume_id, start, end);
+    auto flat_track_segments = flat_xdg->segments(volume_id, start, end);
+    double total_length = 0.0;
+    double flat_total_length = 0.0;
+    for (const auto& segment : track_segments) total_length += segment.second;
+    for (const auto& segment : flat_track_segments) flat_total_length += segment.second;
+    REQUIRE(flat_total_length == Catch::Approx(total_length).epsilon(1e-10));
+    REQUIRE(flat_track_segments.front().first == track_segments.front().first);
+    REQUIRE(flat_track_segments.back().first == track_segments.back().first);
+  }
+}
+
+TEST_CASE("Test Segment Visitors")
+{
+  // walk with and without the flat topology
+  for (bool flat_topology : {false, true}) {
+    std::shared_ptr<MeshMock> mm = std::make_shared<MeshMock>();
+    mm->init();
+    if (flat_topology) mm->build_tet_topology(mm->tet_face_ordering());
+    std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+    xdg->prepare_raytracer();
+
+    // tracks start and end both inside and outside of the mesh
+    auto bbox = mm->bounding_box();
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> x_dist(bbox.min_x - 2.0, bbox.max_x + 2.0);
+    std::uniform_real_distribution<double> y_dist(bbox.min_y - 2.0, bbox.max_y + 2.0);
+    std::uniform_real_distribution<double> z_dist(bbox.min_z - 2.0, bbox.max_z + 2.0);
+
+    // the buffer and track state are reused for every track
+    std::array<std::pair<MeshID, double>, 2> buffer;
+    TrackState track;
+
+    for (int i = 0; i < 1000; ++i) {
+      Position start = {x_dist(gen), y_dist(gen), z_dist(gen)};
+      Position end = {x_dist(gen), y_dist(gen), z_dist(gen)};
+
+      auto track_segments = xdg->segments(start, end);
+
+      // the visitor sees the same segments in the same order
+      std::vector<std::pair<MeshID, double>> visited;
+      xdg->segments(start, end, [&](MeshID element, double length) { visited.push_back({element, length}); });
+      REQUIRE(visited == track_segments);
+
+      // a visitor returning false stops the track after the first segment
+      size_t n_visited = 0;
+      track.reset(start, end);
+      bool done = xdg->segments(track, [&](MeshID, double) { n_visited++; return false; });
+      REQUIRE(n_visited == std::min<size_t>(track_segments.size(), 1));
+      if (track_segments.size() > 1) REQUIRE_FALSE(done);
+
+      // filling a small buffer and resuming the track reproduces the segments
+      std::vector<std::pair<MeshID, double>> resumed;
+      track.reset(start, end);
+      size_t n = buffer.size();
+      while (n == buffer.size() && !track.done()) {
+        n = xdg->segments(track, buffer.data(), buffer.size());
+        resumed.insert(resumed.end(), buffer.begin(), buffer.begin() + n);
+      }
+      REQUIRE(track.done());
+      REQUIRE(resumed.size() == track_segments.size());
+      for (size_t j = 0; j < track_segments.size(); j++) {
+        REQUIRE(resumed[j].first == track_segments[j].first);
+        REQUIRE(resumed[j].second == Catch::Approx(track_segments[j].second).margin(1e-10));
+      }
+    }
+
+    // the walk visitor reports the element following the last segment and the
+    // distance traveled to the mesh boundary at x = 5
+    Position r {0.1, 0.2, 0.3};
+    MeshID element = xdg->find_element(r);
+    REQUIRE(element != ID_NONE);
+    double length = 0.0;
+    auto [next, traveled] = mm->walk_elements(element, r, {1.0, 0.0, 0.0}, 100.0,
+                                              [&](MeshID, double l) { length += l; });
+    REQUIRE(next == ID_NONE);
+    REQUIRE(traveled == Catch::Approx(4.9));
+    REQUIRE(length == traveled);
+
+    // visitors accepting an element index are given the index of each element
+    size_t n_visited = 0;
+    xdg->segments(r, {5.0, 0.2, 0.3}, [&](MeshID e, double, MeshIndex index) {
+      REQUIRE(index == mm->element_index(e));
+      n_visited++;
+    });
+    REQUIRE(n_visited > 0);
+  }
+}
+
 TEMPLATE_TEST_CASE("Test Single-Tet Glancing Vertex Intersection Tracks", "[tracks]",
                    MOAB_Interface,
                    LibMesh_Interface)
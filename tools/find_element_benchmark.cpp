@@ -0,0 +1,289 @@
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "argparse/argparse.hpp"
+#include <fmt/ranges.h>
+
+#include "xdg/config.h"
+#include "xdg/constants.h"
+#include "xdg/error.h"
+#include "xdg/timer.h"
+#include "xdg/vec3da.h"
+#include "xdg/xdg.h"
+
+#include "ray_benchmark.h"
+
+using namespace xdg;
+
+int main(int argc, char** argv)
+{
+  argparse::ArgumentParser args("XDG point location benchmarking tool",
+                                "1.0",
+                                argparse::default_arguments::help);
+
+  args.add_argument("filename")
+    .help("Path to the input file");
+
+  args.add_argument("-n", "--num-histories")
+    .default_value<std::uint32_t>(10'000)
+    .help("Number of particle histories to generate")
+    .scan<'u', std::uint32_t>();
+
+  args.add_argument("-e", "--events")
+    .default_value<std::uint32_t>(20)
+    .help("Maximum number of collision events per history")
+    .scan<'u', std::uint32_t>();
+
+  args.add_argument("--mfp")
+    .help("Mean free path between collisions. Defaults to 5% of the mesh bounding box diagonal")
+    .scan<'g', double>();
+
+  args.add_argument("--max-steps")
+    .default_value(100)
+    .help("Maximum number of elements visited by each hinted walk")
+    .scan<'i', int>();
+
+  args.add_argument("-s", "--seed")
+    .default_value<std::uint32_t>(12345)
+    .help("Seed for random history generation")
+    .scan<'u', std::uint32_t>();
+
+  args.add_argument("-m", "--mesh-library")
+    .help("Mesh library to use. One of (MOAB, LIBMESH)")
+    .default_value("MOAB");
+
+  args.add_argument("--element-cache")
+    .default_value(false)
+    .implicit_value(true)
+    .help("Precompute the barycentric transform of each element for the element trees");
+
+  args.add_argument("--no-tet-topology")
+    .default_value(false)
+    .implicit_value(true)
+    .help("Discard the flat tetrahedral topology and walk using MeshManager queries");
+
+  args.add_argument("--format")
+    .default_value("human")
+    .choices("human", "csv")
+    .help("stdout format. Human readable (default) or csv");
+
+  args.add_description(
+    "Benchmarks point location on collision-event workloads. Histories start "
+    "at random locations in the mesh and move an exponentially distributed "
+    "distance in a random direction between events until they leave the mesh. "
+    "The element of each event is located with and without the element of the "
+    "previous event as a hint.");
+
+  try {
+    args.parse_args(argc, argv);
+  }
+  catch (const std::runtime_error& err) {
+    std::cout << err.what() << std::endl;
+    std::cout << args;
+    exit(0);
+  }
+
+  std::string mesh_str = args.get<std::string>("--mesh-library");
+  MeshLibrary mesh_lib;
+  if (mesh_str == "MOAB") {
+    mesh_lib = MeshLibrary::MOAB;
+  } else if (mesh_str == "LIBMESH") {
+    mesh_lib = MeshLibrary::LIBMESH;
+  } else {
+    fatal_error("Invalid mesh library '{}' specified", mesh_str);
+  }
+
+  const std::string model_filename = args.get<std::string>("filename");
+  const std::string model_name = std::filesystem::path(model_filename).filename().string();
+  const std::size_t num_histories = args.get<std::uint32_t>("--num-histories");
+  const std::size_t max_events = args.get<std::uint32_t>("--events");
+  const int max_steps = args.get<int>("--max-steps");
+  const std::uint32_t seed = args.get<std::uint32_t>("--seed");
+  const std::string output_format = args.get<std::string>("--format");
+  const bool element_cache = args.get<bool>("--element-cache");
+  const bool no_tet_topology = args.get<bool>("--no-tet-topology");
+
+  XDGConfig::config().set_cache_element_transforms(element_cache);
+
+  Timer setup_timer;
+  Timer generation_timer;
+  Timer unhinted_timer;
+  Timer hinted_timer;
+
+  setup_timer.start();
+  std::shared_ptr<XDG> xdg = XDG::create(mesh_lib);
+  const auto& mesh_manager = xdg->mesh_manager();
+  mesh_manager->load_file(model_filename);
+  mesh_manager->init();
+  xdg->prepare_raytracer();
+  if (no_tet_topology) mesh_manager->clear_tet_topology();
+  setup_timer.stop();
+
+  const BoundingBox bbox = mesh_manager->global_bounding_box();
+  const double mfp = args.present<double>("--mfp").value_or(0.05 * bbox.width().length());
+
+  // generate the collision sites of each history, the element of each site
+  // is located without a hint as the reference result
+  generation_timer.start();
+  std::vector<std::vector<Position>> history_points(num_histories);
+  std::vector<std::vector<MeshID>> history_elements(num_histories);
+
+  #pragma omp parallel for schedule(runtime)
+  for (std::size_t i = 0; i < num_histories; ++i) {
+    RandomStream rng(seed, i);
+    Position r;
+    MeshID element = ID_NONE;
+    // rejection sample a starting location inside of the mesh
+    for (int attempt = 0; attempt < 100 && element == ID_NONE; ++attempt) {
+      r = bbox.sample_location(rng);
+      element = xdg->find_element(r);
+    }
+
+    while (element != ID_NONE && history_points[i].size() < max_events) {
+      history_points[i].push_back(r);
+      history_elements[i].push_back(element);
+      double direction[3];
+      tools::benchmark::random_unit_dir(rng, direction);
+      double distance = -mfp * std::log(1.0 - rng.uniform());
+      r += distance * Direction(direction[0], direction[1], direction[2]);
+      element = xdg->find_element(r);
+    }
+  }
+
+  // flatten the events, each event is hinted with the element of the previous
+  // event in its history
+  std::vector<Position> points;
+  std::vector<MeshID> reference;
+  std::vector<MeshID> hints;
+  for (std::size_t i = 0; i < num_histories; ++i) {
+    for (std::size_t j = 0; j < history_points[i].size(); ++j) {
+      points.push_back(history_points[i][j]);
+      reference.push_back(history_elements[i][j]);
+      hints.push_back(j == 0 ? ID_NONE : history_elements[i][j - 1]);
+    }
+  }
+  history_points.clear();
+  history_elements.clear();
+  const std::size_t num_events = points.size();
+  generation_timer.stop();
+
+  std::vector<MeshID> unhinted(num_events, ID_NONE);
+  std::vector<MeshID> hinted(num_events, ID_NONE);
+
+  unhinted_timer.start();
+  #pragma omp parallel for schedule(runtime)
+  for (std::size_t i = 0; i < num_events; ++i) {
+    unhinted[i] = xdg->find_element(points[i]);
+  }
+  unhinted_timer.stop();
+
+  hinted_timer.start();
+  #pragma omp parallel for schedule(runtime)
+  for (std::size_t i = 0; i < num_events; ++i) {
+    hinted[i] = xdg->find_element(points[i], hints[i], max_steps);
+  }
+  hinted_timer.stop();
+
+  // walk statistics and validation, outside of the timed regions
+  std::size_t num_hinted = 0;
+  std::size_t num_walk_hits = 0;
+  std::size_t num_mismatches = 0;
+
+  #pragma omp parallel for schedule(runtime) reduction(+:num_hinted, num_walk_hits, num_mismatches)
+  for (std::size_t i = 0; i < num_events; ++i) {
+    if (hinted[i] != reference[i] || unhinted[i] != reference[i]) num_mismatches++;
+    if (hints[i] == ID_NONE) continue;
+    num_hinted++;
+    if (mesh_manager->locate_element(hints[i], points[i], max_steps) != ID_NONE) num_walk_hits++;
+  }
+
+  const double setup_time = setup_timer.elapsed();
+  const double generation_time = generation_timer.elapsed();
+  const double unhinted_time = unhinted_timer.elapsed();
+  const double hinted_time = hinted_timer.elapsed();
+  const double unhinted_rate = unhinted_time > 0.0 ? static_cast<double>(num_events) / unhinted_time : 0.0;
+  const double hinted_rate = hinted_time > 0.0 ? static_cast<double>(num_events) / hinted_time : 0.0;
+  const double speedup = hinted_time > 0.0 ? unhinted_time / hinted_time : 0.0;
+  const double hit_rate = num_hinted > 0 ? static_cast<double>(num_walk_hits) / static_cast<double>(num_hinted) : 0.0;
+  const bool tet_topology = !mesh_manager->tet_topology().empty();
+
+  const std::vector<std::string> csv_columns {
+    "model",
+    "mesh_library",
+    "num_elements",
+    "num_histories",
+    "num_events",
+    "mfp",
+    "max_steps",
+    "seed",
+    "n_threads",
+    "tet_topology",
+    "element_cache",
+    "element_cache_bytes",
+    "initialisation_time_s",
+    "generation_time_s",
+    "unhinted_time_s",
+    "hinted_time_s",
+    "unhinted_throughput_queries_per_s",
+    "hinted_throughput_queries_per_s",
+    "speedup",
+    "walk_hit_rate",
+    "mismatches"
+  };
+
+  const std::vector<std::string> csv_values {
+    model_name,
+    mesh_str,
+    fmt::format("{}", mesh_manager->num_volume_elements()),
+    fmt::format("{}", num_histories),
+    fmt::format("{}", num_events),
+    fmt::format("{}", mfp),
+    fmt::format("{}", max_steps),
+    fmt::format("{}", seed),
+    fmt::format("{}", XDGConfig::config().n_threads()),
+    fmt::format("{}", tet_topology),
+    fmt::format("{}", element_cache),
+    fmt::format("{}", xdg->ray_tracing_interface()->element_cache_memory()),
+    fmt::format("{}", setup_time),
+    fmt::format("{}", generation_time),
+    fmt::format("{}", unhinted_time),
+    fmt::format("{}", hinted_time),
+    fmt::format("{}", unhinted_rate),
+    fmt::format("{}", hinted_rate),
+    fmt::format("{}", speedup),
+    fmt::format("{}", hit_rate),
+    fmt::format("{}", num_mismatches)
+  };
+
+  if (output_format == "csv") {
+    std::cout << fmt::format("{}\n", fmt::join(csv_columns, ","));
+    std::cout << fmt::format("{}\n", fmt::join(csv_values, ","));
+  } else {
+    std::cout << "\nXDG point location benchmark results\n";
+    std::cout << "----------------------------------------\n";
+    std::cout << "Model                 : " << model_name << "\n";
+    std::cout << "Mesh library          : " << mesh_str << "\n";
+    std::cout << "Elements              : " << mesh_manager->num_volume_elements() << "\n";
+    std::cout << "Flat tet topology     : " << (tet_topology ? "on" : "off") << "\n";
+    std::cout << "Element cache         : " << (element_cache ? "on" : "off") << "\n";
+    std::cout << "Threads               : " << XDGConfig::config().n_threads() << "\n";
+    std::cout << "Histories             : " << num_histories << "\n";
+    std::cout << "Events                : " << num_events << "\n";
+    std::cout << "Mean free path        : " << mfp << "\n";
+    std::cout << "Initialisation time   : " << setup_time << " s\n";
+    std::cout << "Generation time       : " << generation_time << " s\n";
+    std::cout << "Unhinted time         : " << unhinted_time << " s (" << unhinted_rate << " queries/s)\n";
+    std::cout << "Hinted time           : " << hinted_time << " s (" << hinted_rate << " queries/s)\n";
+    std::cout << "Speedup               : " << speedup << "x\n";
+    std::cout << "Walk hit rate         : " << 100.0 * hit_rate << " % of " << num_hinted << " hinted queries\n";
+    std::cout << "Mismatches            : " << num_mismatches << "\n";
+  }
+
+  return num_mismatches == 0 ? 0 : 1;
+}
@@ -2,13 +2,19 @@
 #include <memory>
 #include <string>
 
+#include "xdg/config.h"
 #include "xdg/error.h"
 #include "xdg/mesh_manager_interface.h"
+#include "xdg/timer.h"
 #include "xdg/vec3da.h"
 #include "xdg/xdg.h"
 
 #include "argparse/argparse.hpp"
 
+#ifdef XDG_OPENMP
+#include <omp.h>
+#endif
+
 #include "particle_sim.h"
 
 using namespace xdg;
@@ -50,6 +56,30 @@ args.add_argument("-m", "--mesh-library")
 args.add_argument("-r", "--rt-library")
     .help("Ray tracing library to use. One of (EMBREE, GPRT)")
     .default_value("EMBREE");
+
+args.add_argument("-s", "--seed")
+    .default_value<uint64_t>(42)
+    .help("Seed of the random number streams").scan<'u', uint64_t>();
+
+args.add_argument("--mode")
+    .default_value("history")
+    .choices("history", "event")
+    .help("Transport algorithm. history: particles are followed one at a time on each thread, "
+          "event: all particles are advanced one event at a time with batched ray queries");
+
+args.add_argument("-t", "--threads")
+    .default_value(-1)
+    .help("Number of threads to use. Defaults to the OpenMP maximum").scan<'i', int>();
+
+args.add_argument("--timing-trace")
+    .help("Write the timed setup and transport phases to this file as a Chrome trace "
+          "(chrome://tracing, Perfetto) and print a summary of them");
+
+args.add_argument("--memory")
+    .default_value(false)
+    .implicit_value(true)
+    .help("Report the memory held by the mesh, the ray tracer and XDG after transport");
+
 try {
   args.parse_args(argc, argv);
 }
@@ -59,10 +89,24 @@ catch (const std::runtime_error& err) {
   exit(0);
 }
 
-// Problem Setup
-srand48(42);
+// setup and transport phases are only timed when a trace is requested
+TimingRegistry::instance().set_enabled(args.present<std::string>("--timing-trace").has_value());
 
+// Problem Setup
 SimulationData sim_data;
+sim_data.seed_ = args.get<uint64_t>("--seed");
+sim_data.mode_ = args.get<std::string>("--mode") == "event" ? TransportMode::EVENT : TransportMode::HISTORY;
+
+int n_threads = args.get<int>("--threads");
+#ifdef XDG_OPENMP
+if (n_threads >= 1) omp_set_num_threads(n_threads);
+n_threads = omp_get_max_threads();
+#else
+if (n_threads > 1) warning("OpenMP not enabled; running in single-threaded mode");
+n_threads = 1;
+#endif
+// threads used by batched queries of the library
+XDGConfig::config().set_n_threads(n_threads);
 
 // create a mesh manager
 std::string mesh_str = args.get<std::string>("--mesh-library");
@@ -115,6 +159,23 @@ for (const auto& [cell, dist] : sim_data.cell_tracks) {
 }
 write_message("-----------");
 
+double transport_time = sim_data.transport_time_;
+write_message("Transport mode: {}", args.get<std::string>("--mode"));
+write_message("Threads: {}", n_threads);
+write_message("Transport time: {} s", transport_time);
+write_message("Events: {}", sim_data.n_events_);
+if (transport_time > 0.0) {
+  write_message("Particles/s: {}", sim_data.n_particles_ / transport_time);
+  write_message("Events/s: {}", sim_data.n_events_ / transport_time);
+}
+
+if (auto trace_file = args.present<std::string>("--timing-trace")) {
+  TimingRegistry::instance().write_chrome_trace(*trace_file);
+  write_message("Timing Summary\n{}", TimingRegistry::instance().summary());
+}
+
+if (args.get<bool>("--memory"))
+  write_message("Memory Report\n{}", xdg->memory_report().to_string());
 
 return 0;
 }
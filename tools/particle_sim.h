@@ -1,14 +1,24 @@
+#include <algorithm>
 #include <memory>
+#include <numeric>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "xdg/error.h"
 #include "xdg/mesh_manager_interface.h"
+#include "xdg/timer.h"
 #include "xdg/vec3da.h"
 #include "xdg/xdg.h"
 
 using namespace xdg;
 
+// Transport algorithms of the simulation
+enum class TransportMode {
+  HISTORY, // each particle is followed from birth to death, particles are distributed over threads
+  EVENT    // particles are advanced together one event at a time, queries of each kind are batched
+};
+
 struct SimulationData {
   std::shared_ptr<XDG> xdg_;
   double mfp_ {1.0};
@@ -16,13 +26,19 @@ struct SimulationData {
   uint32_t max_events_ {1000};
   bool verbose_particles_ {false};
   bool implicit_complement_is_graveyard_ {false};
+  uint64_t seed_ {DEFAULT_RNG_SEED}; //!< Seed of the random streams, particle i uses stream i
+  TransportMode mode_ {TransportMode::HISTORY};
   std::unordered_map<MeshID, double> cell_tracks;
+
+  // Results
+  uint64_t n_events_ {0}; //!< Total number of collision and surface crossing events
+  double transport_time_ {0.0}; //!< Wall-clock time spent transporting particles [s]
 };
 
 struct Particle {
 
-Particle(std::shared_ptr<XDG> xdg, uint32_t id, uint32_t max_events, bool verbose=true, bool ipc_graveyard=false)
-: verbose_(verbose), xdg_(xdg), id_(id), max_events_(max_events), ipc_graveyard_(ipc_graveyard) {}
+Particle(std::shared_ptr<XDG> xdg, uint32_t id, uint32_t max_events, bool verbose=true, bool ipc_graveyard=false, uint64_t seed=DEFAULT_RNG_SEED)
+: verbose_(verbose), xdg_(xdg), id_(id), max_events_(max_events), ipc_graveyard_(ipc_graveyard), rng_(seed, id) {}
 
 template<typename... Params>
 void log (const std::string& msg, const Params&... fmt_args) {
@@ -36,47 +52,71 @@ void initialize() {
   u_ = {1.0, 0.0, 0.0};
 
   volume_ = xdg_->find_volume(r_, u_);
+  volume_handle_ = xdg_->volume_handle(volume_);
   log("Particle {} initialized in volume {}", id_, volume_);
 }
 
 void surf_dist() {
-  surface_intersection_ = xdg_->ray_fire(volume_, r_, u_, INFTY, HitOrientation::EXITING, &history_);
-  if (surface_intersection_.first == 0.0) {
-    fatal_error("Particle {} stuck at position ({}, {}, {}) on surfacce {}", id_, r_.x, r_.y, r_.z, surface_intersection_.second);
+  surface_intersection_ = xdg_->ray_fire_record(volume_handle_, r_, u_, INFTY, HitOrientation::EXITING, &history_);
+  check_surface_intersection();
+}
+
+//! Set the surface intersection from the (distance, surface) result of a
+//! batched ray fire. The batch adds the hit surface element to the history
+void set_surface_intersection(const std::pair<double, MeshID>& hit) {
+  surface_intersection_ = {};
+  surface_intersection_.distance = hit.first;
+  surface_intersection_.surface = hit.second;
+  if (surface_intersection_.hit()) {
+    const auto& mm = xdg_->mesh_manager();
+    MeshID primitive = history_.back();
+    surface_intersection_.primitive = primitive;
+    // element normals point out of the surface's forward parent
+    auto [forward_parent, reverse_parent] = mm->get_parent_volumes(hit.second);
+    Direction normal = mm->face_normal(primitive);
+    surface_intersection_.normal = volume_ == forward_parent ? normal : -normal;
+    surface_intersection_.next_volume = volume_ == forward_parent ? reverse_parent : forward_parent;
+  }
+  check_surface_intersection();
+}
+
+void check_surface_intersection() {
+  if (surface_intersection_.distance == 0.0) {
+    fatal_error("Particle {} stuck at position ({}, {}, {}) on surfacce {}", id_, r_.x, r_.y, r_.z, surface_intersection_.surface);
     alive_ = false;
     return;
   }
-  if (surface_intersection_.second == ID_NONE) {
+  if (surface_intersection_.surface == ID_NONE) {
     fatal_error("Particle {} lost in volume {}", id_, volume_);
     alive_ = false;
     return;
   }
-  log("Intersected surface {} at distance {} ", surface_intersection_.second, surface_intersection_.first);
+  log("Intersected surface {} at distance {} ", surface_intersection_.surface, surface_intersection_.distance);
 }
 
 void sample_collision_distance(double mfp) {
-  collision_distance_ = -std::log(1.0 - drand48()) * mfp;
+  collision_distance_ = -std::log(1.0 - rng_.uniform()) * mfp;
 }
 
 void collide() {
   n_events_++;
   log("Event {} for particle {}", n_events_, id_);
-  u_ = rand_dir();
+  u_ = rand_dir(rng_);
   log("Particle {} collides with material at position ({}, {}, {}), new direction is ({}, {}, {})", id_, r_.x, r_.y, r_.z, u_.z, u_.y, u_.z);
   history_.clear();
 }
 
 void advance(std::unordered_map<MeshID, double>& cell_tracks)
 {
-  log("Comparing surface intersection distance {} to collision distance {}", surface_intersection_.first, collision_distance_);
-  if (collision_distance_ < surface_intersection_.first) {
+  log("Comparing surface intersection distance {} to collision distance {}", surface_intersection_.distance, collision_distance_);
+  if (collision_distance_ < surface_intersection_.distance) {
     r_ += collision_distance_ * u_;
     cell_tracks[volume_] += collision_distance_;
     log("Particle {} collides with material at position ({}, {}, {}) ", id_, r_.x, r_.y, r_.z);
   } else {
-    r_ += surface_intersection_.first * u_;
-    cell_tracks[volume_] += surface_intersection_.first;
-    log("Particle {} advances to surface {} at position ({}, {}, {}) ", id_, surface_intersection_.second, r_.x, r_.y, r_.z);
+    r_ += surface_intersection_.distance * u_;
+    cell_tracks[volume_] += surface_intersection_.distance;
+    log("Particle {} advances to surface {} at position ({}, {}, {}) ", id_, surface_intersection_.surface, r_.x, r_.y, r_.z);
   }
 }
 
@@ -84,13 +124,13 @@ void cross_surface()
 {
   n_events_++;
   log("Event {} for particle {}", n_events_, id_);
-  auto boundary_condition = xdg_->mesh_manager()->get_surface_property(surface_intersection_.second, PropertyType::BOUNDARY_CONDITION);
+  auto boundary_condition = xdg_->mesh_manager()->get_surface_property(surface_intersection_.surface, PropertyType::BOUNDARY_CONDITION);
   // check for the surface boundary condition
   if (boundary_condition.value == "reflecting" || boundary_condition.value == "reflective") {
-    log("Particle {} reflects off surface {}", id_, surface_intersection_.second);
+    log("Particle {} reflects off surface {}", id_, surface_intersection_.surface);
     log("Direction before reflection: ({}, {}, {})", u_.x, u_.y, u_.z);
 
-    Direction normal = xdg_->surface_normal(surface_intersection_.second, r_, &history_);
+    Direction normal = surface_intersection_.normal;
     log("Normal to surface: ({}, {}, {})", normal.x, normal.y, normal.z);
 
     double proj = dot(normal, u_);
@@ -105,16 +145,17 @@ void cross_surface()
       history_ = {history_.back()};
     }
   } else if (boundary_condition.value == "vacuum") {
-    log("Particle {} encounters vacuum boundary at surface {}", id_, surface_intersection_.second);
+    log("Particle {} encounters vacuum boundary at surface {}", id_, surface_intersection_.surface);
     alive_ = false;
   } else {
-    volume_ = xdg_->mesh_manager()->next_volume(volume_, surface_intersection_.second);
+    volume_ = surface_intersection_.next_volume;
     log("Particle {} enters volume {}", id_, volume_);
     if (ipc_graveyard_ && volume_ == xdg_->mesh_manager()->implicit_complement()) volume_ = ID_NONE;
     if (volume_ == ID_NONE) {
       alive_ = false;
       return;
     }
+    volume_handle_ = xdg_->volume_handle(volume_);
   }
 }
 
@@ -124,32 +165,168 @@ std::shared_ptr<XDG> xdg_;
 uint32_t id_ {0};
 int32_t max_events_ {1000};
 bool ipc_graveyard_ {false};
+RandomStream rng_; //!< Random stream of the particle, independent of other particles
 
 Position r_;
 Direction u_;
 MeshID volume_ {ID_NONE};
-std::vector<MeshID> history_ {};
-std::pair<double, MeshID> surface_intersection_ {INFTY, ID_NONE};
+VolumeHandle volume_handle_ {};
+PrimitiveExclusionSet history_ {};
+HitRecord surface_intersection_ {};
 double collision_distance_ {INFTY};
 int32_t n_events_ {0};
 bool alive_ {true};
 };
 
-void transport_particles(SimulationData& sim_data) {
-  // Problem Setup
-  srand48(42);
+//! Kill particles that have reached the event limit
+void check_event_limit(Particle& p) {
+  if (p.alive_ && p.n_events_ >= p.max_events_) {
+    p.log("Particle {} reached the event limit", p.id_);
+    p.alive_ = false;
+  }
+}
+
+//! Add the cell track lengths of each particle to the simulation's tally.
+//! Particles are merged in order so that the totals don't depend on the
+//! number of threads or the transport mode
+void merge_cell_tracks(SimulationData& sim_data,
+                       const std::vector<std::unordered_map<MeshID, double>>& particle_tracks) {
+  for (const auto& tracks : particle_tracks)
+    for (const auto& [cell, distance] : tracks) sim_data.cell_tracks[cell] += distance;
+}
+
+//! History-based transport. Particles are independent, each has its own
+//! random stream and cell tallies, and are distributed over threads
+void transport_particles_history(SimulationData& sim_data) {
+  std::vector<std::unordered_map<MeshID, double>> particle_tracks(sim_data.n_particles_);
+  uint64_t n_events = 0;
+
+  #pragma omp parallel for schedule(dynamic) reduction(+:n_events)
   for (uint32_t i = 0; i < sim_data.n_particles_; i++) {
-    Particle p {sim_data.xdg_, i, sim_data.max_events_, sim_data.verbose_particles_, sim_data.implicit_complement_is_graveyard_};
+    auto& cell_tracks = particle_tracks[i];
+    Particle p {sim_data.xdg_, i, sim_data.max_events_, sim_data.verbose_particles_, sim_data.implicit_complement_is_graveyard_, sim_data.seed_};
     p.initialize();
     while (p.alive_) {
       p.surf_dist();
       p.sample_collision_distance(sim_data.mfp_);
-      p.advance(sim_data.cell_tracks);
-      if (p.collision_distance_ < p.surface_intersection_.first) {
+      p.advance(cell_tracks);
+      if (p.collision_distance_ < p.surface_intersection_.distance) {
         p.collide();
       } else {
         p.cross_surface();
       }
+      check_event_limit(p);
     }
+    n_events += p.n_events_;
   }
-}
\ No newline at end of file
+
+  merge_cell_tracks(sim_data, particle_tracks);
+  sim_data.n_events_ = n_events;
+}
+
+//! Event-based transport. All living particles are advanced by one event
+//! per iteration in stages: the surface distances of the particles in each
+//! volume are found with one batched ray fire, then all particles move and
+//! score, then all collisions and all surface crossings are processed
+void transport_particles_event(SimulationData& sim_data) {
+  const auto& xdg = sim_data.xdg_;
+  std::vector<std::unordered_map<MeshID, double>> particle_tracks(sim_data.n_particles_);
+
+  std::vector<Particle> bank;
+  bank.reserve(sim_data.n_particles_);
+  for (uint32_t i = 0; i < sim_data.n_particles_; i++)
+    bank.emplace_back(xdg, i, sim_data.max_events_, sim_data.verbose_particles_, sim_data.implicit_complement_is_graveyard_, sim_data.seed_);
+
+  #pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < bank.size(); i++) bank[i].initialize();
+
+  // indices of the living particles
+  std::vector<size_t> active(bank.size());
+  std::iota(active.begin(), active.end(), 0);
+
+  // buffers of the batched ray fire, reused across events. Each ray excludes
+  // the primitive history held by its particle
+  std::vector<Position> origins;
+  std::vector<Direction> directions;
+  std::vector<std::pair<double, MeshID>> hits;
+  std::vector<PrimitiveExclusionSet*> exclusions;
+  std::vector<size_t> collisions;
+  std::vector<size_t> crossings;
+
+  while (!active.empty()) {
+    // surface distances, one batch per volume
+    std::sort(active.begin(), active.end(), [&](size_t a, size_t b) {
+      return std::make_pair(bank[a].volume_, a) < std::make_pair(bank[b].volume_, b);
+    });
+    for (size_t begin = 0; begin < active.size();) {
+      MeshID volume = bank[active[begin]].volume_;
+      size_t end = begin;
+      while (end < active.size() && bank[active[end]].volume_ == volume) end++;
+      size_t n_batch = end - begin;
+
+      origins.resize(n_batch);
+      directions.resize(n_batch);
+      exclusions.resize(n_batch);
+      for (size_t j = 0; j < n_batch; j++) {
+        Particle& p = bank[active[begin + j]];
+        origins[j] = p.r_;
+        directions[j] = p.u_;
+        exclusions[j] = &p.history_;
+      }
+
+      xdg->ray_fire_batch(volume, origins, directions, hits, {}, HitOrientation::EXITING, exclusions);
+
+      #pragma omp parallel for schedule(static)
+      for (size_t j = 0; j < n_batch; j++) {
+        bank[active[begin + j]].set_surface_intersection(hits[j]);
+      }
+      begin = end;
+    }
+
+    // move particles to their next event and score
+    #pragma omp parallel for schedule(static)
+    for (size_t j = 0; j < active.size(); j++) {
+      Particle& p = bank[active[j]];
+      if (!p.alive_) continue;
+      p.sample_collision_distance(sim_data.mfp_);
+      p.advance(particle_tracks[active[j]]);
+    }
+
+    // sort particles into collision and surface crossing banks
+    collisions.clear();
+    crossings.clear();
+    for (size_t idx : active) {
+      const Particle& p = bank[idx];
+      if (!p.alive_) continue;
+      if (p.collision_distance_ < p.surface_intersection_.distance) collisions.push_back(idx);
+      else crossings.push_back(idx);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (size_t j = 0; j < collisions.size(); j++) bank[collisions[j]].collide();
+
+    #pragma omp parallel for schedule(static)
+    for (size_t j = 0; j < crossings.size(); j++) bank[crossings[j]].cross_surface();
+
+    // remove dead particles from the active set
+    for (size_t idx : active) check_event_limit(bank[idx]);
+    active.erase(std::remove_if(active.begin(), active.end(), [&](size_t idx) { return !bank[idx].alive_; }),
+                 active.end());
+  }
+
+  merge_cell_tracks(sim_data, particle_tracks);
+  sim_data.n_events_ = 0;
+  for (const auto& p : bank) sim_data.n_events_ += p.n_events_;
+}
+
+void transport_particles(SimulationData& sim_data) {
+  ScopedTimer scope("transport_particles");
+  Timer timer;
+  timer.start();
+  if (sim_data.mode_ == TransportMode::EVENT)
+    transport_particles_event(sim_data);
+  else
+    transport_particles_history(sim_data);
+  timer.stop();
+  sim_data.transport_time_ = timer.elapsed();
+}
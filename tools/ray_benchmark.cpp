@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <filesystem>
@@ -13,6 +14,7 @@
 #include "xdg/config.h"
 #include "xdg/constants.h"
 #include "xdg/error.h"
+#include "xdg/query_stats.h"
 #include "xdg/timer.h"
 #include "xdg/vec3da.h"
 #include "xdg/xdg.h"
@@ -73,11 +75,43 @@ int main(int argc, char** argv)
     .help("Radius of a scattered source around the origin")
     .scan<'g', double>();
 
+  args.add_argument("-b", "--batch-size")
+    .default_value<std::uint32_t>(0)
+    .help("Fire rays in batches of this size using ray_fire_batch. 0 (default) fires rays one at a time")
+    .scan<'u', std::uint32_t>();
+
+  args.add_argument("--triangle-cache")
+    .default_value(false)
+    .implicit_value(true)
+    .help("Pack surface triangle data into per-surface buffers for the ray tracing callbacks");
+
+  args.add_argument("-g", "--geometry-mode")
+    .default_value("user")
+    .choices("user", "native")
+    .help("Embree surface geometry type. User geometry with double precision callbacks (default) "
+          "or native triangles with double precision refinement of candidate hits");
+
+  args.add_argument("--build-profile")
+    .default_value("max-trace")
+    .choices("fast-build", "balanced", "max-trace", "sweep")
+    .help("BVH build profile for all trees. 'sweep' rebuilds the volume's trees with each "
+          "profile and reports build time against ray tracing throughput");
+
   args.add_argument("--format")
     .default_value("human")
     .choices("human", "csv")
     .help("stdout format. Human readable (default) or csv");
 
+  args.add_argument("--timing-trace")
+    .help("Write the timed setup phases to this file as a Chrome trace (chrome://tracing, Perfetto) "
+          "and print a summary of them");
+
+  args.add_argument("--memory")
+    .default_value(false)
+    .implicit_value(true)
+    .help("Report the memory held by the mesh, the ray tracer and XDG after tracing. "
+          "Trees are built one at a time so that the memory of each is measured");
+
   args.add_description(
     "Benchmarks ray-fire throughput for a selected mesh volume. A source "
     "position is provided and ray directions are randomly generated from it.");
@@ -91,6 +125,9 @@ int main(int argc, char** argv)
     exit(0);
   }
 
+  // setup phases are only timed when a trace is requested
+  TimingRegistry::instance().set_enabled(args.present<std::string>("--timing-trace").has_value());
+
   std::string mesh_str = args.get<std::string>("--mesh-library");
   std::string rt_str = args.get<std::string>("--rt-library");
   std::string rt_label = rt_str;
@@ -118,6 +155,17 @@ int main(int argc, char** argv)
   const std::uint32_t seed = args.get<std::uint32_t>("--seed");
   const double source_radius = args.get<double>("--source-radius");
   const std::string output_format = args.get<std::string>("--format");
+  const std::size_t batch_size = args.get<std::uint32_t>("--batch-size");
+  const bool triangle_cache = args.get<bool>("--triangle-cache");
+  XDGConfig::config().set_cache_surface_triangles(triangle_cache);
+  const std::string geometry_mode = args.get<std::string>("--geometry-mode");
+  XDGConfig::config().set_native_surface_triangles(geometry_mode == "native");
+  const std::string build_profile_str = args.get<std::string>("--build-profile");
+  const bool sweep_profiles = build_profile_str == "sweep";
+  for (const auto& [profile, name] : BUILD_PROFILE_TO_STR) {
+    if (name == build_profile_str) XDGConfig::config().set_build_profile(profile);
+  }
+  XDGConfig::config().set_measure_tree_memory(args.get<bool>("--memory"));
 
   Timer wall_timer;
   Timer setup_timer;
@@ -178,6 +226,8 @@ int main(int argc, char** argv)
 
   const auto num_faces = mesh_manager->num_volume_faces(volume);
 
+  const std::size_t triangle_cache_bytes = xdg->ray_tracing_interface()->triangle_cache_memory();
+
 
   // Generate random rays from source
   generation_timer.start();
@@ -186,11 +236,10 @@ int main(int argc, char** argv)
 
   #pragma omp parallel for schedule(runtime)
   for (std::size_t i = 0; i < num_rays; ++i) {
-    std::uint32_t state = seed ^ static_cast<std::uint32_t>(i);
     auto sample = tools::benchmark::random_spherical_source(origin.x,
                                                             origin.y,
                                                             origin.z,
-                                                            state,
+                                                            RandomStream(seed, i),
                                                             source_radius);
     origins[i] = Position(sample.position[0],
                           sample.position[1],
@@ -201,18 +250,96 @@ int main(int argc, char** argv)
   }
   generation_timer.stop();
 
-  // Trace rays
-  trace_timer.start();
+  // fires all rays against the volume, returning the number of hits
+  auto trace_rays = [&](const std::shared_ptr<XDG>& xdg) {
+    std::size_t num_hits = 0;
+
+    if (batch_size == 0) {
+      #pragma omp parallel for schedule(runtime) reduction(+:num_hits)
+      for (std::size_t i = 0; i < num_rays; ++i) {
+        const auto hit = xdg->ray_fire(volume, origins[i], directions[i]);
+        if (hit.second != ID_NONE) num_hits++;
+      }
+    } else {
+      const std::size_t num_batches = (num_rays + batch_size - 1) / batch_size;
+
+      #pragma omp parallel for schedule(runtime) reduction(+:num_hits)
+      for (std::size_t b = 0; b < num_batches; ++b) {
+        const std::size_t start = b * batch_size;
+        const std::size_t end = std::min(start + batch_size, num_rays);
+        std::vector<Position> batch_origins(origins.begin() + start, origins.begin() + end);
+        std::vector<Direction> batch_directions(directions.begin() + start, directions.begin() + end);
+        std::vector<std::pair<double, MeshID>> hits;
+        xdg->ray_fire_batch(volume, batch_origins, batch_directions, hits);
+        for (const auto& hit : hits) {
+          if (hit.second != ID_NONE) num_hits++;
+        }
+      }
+    }
+    return num_hits;
+  };
 
-  std::size_t num_hits = 0;
+  if (sweep_profiles) {
+    // rebuild the volume's trees on the loaded mesh with each profile
+    const std::vector<std::string> sweep_columns {
+      "model", "mesh_library", "rt_library", "volume", "num_faces", "num_rays",
+      "n_threads", "build_profile", "num_hits", "build_time_s", "trace_time_s",
+      "trace_only_throughput_rays_per_s"
+    };
+    if (output_format == "csv") {
+      std::cout << fmt::format("{}\n", fmt::join(sweep_columns, ","));
+    } else {
+      std::cout << "\nXDG ray benchmark build profile sweep\n";
+      std::cout << "Model: " << model_name << ", volume " << volume << " (" << num_faces << " faces), "
+                << num_rays << " rays, " << rt_label << "\n";
+      std::cout << fmt::format("{:<12} {:>14} {:>14} {:>18}\n", "Profile", "Build time [s]",
+                               "Trace time [s]", "Throughput [rays/s]");
+    }
 
-  #pragma omp parallel for schedule(runtime) reduction(+:num_hits)
-  for (std::size_t i = 0; i < num_rays; ++i) {
-    const auto hit = xdg->ray_fire(volume, origins[i], directions[i]);
-    if (hit.second != ID_NONE) num_hits++;
+    for (const auto& [profile, profile_name] : BUILD_PROFILE_TO_STR) {
+      XDGConfig::config().set_build_profile(profile);
+      Timer build_timer;
+      build_timer.start();
+      auto profile_xdg = std::make_shared<XDG>(mesh_manager, rt_lib);
+      profile_xdg->prepare_volume_for_raytracing(volume);
+      profile_xdg->ray_tracing_interface()->init();
+      build_timer.stop();
+
+      Timer profile_trace_timer;
+      profile_trace_timer.start();
+      const std::size_t profile_hits = trace_rays(profile_xdg);
+      profile_trace_timer.stop();
+
+      const double build_time = build_timer.elapsed();
+      const double profile_trace_time = profile_trace_timer.elapsed();
+      const double profile_rps = profile_trace_time > 0.0
+        ? static_cast<double>(num_rays) / profile_trace_time
+        : 0.0;
+
+      if (output_format == "csv") {
+        const std::vector<std::string> sweep_values {
+          model_name, mesh_str, rt_str, fmt::format("{}", volume), fmt::format("{}", num_faces),
+          fmt::format("{}", num_rays), fmt::format("{}", XDGConfig::config().n_threads()),
+          profile_name, fmt::format("{}", profile_hits), fmt::format("{}", build_time),
+          fmt::format("{}", profile_trace_time), fmt::format("{}", profile_rps)
+        };
+        std::cout << fmt::format("{}\n", fmt::join(sweep_values, ","));
+      } else {
+        std::cout << fmt::format("{:<12} {:>14.6f} {:>14.6f} {:>18.6g}\n",
+                                 profile_name, build_time, profile_trace_time, profile_rps);
+      }
+    }
+    return 0;
   }
 
+  // Trace rays
+  xdg->reset_query_stats();
+  trace_timer.start();
+  const std::size_t num_hits = trace_rays(xdg);
   trace_timer.stop();
+  const QueryStats query_stats = xdg->query_stats();
+  const bool report_memory = args.get<bool>("--memory");
+  const MemoryReport memory_report = report_memory ? xdg->memory_report() : MemoryReport {};
 
   const std::size_t num_misses = num_rays - num_hits;
   const double hit_fraction = num_rays > 0
@@ -232,7 +359,7 @@ int main(int argc, char** argv)
   wall_timer.stop();
   const double wall_time = wall_timer.elapsed();
 
-  const std::vector<std::string> csv_columns {
+  std::vector<std::string> csv_columns {
     "model",
     "mesh_library",
     "rt_library",
@@ -248,6 +375,11 @@ int main(int argc, char** argv)
     "origin_y",
     "origin_z",
     "n_threads",
+    "geometry_mode",
+    "build_profile",
+    "batch_size",
+    "triangle_cache",
+    "triangle_cache_bytes",
     "initialisation_time_s",
     "generation_time_s",
     "trace_time_s",
@@ -257,7 +389,7 @@ int main(int argc, char** argv)
     "wall_time_s"
   };
 
-  const std::vector<std::string> csv_values {
+  std::vector<std::string> csv_values {
     model_name,
     mesh_str,
     rt_str,
@@ -273,6 +405,11 @@ int main(int argc, char** argv)
     fmt::format("{}", origin.y),
     fmt::format("{}", origin.z),
     fmt::format("{}", XDGConfig::config().n_threads()),
+    geometry_mode,
+    build_profile_str,
+    fmt::format("{}", batch_size),
+    fmt::format("{}", triangle_cache),
+    fmt::format("{}", triangle_cache_bytes),
     fmt::format("{}", setup_time),
     fmt::format("{}", generation_time),
     fmt::format("{}", trace_time),
@@ -282,6 +419,25 @@ int main(int argc, char** argv)
     fmt::format("{}", wall_time)
   };
 
+  // query counters are only reported by builds with XDG_ENABLE_QUERY_STATS
+  if (QUERY_STATS_ENABLED) {
+    for (const auto& [counter, name] : QUERY_COUNTER_TO_STR) {
+      csv_columns.push_back(name);
+      csv_values.push_back(fmt::format("{}", query_stats[counter]));
+    }
+  }
+
+  if (report_memory) {
+    csv_columns.push_back("memory_bytes");
+    csv_values.push_back(fmt::format("{}", memory_report.total()));
+    csv_columns.push_back("volume_memory_bytes");
+    auto volume_memory = memory_report.volumes.find(volume);
+    csv_values.push_back(fmt::format("{}", volume_memory != memory_report.volumes.end() ? volume_memory->second : 0));
+    csv_columns.push_back("volume_bvh_measured");
+    csv_values.push_back(fmt::format("{}", volume_memory != memory_report.volumes.end() &&
+                                           !memory_report.unmeasured_volumes.count(volume)));
+  }
+
   if (output_format == "csv") {
     std::cout << fmt::format("{}\n", fmt::join(csv_columns, ","));
     std::cout << fmt::format("{}\n", fmt::join(csv_values, ","));
@@ -295,6 +451,14 @@ int main(int argc, char** argv)
     std::cout << "Volume faces          : " << num_faces << "\n";
     std::cout << "Seed                  : " << seed << "\n";
     std::cout << "Rays                  : " << num_rays << "\n";
+    std::cout << "Geometry mode         : " << geometry_mode << "\n";
+    std::cout << "Build profile         : " << build_profile_str << "\n";
+    if (batch_size > 0) {
+      std::cout << "Batch size            : " << batch_size << "\n";
+    }
+    if (triangle_cache) {
+      std::cout << "Triangle cache memory : " << triangle_cache_bytes << " bytes\n";
+    }
     if (source_radius != 0.0) {
       std::cout << "Source center         : "
                 << origin.x << ", " << origin.y << ", " << origin.z << "\n";
@@ -316,7 +480,26 @@ int main(int argc, char** argv)
     std::cout << "----------------------------------------\n";
     std::cout << "End-to-end throughput : " << end_to_end_rps << " rays/s\n";
     std::cout << "Trace-only throughput : " << trace_only_rps << " rays/s\n";
+    if (args.present<std::string>("--timing-trace")) {
+      std::cout << "----------------------------------------\n";
+      std::cout << TimingRegistry::instance().summary();
+    }
+    if (QUERY_STATS_ENABLED) {
+      std::cout << "----------------------------------------\n";
+      std::cout << fmt::format("{:<22}{:>14} {:>12}\n", "Query counter", "Count", "Per ray");
+      for (const auto& [counter, name] : QUERY_COUNTER_TO_STR) {
+        double per_ray = num_rays > 0 ? static_cast<double>(query_stats[counter]) / num_rays : 0.0;
+        std::cout << fmt::format("{:<22}{:>14} {:>12.3f}\n", name, query_stats[counter], per_ray);
+      }
+    }
+    if (report_memory) {
+      std::cout << "----------------------------------------\n";
+      std::cout << memory_report.to_string();
+    }
   }
 
+  if (auto trace_file = args.present<std::string>("--timing-trace"))
+    TimingRegistry::instance().write_chrome_trace(*trace_file);
+
   return 0;
 }
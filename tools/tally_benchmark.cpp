@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <omp.h>
+
+#include "argparse/argparse.hpp"
+#include <fmt/ranges.h>
+
+#include "xdg/config.h"
+#include "xdg/constants.h"
+#include "xdg/error.h"
+#include "xdg/mesh_tally.h"
+#include "xdg/timer.h"
+#include "xdg/vec3da.h"
+#include "xdg/xdg.h"
+
+using namespace xdg;
+
+int main(int argc, char** argv)
+{
+  argparse::ArgumentParser args("XDG mesh tally scaling benchmarking tool",
+                                "1.0",
+                                argparse::default_arguments::help);
+
+  args.add_argument("filename")
+    .help("Path to the input file");
+
+  args.add_argument("-n", "--num-tracks")
+    .default_value<std::uint32_t>(100'000)
+    .help("Number of tracks to score")
+    .scan<'u', std::uint32_t>();
+
+  args.add_argument("-s", "--seed")
+    .default_value<std::uint32_t>(12345)
+    .help("Seed for random track generation")
+    .scan<'u', std::uint32_t>();
+
+  args.add_argument("-m", "--mesh-library")
+    .help("Mesh library to use. One of (MOAB, LIBMESH)")
+    .default_value("MOAB");
+
+  args.add_argument("-t", "--max-threads")
+    .help("Largest number of threads to benchmark. Defaults to the OpenMP maximum")
+    .scan<'i', int>();
+
+  args.add_argument("-a", "--accumulation")
+    .default_value("all")
+    .choices("thread-private", "atomic", "striped-lock", "all")
+    .help("Tally accumulation strategy to benchmark, or all strategies");
+
+  args.add_argument("--format")
+    .default_value("human")
+    .choices("human", "csv")
+    .help("stdout format. Human readable (default) or csv");
+
+  args.add_description(
+    "Benchmarks the scaling of mesh tally accumulation strategies. Tracks "
+    "between random locations in the mesh bounding box are scored with each "
+    "strategy using 1, 2, 4, ... up to the maximum number of threads. The "
+    "results of every run are compared against the single threaded results of "
+    "the first strategy.");
+
+  try {
+    args.parse_args(argc, argv);
+  }
+  catch (const std::runtime_error& err) {
+    std::cout << err.what() << std::endl;
+    std::cout << args;
+    exit(0);
+  }
+
+  std::string mesh_str = args.get<std::string>("--mesh-library");
+  MeshLibrary mesh_lib;
+  if (mesh_str == "MOAB") {
+    mesh_lib = MeshLibrary::MOAB;
+  } else if (mesh_str == "LIBMESH") {
+    mesh_lib = MeshLibrary::LIBMESH;
+  } else {
+    fatal_error("Invalid mesh library '{}' specified", mesh_str);
+  }
+
+  const std::string model_filename = args.get<std::string>("filename");
+  const std::string model_name = std::filesystem::path(model_filename).filename().string();
+  const std::size_t num_tracks = args.get<std::uint32_t>("--num-tracks");
+  const std::uint32_t seed = args.get<std::uint32_t>("--seed");
+  const std::string output_format = args.get<std::string>("--format");
+  const int max_threads = std::max(args.present<int>("--max-threads").value_or(omp_get_max_threads()), 1);
+
+  std::vector<TallyAccumulation> strategies;
+  const std::string accumulation_str = args.get<std::string>("--accumulation");
+  for (const auto& [accumulation, name] : TALLY_ACCUMULATION_TO_STR)
+    if (accumulation_str == "all" || accumulation_str == name) strategies.push_back(accumulation);
+
+  std::vector<int> thread_counts;
+  for (int n = 1; n < max_threads; n *= 2) thread_counts.push_back(n);
+  thread_counts.push_back(max_threads);
+
+  Timer setup_timer;
+  setup_timer.start();
+  std::shared_ptr<XDG> xdg = XDG::create(mesh_lib);
+  const auto& mesh_manager = xdg->mesh_manager();
+  mesh_manager->load_file(model_filename);
+  mesh_manager->init();
+  xdg->prepare_raytracer();
+  setup_timer.stop();
+
+  // sample the track end points
+  const BoundingBox bbox = mesh_manager->global_bounding_box();
+  std::vector<std::pair<Position, Position>> tracks(num_tracks);
+  for (std::size_t i = 0; i < num_tracks; ++i) {
+    RandomStream rng(seed, i);
+    tracks[i].first = bbox.sample_location(rng);
+    tracks[i].second = bbox.sample_location(rng);
+  }
+
+  struct Run {
+    TallyAccumulation accumulation;
+    int n_threads;
+    double score_time;
+    double finalize_time;
+    double speedup;
+    std::size_t memory;
+    double max_difference;
+  };
+
+  std::vector<Run> runs;
+  std::vector<double> reference;
+  for (auto accumulation : strategies) {
+    double serial_time = 0.0;
+    for (int n_threads : thread_counts) {
+      MeshTally tally(mesh_manager, accumulation, n_threads);
+      Timer score_timer;
+      Timer finalize_timer;
+
+      score_timer.start();
+      tally.score_tracks(*xdg, tracks);
+      score_timer.stop();
+
+      finalize_timer.start();
+      tally.finalize();
+      finalize_timer.stop();
+
+      // scores differ between runs only by the order of accumulation
+      const auto& results = tally.results();
+      if (reference.empty()) reference = results;
+      double max_difference = 0.0;
+      for (std::size_t i = 0; i < results.size(); ++i) {
+        double scale = std::max(std::abs(reference[i]), 1.0);
+        max_difference = std::max(max_difference, std::abs(results[i] - reference[i]) / scale);
+      }
+
+      double score_time = score_timer.elapsed();
+      if (n_threads == 1) serial_time = score_time;
+      double speedup = score_time > 0.0 ? serial_time / score_time : 0.0;
+      runs.push_back({accumulation, n_threads, score_time, finalize_timer.elapsed(),
+                      speedup, tally.memory(), max_difference});
+    }
+  }
+
+  const std::vector<std::string> csv_columns {
+    "model",
+    "mesh_library",
+    "num_elements",
+    "num_tracks",
+    "seed",
+    "accumulation",
+    "n_threads",
+    "tally_bytes",
+    "initialisation_time_s",
+    "score_time_s",
+    "finalize_time_s",
+    "throughput_tracks_per_s",
+    "speedup",
+    "max_relative_difference"
+  };
+
+  if (output_format == "csv") {
+    std::cout << fmt::format("{}\n", fmt::join(csv_columns, ","));
+  } else {
+    std::cout << "\nXDG mesh tally benchmark results\n";
+    std::cout << "----------------------------------------\n";
+    std::cout << "Model                 : " << model_name << "\n";
+    std::cout << "Mesh library          : " << mesh_str << "\n";
+    std::cout << "Elements              : " << mesh_manager->num_volume_elements() << "\n";
+    std::cout << "Tracks                : " << num_tracks << "\n";
+    std::cout << "Initialisation time   : " << setup_timer.elapsed() << " s\n";
+    std::cout << fmt::format("\n{:<16} {:>8} {:>14} {:>12} {:>14} {:>9} {:>12}\n",
+                             "Accumulation", "Threads", "Memory [B]", "Score [s]",
+                             "Tracks/s", "Speedup", "Max diff");
+  }
+
+  for (const auto& run : runs) {
+    double throughput = run.score_time > 0.0 ? static_cast<double>(num_tracks) / run.score_time : 0.0;
+    if (output_format == "csv") {
+      const std::vector<std::string> csv_values {
+        model_name,
+        mesh_str,
+        fmt::format("{}", mesh_manager->num_volume_elements()),
+        fmt::format("{}", num_tracks),
+        fmt::format("{}", seed),
+        fmt::format("{}", run.accumulation),
+        fmt::format("{}", run.n_threads),
+        fmt::format("{}", run.memory),
+        fmt::format("{}", setup_timer.elapsed()),
+        fmt::format("{}", run.score_time),
+        fmt::format("{}", run.finalize_time),
+        fmt::format("{}", throughput),
+        fmt::format("{}", run.speedup),
+        fmt::format("{}", run.max_difference)
+      };
+      std::cout << fmt::format("{}\n", fmt::join(csv_values, ","));
+    } else {
+      std::cout << fmt::format("{:<16} {:>8} {:>14} {:>12.4f} {:>14.1f} {:>8.2f}x {:>12.3e}\n",
+                               fmt::format("{}", run.accumulation), run.n_threads, run.memory,
+                               run.score_time, throughput, run.speedup, run.max_difference);
+    }
+  }
+
+  return 0;
+}
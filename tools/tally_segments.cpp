@@ -35,6 +35,16 @@ int main(int argc, char** argv) {
       .default_value(-1)
       .scan<'i', int>();
 
+  args.add_argument("-a", "--accumulation")
+      .help("Strategy used to accumulate tally scores from concurrent threads")
+      .default_value("thread-private")
+      .choices("thread-private", "atomic", "striped-lock");
+
+  args.add_argument("-s", "--seed")
+      .help("Seed of the random number streams")
+      .default_value<uint64_t>(42)
+      .scan<'u', uint64_t>();
+
   args.add_argument("-v", "--verbose")
       .default_value(false)
       .implicit_value(true)
@@ -59,8 +69,6 @@ int main(int argc, char** argv) {
   }
 
   // Problem Setup
-  srand48(42);
-
   // create a mesh manager
   std::shared_ptr<XDG> xdg {nullptr};
   if (args.get<std::string>("--library") == "MOAB")
@@ -91,6 +99,9 @@ int main(int argc, char** argv) {
   tally_context.check_tracks_ = args.get<bool>("--check-tracks");
   tally_context.verbose_ = args.get<bool>("--verbose");
   tally_context.quiet_ = args.get<bool>("--quiet");
+  tally_context.seed_ = args.get<uint64_t>("--seed");
+  for (const auto& [accumulation, name] : TALLY_ACCUMULATION_TO_STR)
+    if (name == args.get<std::string>("--accumulation")) tally_context.accumulation_ = accumulation;
 
   tally_segments(tally_context);
 
@@ -1,7 +1,8 @@
+#include <algorithm>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <vector>
-#include <numeric>
 #include <omp.h>
 
 #include <indicators/block_progress_bar.hpp>
@@ -11,6 +12,7 @@
 #include "xdg/vec3da.h"
 #include "xdg/timer.h"
 #include "xdg/bbox.h"
+#include "xdg/mesh_tally.h"
 
 #include "xdg/xdg.h"
 
@@ -20,6 +22,8 @@ struct TallyContext {
   std::shared_ptr<XDG> xdg_;
   int n_threads_ {1};
   int n_tracks_ {0};
+  TallyAccumulation accumulation_ {TallyAccumulation::THREAD_PRIVATE};
+  uint64_t seed_ {DEFAULT_RNG_SEED}; //!< Seed of the random streams, track i uses stream i
   bool check_tracks_ {false};
   bool verbose_ {false};
   bool quiet_ {false};
@@ -44,6 +48,10 @@ void tally_segments(const TallyContext& context) {
     }
   #endif
 
+  // track lengths are scored per element, each thread of the loop below is a scoring thread
+  MeshTally tally(xdg->mesh_manager(), context.accumulation_, context.n_threads_);
+  std::cout << fmt::format("Tally accumulation: {}", context.accumulation_) << "\n";
+
   int n_tracks_run = 0;
 
   Timer timer;
@@ -52,38 +60,54 @@ void tally_segments(const TallyContext& context) {
   {
     #pragma omp for
     for (int i = 0; i < context.n_tracks_; i++) {
-      // sample a location within the bounding box
-      Position r1 = bbox.sample_location();
+      // sample a location within the bounding box, each track has its own
+      // random stream so that the tracks don't depend on the number of threads
+      RandomStream rng(context.seed_, i);
+      Position r1 = bbox.sample_location(rng);
       if (!bbox.contains(r1)) fatal_error(fmt::format("Point {} is not within the mesh bounding box", r1));
 
-      Position r2 = bbox.sample_location();
+      Position r2 = bbox.sample_location(rng);
       if (!bbox.contains(r2)) fatal_error(fmt::format("Point {} is not within the mesh bounding box", r2));
 
-      auto segments = xdg->segments(r1, r2);
+      // score the segments as they are found rather than collecting them
+      int thread = omp_get_thread_num();
+      size_t n_segments = 0;
+      double segment_sum = 0.0;
+      xdg->segments(r1, r2, [&](MeshID, double length, MeshIndex index) {
+        tally.score_index(index, length, thread);
+        n_segments++;
+        segment_sum += length;
+      });
       #pragma omp atomic
       n_tracks_run++;
 
       if (context.quiet_) continue;
 
       if (context.verbose_) {
-          std::cout << fmt::format("Track {}: {} segments", i, segments.size()) << "\n";
+          std::cout << fmt::format("Track {}: {} segments", i, n_segments) << "\n";
       } else {
           prog_bar.set_progress(100.0 * (double)n_tracks_run / (double)context.n_tracks_);
       }
 
       if (context.check_tracks_) {
         double track_length = (r2 - r1).length();
-        double segement_sum = std::accumulate(segments.begin(), segments.end(), 0.0, [](double v, const auto& s) { return v + s.second; });
-        double diff = fabs(track_length - segement_sum);
+        double diff = fabs(track_length - segment_sum);
         if (diff > TINY_BIT) {
           fatal_error(fmt::format("Track length check failed.\n Start: {}\n End: {}\n Diff: {}", r1, r2, diff));
         }
       }
     }
   }
+  tally.finalize(false);
   timer.stop();
 
   if (!context.quiet_) prog_bar.mark_as_completed();
 
+  const auto& results = tally.results();
+  size_t n_scored = std::count_if(results.begin(), results.end(), [](double v) { return v > 0.0; });
+  double total_length = std::accumulate(results.begin(), results.end(), 0.0);
+  std::cout << fmt::format("Elements scored: {} of {}", n_scored, tally.n_elements()) << "\n";
+  std::cout << fmt::format("Total track length: {}", total_length) << "\n";
+  std::cout << fmt::format("Tally memory: {} bytes", tally.memory()) << "\n";
   std::cout << fmt::format("Time elapsed: {} s", timer.elapsed()) << "\n";
 }
@@ -0,0 +1,221 @@
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "argparse/argparse.hpp"
+#include <fmt/ranges.h>
+
+#include "xdg/config.h"
+#include "xdg/constants.h"
+#include "xdg/error.h"
+#include "xdg/timer.h"
+#include "xdg/vec3da.h"
+#include "xdg/xdg.h"
+
+#include "ray_benchmark.h"
+
+using namespace xdg;
+
+int main(int argc, char** argv)
+{
+  argparse::ArgumentParser args("XDG element traversal throughput benchmarking tool",
+                                "1.0",
+                                argparse::default_arguments::help);
+
+  args.add_argument("filename")
+    .help("Path to the input file");
+
+  args.add_argument("-n", "--num-walks")
+    .default_value<std::uint32_t>(100'000)
+    .help("Number of element walks to perform")
+    .scan<'u', std::uint32_t>();
+
+  args.add_argument("-s", "--seed")
+    .default_value<std::uint32_t>(12345)
+    .help("Seed for random walk generation")
+    .scan<'u', std::uint32_t>();
+
+  args.add_argument("-d", "--distance")
+    .help("Maximum length of each walk. Defaults to the diagonal of the mesh bounding box")
+    .scan<'g', double>();
+
+  args.add_argument("-m", "--mesh-library")
+    .help("Mesh library to use. One of (MOAB, LIBMESH)")
+    .default_value("MOAB");
+
+  args.add_argument("--no-tet-topology")
+    .default_value(false)
+    .implicit_value(true)
+    .help("Discard the flat tetrahedral topology and walk using MeshManager queries");
+
+  args.add_argument("--format")
+    .default_value("human")
+    .choices("human", "csv")
+    .help("stdout format. Human readable (default) or csv");
+
+  args.add_description(
+    "Benchmarks element-to-element traversal throughput (steps per second). "
+    "Walks start at random locations in the mesh and follow random directions "
+    "until they leave the mesh or reach the maximum walk length.");
+
+  try {
+    args.parse_args(argc, argv);
+  }
+  catch (const std::runtime_error& err) {
+    std::cout << err.what() << std::endl;
+    std::cout << args;
+    exit(0);
+  }
+
+  std::string mesh_str = args.get<std::string>("--mesh-library");
+  MeshLibrary mesh_lib;
+  if (mesh_str == "MOAB") {
+    mesh_lib = MeshLibrary::MOAB;
+  } else if (mesh_str == "LIBMESH") {
+    mesh_lib = MeshLibrary::LIBMESH;
+  } else {
+    fatal_error("Invalid mesh library '{}' specified", mesh_str);
+  }
+
+  const std::string model_filename = args.get<std::string>("filename");
+  const std::string model_name = std::filesystem::path(model_filename).filename().string();
+  const std::size_t num_walks = args.get<std::uint32_t>("--num-walks");
+  const std::uint32_t seed = args.get<std::uint32_t>("--seed");
+  const std::string output_format = args.get<std::string>("--format");
+  const bool no_tet_topology = args.get<bool>("--no-tet-topology");
+
+  Timer setup_timer;
+  Timer generation_timer;
+  Timer walk_timer;
+
+  // XDG setup, element trees are needed to locate the starting elements
+  setup_timer.start();
+  std::shared_ptr<XDG> xdg = XDG::create(mesh_lib);
+  const auto& mesh_manager = xdg->mesh_manager();
+  mesh_manager->load_file(model_filename);
+  mesh_manager->init();
+  xdg->prepare_raytracer();
+  if (no_tet_topology) mesh_manager->clear_tet_topology();
+  setup_timer.stop();
+
+  const BoundingBox bbox = mesh_manager->global_bounding_box();
+  const double distance = args.present<double>("--distance").value_or(bbox.width().length());
+
+  // sample starting elements, positions and directions
+  generation_timer.start();
+  std::vector<MeshID> elements(num_walks, ID_NONE);
+  std::vector<Position> origins(num_walks);
+  std::vector<Direction> directions(num_walks);
+
+  #pragma omp parallel for schedule(runtime)
+  for (std::size_t i = 0; i < num_walks; ++i) {
+    RandomStream rng(seed, i);
+    // rejection sample a location inside of the mesh
+    for (int attempt = 0; attempt < 100 && elements[i] == ID_NONE; ++attempt) {
+      origins[i] = bbox.sample_location(rng);
+      elements[i] = xdg->find_element(origins[i]);
+    }
+    double direction[3];
+    tools::benchmark::random_unit_dir(rng, direction);
+    directions[i] = Direction(direction[0], direction[1], direction[2]);
+  }
+  generation_timer.stop();
+
+  // walk elements
+  walk_timer.start();
+  std::size_t num_steps = 0;
+  std::size_t num_skipped = 0;
+
+  #pragma omp parallel for schedule(runtime) reduction(+:num_steps, num_skipped)
+  for (std::size_t i = 0; i < num_walks; ++i) {
+    if (elements[i] == ID_NONE) {
+      num_skipped++;
+      continue;
+    }
+    mesh_manager->walk_elements(elements[i], origins[i], directions[i], distance,
+                                [&num_steps](MeshID, double) { num_steps++; });
+  }
+  walk_timer.stop();
+
+  const double setup_time = setup_timer.elapsed();
+  const double generation_time = generation_timer.elapsed();
+  const double walk_time = walk_timer.elapsed();
+  const double steps_per_second = walk_time > 0.0
+    ? static_cast<double>(num_steps) / walk_time
+    : 0.0;
+  const double mean_steps = num_walks > num_skipped
+    ? static_cast<double>(num_steps) / static_cast<double>(num_walks - num_skipped)
+    : 0.0;
+  const bool tet_topology = !mesh_manager->tet_topology().empty();
+
+  const std::vector<std::string> csv_columns {
+    "model",
+    "mesh_library",
+    "num_elements",
+    "num_walks",
+    "num_skipped",
+    "num_steps",
+    "mean_steps_per_walk",
+    "walk_distance",
+    "seed",
+    "n_threads",
+    "tet_topology",
+    "tet_topology_bytes",
+    "initialisation_time_s",
+    "registration_time_s",
+    "tree_build_time_s",
+    "generation_time_s",
+    "walk_time_s",
+    "throughput_steps_per_s"
+  };
+
+  const std::vector<std::string> csv_values {
+    model_name,
+    mesh_str,
+    fmt::format("{}", mesh_manager->num_volume_elements()),
+    fmt::format("{}", num_walks),
+    fmt::format("{}", num_skipped),
+    fmt::format("{}", num_steps),
+    fmt::format("{}", mean_steps),
+    fmt::format("{}", distance),
+    fmt::format("{}", seed),
+    fmt::format("{}", XDGConfig::config().n_threads()),
+    fmt::format("{}", tet_topology),
+    fmt::format("{}", mesh_manager->tet_topology().memory()),
+    fmt::format("{}", setup_time),
+    fmt::format("{}", xdg->build_timings().registration),
+    fmt::format("{}", xdg->build_timings().tree_build),
+    fmt::format("{}", generation_time),
+    fmt::format("{}", walk_time),
+    fmt::format("{}", steps_per_second)
+  };
+
+  if (output_format == "csv") {
+    std::cout << fmt::format("{}\n", fmt::join(csv_columns, ","));
+    std::cout << fmt::format("{}\n", fmt::join(csv_values, ","));
+  } else {
+    std::cout << "\nXDG element walk benchmark results\n";
+    std::cout << "----------------------------------------\n";
+    std::cout << "Model                 : " << model_name << "\n";
+    std::cout << "Mesh library          : " << mesh_str << "\n";
+    std::cout << "Elements              : " << mesh_manager->num_volume_elements() << "\n";
+    std::cout << "Flat tet topology     : " << (tet_topology ? "on" : "off") << "\n";
+    std::cout << "Threads               : " << XDGConfig::config().n_threads() << "\n";
+    std::cout << "Walks                 : " << num_walks << " (" << num_skipped << " skipped)\n";
+    std::cout << "Walk distance         : " << distance << "\n";
+    std::cout << "Steps                 : " << num_steps << "\n";
+    std::cout << "Mean steps per walk   : " << mean_steps << "\n";
+    std::cout << "Initialisation time   : " << setup_time << " s\n";
+    std::cout << "  Registration time   : " << xdg->build_timings().registration << " s\n";
+    std::cout << "  Tree build time     : " << xdg->build_timings().tree_build << " s\n";
+    std::cout << "Generation time       : " << generation_time << " s\n";
+    std::cout << "Walk time             : " << walk_time << " s\n";
+    std::cout << "Throughput            : " << steps_per_second << " steps/s\n";
+  }
+
+  return 0;
+}
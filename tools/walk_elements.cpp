@@ -45,6 +45,11 @@ int main(int argc, char** argv) {
       .implicit_value(true)
       .help("Minimize all output (for performance testing)");
 
+  args.add_argument("-s", "--seed")
+      .help("Seed of the random number streams")
+      .default_value<uint64_t>(42)
+      .scan<'u', uint64_t>();
+
   args.add_argument("-m", "--mfp")
       .default_value(1.0)
       .help("Mean free path of the particles").scan<'g', double>();
@@ -59,8 +64,6 @@ int main(int argc, char** argv) {
   }
 
   // Problem Setup
-  srand48(42);
-
   // create a mesh manager
   std::shared_ptr<XDG> xdg {nullptr};
   if (args.get<std::string>("--library") == "MOAB")
@@ -85,6 +88,7 @@ int main(int argc, char** argv) {
   walkelementscontext.mean_free_path_ = args.get<double>("--mfp");
   walkelementscontext.verbose_ = args.get<bool>("--verbose");
   walkelementscontext.quiet_ = args.get<bool>("--quiet");
+  walkelementscontext.seed_ = args.get<uint64_t>("--seed");
 
   walk_elements(walkelementscontext);
 
@@ -23,6 +23,7 @@ struct WalkElementsContext {
   size_t n_particles_;
   bool verbose_;
   bool quiet_;
+  uint64_t seed_ {DEFAULT_RNG_SEED}; //!< Seed of the random streams, particle i uses stream i
 };
 
 void walk_elements(const WalkElementsContext& context) {
@@ -52,11 +53,13 @@ void walk_elements(const WalkElementsContext& context) {
   timer.start();
   #pragma omp parallel shared(n_particles_run)
   {
-    // Each thread needs its own random number state
     double thread_total_distance = 0.0;
 
     #pragma omp for
     for (int i = 0; i < context.n_particles_; i++) {
+      // each particle has its own random stream so that histories don't
+      // depend on the number of threads
+      RandomStream rng(context.seed_, i);
       int n_events = 0;
       double distance = 0.0;
       MeshID element = ID_NONE;
@@ -64,25 +67,25 @@ void walk_elements(const WalkElementsContext& context) {
 
       // sample a location within the model
       while (element == ID_NONE) {
-        r = bbox.sample_location();
+        r = bbox.sample_location(rng);
         element = xdg->find_element(r);
       }
 
-      Direction u = rand_dir();
+      Direction u = rand_dir(rng);
       u.normalize();
-      std::vector<MeshID> primitives;
+      PrimitiveExclusionSet primitives;
       while (element != ID_NONE) {
         // determine the distace to the next element
         auto [next_element, exit_distance] = xdg->next_element(element, r, u);
 
         // determine the distance to the next collision
-        double collision_distance = -std::log(1.0 - drand48()) * mean_free_path;
+        double collision_distance = -std::log(1.0 - rng.uniform()) * mean_free_path;
 
         if (collision_distance < exit_distance) {
           r += u * collision_distance;
           distance += collision_distance;
           // simulate an isotropic collision
-          u = rand_dir();
+          u = rand_dir(rng);
         } else {
           r += u * exit_distance;
           distance += exit_distance;